@@ -1,45 +1,106 @@
-//g++ -std=c++17 -fsanitize=undefined OVA.cpp -I ../utilities/whisper.cpp/include -I ../utilities/whisper.cpp/ggml/include -L ../utilities/whisper.cpp/build/src -lwhisper ../utilities/call_the_model.cpp ../utilities/transcriber.cpp ../utilities/voicer.cpp -o OVA.out -g
+//g++ -std=c++17 -fsanitize=undefined OVA.cpp -I ../utilities/whisper.cpp/include -I ../utilities/whisper.cpp/ggml/include -L ../utilities/whisper.cpp/build/src -lwhisper ../utilities/call_the_model.cpp ../utilities/stream_decoder.cpp ../utilities/request_policy.cpp ../utilities/config.cpp ../utilities/model_profiles.cpp ../utilities/model_preloader.cpp ../utilities/endpoint_pool.cpp ../utilities/transcriber.cpp ../utilities/transcription_service.cpp ../utilities/voicer.cpp ../utilities/audio_sink.cpp ../utilities/audio_output.cpp ../utilities/speech_cache.cpp ../utilities/speech_normalizer.cpp ../utilities/wav_reader.cpp ../utilities/model_selector.cpp ../utilities/vad.cpp ../utilities/spectrum.cpp ../utilities/audio_capture.cpp ../utilities/speculative_prefill.cpp ../utilities/wake_listener.cpp ../utilities/metrics.cpp ../utilities/logging.cpp ../utilities/audio_frontend.cpp -pthread -o OVA.out -g
 
 #include <iostream>
 #include <string>
 #include <thread>
 #include <algorithm>
 #include "../utilities/call_the_model.hpp"
+#include "../utilities/config.hpp"
 #include "../utilities/transcriber.hpp"
+#include "../utilities/transcription_service.hpp"
 #include "../utilities/voicer.hpp"
+#include "../utilities/speech_normalizer.hpp"
+#include "../utilities/audio_output.hpp"
+#include "../utilities/model_selector.hpp"
+#include "../utilities/speculative_prefill.hpp"
+#include "../utilities/wake_listener.hpp"
+#include "../utilities/model_preloader.hpp"
+#include "../utilities/logging.hpp"
 #include <fstream>
 #include <sstream>
-#include <unordered_map>
 #include <cctype>
+#include <functional>
+#include <memory>
+#include <unistd.h>
+
+#define BARGE_IN_DUCK_GAIN 0.25f // Volumen de la respuesta mientras se confirma el barge-in
+#define KEY_ESCAPE 27            // Tecla que corta la respuesta en curso
+
+// Opciones de la entrada por voz
+struct VoiceInputOptions {
+    bool autoEndpoint = false;          // --auto: VAD en lugar de las teclas R/S
+    int hangoverMs = VAD_HANGOVER_MS;   // --hangover MS: silencio que cierra el turno
+    bool speculative = false;           // --speculative: pre-cargar el prompt mientras se habla
+    std::string wakePhrase;             // --wake [FRASE]: esperar la frase antes de cada turno
+    bool denoise = false;               // --denoise: paso alto, reducción de ruido y AGC antes de Whisper
+};
+
+// Modelo, opciones e historial de un turno, preparados antes de conocer la pregunta
+struct TurnContext {
+    bool ok = false;
+    std::string model;
+    std::string instruction;
+    ollama::options options;
+    ollama::messages historial;
+};
 
 // Funciones auxiliares
-void speak(const std::string& text);
-std::string getResponse(const std::string& query,const std::string& mode,bool &detail_response);
-void runMode(const std::string& mode, bool useVoiceInput, bool useVoiceOutput, bool detail_response);
-std::unordered_map<std::string, std::string> loadOptions(const std::string& filename);
+void speak(const std::string& text, bool wait);
+TurnContext prepareTurn(const std::string& mode, bool detail_response);
+std::string getResponse(const std::string& query,const std::string& mode,bool &detail_response,
+                        const TurnContext* prepared = nullptr);
+void normalizeVoiceInput(std::string& input);
+bool escapePressed();
+void runMode(const std::string& mode, bool useVoiceInput, bool useVoiceOutput, bool detail_response, const VoiceInputOptions& voiceOptions);
+void runCalibration(double rtfBudget);
 void OVAlog(const std::string& message);
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        std::cerr << "Usage: " << "ova" << " [chat|amfq] [--voice] [--speak]" << std::endl;
+        std::cerr << "Usage: " << "ova" << " [chat|amfq|calibrate] [--voice [--auto [--speculative] [--wake [PHRASE]]] [--hangover MS] [--denoise]] [--speak [--speak-to FILE.wav]] [--budget-rtf X]" << std::endl;
         return 1;
     }
     
     std::string mode = argv[1];
     std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
     bool useVoiceInput = false, useVoiceOutput = false; bool Detail_response = false;
+    double rtfBudget = DEFAULT_RTF_BUDGET;
+    VoiceInputOptions voiceOptions;
     
     for (int i = 2; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--voice") useVoiceInput = true;
         if (arg == "--speak") useVoiceOutput = true;
         if (arg == "--detail") Detail_response = true;
+        if (arg == "--budget-rtf" && i + 1 < argc) rtfBudget = std::stod(argv[++i]);
+        if (arg == "--auto") voiceOptions.autoEndpoint = true;
+        if (arg == "--hangover" && i + 1 < argc) voiceOptions.hangoverMs = std::stoi(argv[++i]);
+        if (arg == "--speculative") voiceOptions.speculative = true;
+        if (arg == "--denoise") voiceOptions.denoise = true;
+        if (arg == "--wake") {
+            voiceOptions.wakePhrase = WAKE_DEFAULT_PHRASE;
+            if (i + 1 < argc && argv[i + 1][0] != '-') voiceOptions.wakePhrase = argv[++i];
+        }
+        if (arg == "--speak-to" && i + 1 < argc) {
+            // Write the spoken answers to a WAV instead of the sound card
+            audio_output().set_sink(std::make_unique<WavFileSink>(argv[++i]));
+        }
+    }
+    if (!voiceOptions.wakePhrase.empty() && !(useVoiceInput && voiceOptions.autoEndpoint)) {
+        std::cerr << "Warning: --wake needs --voice --auto; ignoring it." << std::endl;
+        voiceOptions.wakePhrase.clear();
+    }
+    if (voiceOptions.speculative && !(useVoiceInput && voiceOptions.autoEndpoint)) {
+        std::cerr << "Warning: --speculative needs --voice --auto; ignoring it." << std::endl;
+        voiceOptions.speculative = false;
     }
     
     if (mode == "chat" || mode == "amfq") {
-        runMode(mode, useVoiceInput, useVoiceOutput, Detail_response);
+        runMode(mode, useVoiceInput, useVoiceOutput, Detail_response, voiceOptions);
+    } else if (mode == "calibrate") {
+        runCalibration(rtfBudget);
     } else {
-        std::cerr << "Invalid mode. Please use 'chat' or 'amfq'." << std::endl;
+        std::cerr << "Invalid mode. Please use 'chat', 'amfq' or 'calibrate'." << std::endl;
         return 1;
     }
     
@@ -47,110 +108,76 @@ int main(int argc, char* argv[]) {
 }
 
 void OVAlog(const std::string& message) {
-    
-    std::string logDirectory = "../logs/"; 
-    std::filesystem::create_directories(logDirectory);
-    std::string logFilePath = logDirectory + "OVA.log";
-
-    std::ofstream logFile(logFilePath, std::ios::app); // Open in append mode
-    if (logFile) {
-        logFile << message << std::endl;
-        logFile.close();
-    } else {
-        std::cerr << "❌ Error: No se pudo abrir el archivo de registro en " << logFilePath << std::endl;
-    }
+    write_log("OVA.log", message);
 }
 
-std::unordered_map<std::string, std::string> loadOptions(const std::string& filename) {
-    std::unordered_map<std::string, std::string> options;
-    std::ifstream file(filename);
-    
-    if (!file.is_open()) {
-        std::string errMsg = "Error: Could not open " + filename;
-        OVAlog(errMsg);
-        return options;
-    }
+TurnContext prepareTurn(const std::string& mode, bool detail_response) {
+    TurnContext turn;
+    std::string historial_json = get_commands_directory() + "/historial_test.json";
+
+    // Validated once per version of opcions.json; an edit applies from the next turn
+    const Config& cfg = config();
+
+    inicializar_historial(historial_json, turn.historial);
 
     try {
-        nlohmann::json jsonData;
-        file >> jsonData;
-        
-        for (auto& [key, value] : jsonData.items()) {
-            options[key] = value.is_string() ? value.get<std::string>() : value.dump();
+        std::string model;
+        if (!detail_response){
+            model = mode == "amfq" ? cfg.model_fast_response : cfg.model_chat_response;
+        } else {
+            model = mode == "amfq" ? cfg.model_chat_response : cfg.model_chat_response_unrestricted;
         }
 
-        std::string Msg = "Loaded options:\n";
-        OVAlog(Msg);
-        for (const auto& [key, value] : options) {
-            std::string Msg = key + " -> " + value;
-            OVAlog(Msg);
-        }
-        
+        verificar_ollama(model);
+
+        turn.options = cfg.options;
+        turn.instruction = detail_response ? cfg.detail_instruction : cfg.initial_instruction;
+        turn.model = model;
+        turn.ok = true;
     } catch (const std::exception& e) {
-        std::string errMsg = std::string("JSON parsing error: ") + e.what();
+        //left logging
+        std::string errMsg = std::string("Exception caught: ") + e.what();
+        OVAlog(errMsg);
+    } catch (...) {
+        //left logging
+        std::string errMsg = "Unknown error occurred.";
         OVAlog(errMsg);
     }
-
-    return options;
+    return turn;
 }
 
-std::string getResponse(const std::string& query,const std::string& mode,bool &detail_response) {
-    std::string command_dir = get_commands_directory();
-    std::string historial_json = command_dir + "/historial_test.json";
-    std::string opciones_json = command_dir + "/opcions.json";
-    
-    auto opciones = loadOptions(opciones_json);
-    
-    // Ensure required keys exist
-    std::vector<std::string> required_keys = {"model", "initial_intrucion"};
-    for (const auto& key : required_keys) {
-        if (opciones.find(key) == opciones.end()) {
-            std::string errMsg = "Error: Missing required key in options: " + key;
-            OVAlog(errMsg);
-        }
-    }
-    
-    ollama::messages historial;
-    inicializar_historial(historial_json, historial);
-    if (historial.empty()) {
-        historial.clear();
+// prepared: the turn already built for the speculative prefill, so the request matches it
+std::string getResponse(const std::string& query,const std::string& mode,bool &detail_response,
+                        const TurnContext* prepared) {
+    TurnContext turn = prepared ? *prepared : prepareTurn(mode, detail_response);
+    if (!turn.ok) {
+        return "Error: No response received.";
     }
     
     try {
-        std::string model = opciones["model"];
-
-        if (!detail_response){
-            if(mode == "amfq"){
-                model = opciones["model_fast_response"];
-            } else {
-                model = opciones["model_chat_response"];
-
-            }
-        } else {
-            if(mode == "amfq"){
-                model = opciones["model_chat_response"];
-            } else {
-                model = opciones["model_chat_response_unrestricted"];
-            }
-        }
-
-        verificar_ollama(model);
-        
-        // Convert unordered_map to ollama::options class
-        ollama::options convertedOptions;
-        convertedOptions["model"] = model;
-
-        if (detail_response){
-            convertedOptions["initial_intrucion"] = opciones["detail_initial_intrucion"];
-        } else {
-            convertedOptions["initial_intrucion"] = opciones["initial_intrucion"];
+        // Ctrl+C o Esc cortan la respuesta sin cerrar la sesión
+        ControlGeneracion control;
+        CtrlCCancela ctrlC(control);
+        if (isatty(STDIN_FILENO)) control.comprobar = escapePressed;
+        control.presupuesto = latency_budget(detail_response ? mode + "_detail" : mode);
+        record_model_usage(control.presupuesto.mode, turn.model);
+        FormattedStreamPrinter printer;
+        std::string response;
+        EstadoRespuesta estado = obtener_respuesta_stream(turn.historial, turn.model, turn.options, turn.instruction, query, "user",
+            [&printer, &response](const std::string& text, size_t start) {
+                printer.feed(text, start);
+                if (start == 0) response.clear(); // Restarted on the fast model (latency budget)
+                response.append(text, start, std::string::npos);
+            }, &control);
+        printer.finish(response);
+        if (estado == EstadoRespuesta::error && response.empty()) {
+            return "Error: No response received.";
         }
-        
-        obtener_respuesta(historial, convertedOptions["model"], convertedOptions, convertedOptions["initial_intrucion"], query, "user");
-        if (!historial.empty() && historial.back().count("content")) {
-            print_formatted_output(historial.back()["content"]);
-            return historial.back()["content"];
+        if (estado != EstadoRespuesta::completa) {
+            std::cout << "⏹️ Response stopped." << std::endl;
         }
+        // Se habla solo lo generado, sin la marca de respuesta truncada
+        return response;
     } catch (const std::exception& e) {
         //left logging
         std::string errMsg = std::string("Exception caught: ") + e.what();
@@ -164,33 +191,155 @@ std::string getResponse(const std::string& query,const std::string& mode,bool &d
     return "Error: No response received.";
 }
 
-void speak(const std::string& text) {
-    Voicer("transcripcion.txt", "audiogene.wav").generarAudio(text);
+// Trim spaces, newlines, '.', and '!' from the input and lowercase it
+void normalizeVoiceInput(std::string& input) {
+    input.erase(0, input.find_first_not_of(" \t\r\n.!")); // Trim left
+    input.erase(input.find_last_not_of(" \t\r\n.!") + 1); // Trim right
+    std::transform(input.begin(), input.end(), input.begin(), ::tolower);
 }
 
-void runMode(const std::string& mode, bool useVoiceInput, bool useVoiceOutput, bool detail_response) {
-    Transcriber transcriber("../utilities/whisper.cpp/models/ggml-base.bin", "audio.wav");
+// Esc while an answer is being generated; any other key stays in stdin for the next prompt
+bool escapePressed() {
+    if (!keyboardhit()) return false;
+    int key = getchar();
+    if (key == KEY_ESCAPE) return true;
+    ungetc(key, stdin);
+    return false;
+}
+
+void speak(const std::string& text, bool wait) {
+    // Speak the prose, not the code blocks or the markdown backticks
+    Voicer("transcripcion.txt", "audiogene.wav").generarAudio(normalize_for_speech(text), wait);
+}
+
+// Benchmark every installed whisper model and cache the best one for this CPU
+void runCalibration(double rtfBudget) {
+    std::cout << "Calibrating whisper models on " << REFERENCE_CLIP << " (RTF budget " << rtfBudget << ")..." << std::endl;
+    std::vector<ModelBenchmark> results = benchmark_whisper_models();
+    for (const ModelBenchmark& bench : results) {
+        std::cout << "  " << bench.path << "  rtf=" << bench.rtf << "  wer=" << bench.wer
+                  << (bench.ok ? "" : "  (failed)") << std::endl;
+    }
+    std::string selected = select_and_cache_model(results, rtfBudget);
+    if (selected.empty()) {
+        std::cerr << "Error: No whisper model could be benchmarked." << std::endl;
+        return;
+    }
+    std::cout << "Selected: " << selected << std::endl;
+}
+
+void runMode(const std::string& mode, bool useVoiceInput, bool useVoiceOutput, bool detail_response, const VoiceInputOptions& voiceOptions) {
+    // A running transcription service (transcription_service.out serve) already has the model loaded:
+    // send it the turns instead of loading another copy. Without one, the calibrated model (ggml-base.bin if none)
+    std::unique_ptr<Transcriber> transcriber;
+    std::string socketPath = transcription_socket_path();
+    if (useVoiceInput && transcription_service_available(socketPath)) {
+        transcriber = Transcriber::remote([socketPath](const std::vector<float>& samples, TranscriptionResult& result) {
+            return transcribe_remote_pcm(samples, result, socketPath);
+        }, "audio.wav");
+        std::cout << "Using the transcription service at " << socketPath << "." << std::endl;
+    } else {
+        transcriber = std::make_unique<Transcriber>("", "audio.wav");
+    }
+    if (voiceOptions.denoise) transcriber->set_frontend(FrontEndConfig());
+    VadConfig vadConfig;
+    vadConfig.hangover_ms = voiceOptions.hangoverMs;
     std::cout << "Entering " << (mode == "chat" ? "Chat" : "AMFQ") << " Mode. Say or type 'exit' to quit." << std::endl;
 
+    std::unique_ptr<WakeListener> wakeListener;
+    if (!voiceOptions.wakePhrase.empty()) {
+        wakeListener = std::make_unique<WakeListener>(voiceOptions.wakePhrase, "", vadConfig);
+        if (!wakeListener->ready()) {
+            std::cerr << "Error: Could not load a whisper model for the wake phrase." << std::endl;
+            return;
+        }
+    }
+
+    // Saving opcions.json applies it from the next turn; an invalid edit keeps the previous version
+    ConfigWatcher configWatcher;
+
+    // With "preload" in opcions.json, the models this user usually needs now are loaded before the question
+    std::unique_ptr<ModelPreloader> preloader;
+    if (config().preload.enabled) {
+        preloader = std::make_unique<ModelPreloader>(request_pool().route(request_session()).front(), getuid(), config().preload);
+        preloader->start();
+    }
+
     std::string input;
+    std::thread speechThread; // at most one answer being synthesized at a time
+    bool waitingForSpeech = false; // the last listening window timed out: don't repeat the prompt
     while (true) {
-        std::cout << "You: ";
+        if (!waitingForSpeech) std::cout << "You: ";
+        TurnContext turn; // prepared while the user speaks (--speculative), reused for the request
         
         if (useVoiceInput) {
-            transcriber.start_microphone();
-            system("pkill aplay");
-            transcriber.stop_microphone();
-            input = transcriber.transcribe_audio();
+            std::unique_ptr<SpeculativePrefill> speculator;
+            if (voiceOptions.autoEndpoint) {
+                if (wakeListener) {
+                    std::cout << "💤 Say \"" << wakeListener->phrase() << "\"..." << std::endl;
+                    if (!wakeListener->wait_for_wake()) {
+                        std::cerr << "Error: Microphone capture failed." << std::endl;
+                        break;
+                    }
+                    audio_output().stop(); // the wake phrase also interrupts the last answer
+                }
+                // Keep listening while the last answer plays: talking over it cuts it (barge-in)
+                PlaybackMonitor playback;
+                playback.active = []() { return audio_output().busy(); };
+                playback.duck = []() { audio_output().set_gain(BARGE_IN_DUCK_GAIN); };
+                playback.stop = []() { audio_output().stop(); };
+                playback.restore = []() { audio_output().set_gain(1.0f); };
+                std::function<void(const std::string&)> onPartial = nullptr;
+                if (voiceOptions.speculative) {
+                    // Same model, options and history the real request will use
+                    turn = prepareTurn(mode, detail_response);
+                    if (turn.ok) {
+                        speculator = std::make_unique<SpeculativePrefill>(turn.model, turn.options, turn.historial,
+                                                                          turn.instruction);
+                        onPartial = [&speculator](const std::string& partial) {
+                            std::string text = partial;
+                            normalizeVoiceInput(text);
+                            speculator->on_partial(text);
+                        };
+                    }
+                }
+                Transcriber::RecordResult recorded = transcriber->record_until_silence(vadConfig, onPartial, &playback);
+                if (recorded == Transcriber::RecordResult::capture_failed) {
+                    std::cerr << "Error: Microphone capture failed." << std::endl;
+                    break;
+                }
+                if (recorded == Transcriber::RecordResult::no_speech) {
+                    // It times out every VAD_MAX_WAIT_MS, e.g. while a long answer plays: say it once
+                    if (!waitingForSpeech) std::cerr << "Error: No speech detected." << std::endl;
+                    waitingForSpeech = true;
+                    continue;
+                }
+                waitingForSpeech = false;
+            } else {
+                transcriber->start_microphone();
+                audio_output().stop();
+                transcriber->stop_microphone();
+            }
+            input = transcriber->transcribe_audio();
             
             if (input.empty()) {
                 std::cerr << "Error: Voice input failed." << std::endl;
                 continue;
             }
 
-            // Trim spaces, newlines, '.', and '!' from the input
-            input.erase(0, input.find_first_not_of(" \t\r\n.!")); // Trim left
-            input.erase(input.find_last_not_of(" \t\r\n.!") + 1); // Trim right
-            std::transform(input.begin(), input.end(), input.begin(), ::tolower);
+            normalizeVoiceInput(input);
+            if (transcriber->last_metrics().text_tokens == 0) {
+                std::cerr << "Error: No speech detected." << std::endl;
+                continue;
+            }
+            if (transcriber->last_metrics().low_confidence) {
+                // Better to ask again than to answer something the user did not say
+                std::cout << input << std::endl;
+                std::cerr << "⚠️ Low confidence transcription (" << static_cast<int>(transcriber->last_metrics().avg_token_p * 100)
+                          << "%), please repeat." << std::endl;
+                continue;
+            }
+            if (speculator) speculator->finish(input);
             
             std::cout << input << std::endl;
         } else {
@@ -198,28 +347,31 @@ void runMode(const std::string& mode, bool useVoiceInput, bool useVoiceOutput, b
         }
 
         if (input.find("exit") != std::string::npos) { 
-            system("pkill aplay");
             break;
         }
 
-        std::string response = getResponse(input, mode, detail_response);
+        std::string response = getResponse(input, mode, detail_response, turn.ok ? &turn : nullptr);
 
         // Handle voice output correctly
         if (useVoiceOutput) {
+            // A new answer replaces whatever is still playing
+            audio_output().stop();
+            if (speechThread.joinable()) speechThread.join();
             if (mode == "amfq") {
                 // If in AMFQ mode, wait for speak to finish
-                std::thread speechThread(speak, response);
-                speechThread.join();
+                speak(response, true);
             } else {
-                // If in chat mode, run speak in the background
-                std::thread(speak, response).detach();
+                // If in chat mode, synthesize in the background while the user types
+                speechThread = std::thread(speak, response, false);
             }
         }
 
         if (mode == "amfq") break;
     }
 
-    system("pkill aplay"); // Ensure aplay is stopped at the very end
+    // Normal exit: let the last answer finish instead of clipping its end (stop() is for barge-in)
+    if (speechThread.joinable()) speechThread.join();
+    audio_output().drain();
 }
 
 /*
@@ -232,10 +384,10 @@ void runMode(const std::string& mode, bool useVoiceInput, bool useVoiceOutput) {
         std::cout << "You: ";
         
         if (useVoiceInput) {
-            transcriber.start_microphone();
+            transcriber->start_microphone();
             system("pkill aplay");
-            transcriber.stop_microphone();
-            input = transcriber.transcribe_audio();
+            transcriber->stop_microphone();
+            input = transcriber->transcribe_audio();
             
             if (input.empty()) {
                 std::cerr << "Error: Voice input failed." << std::endl;
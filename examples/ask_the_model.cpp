@@ -1,9 +1,11 @@
-//copile with g++ -std=c++17 -fsanitize=undefined ask_the_model.cpp ../utilities/call_the_model.cpp -o amfq.out -g
+//copile with g++ -std=c++17 -fsanitize=undefined ask_the_model.cpp ../utilities/call_the_model.cpp ../utilities/stream_decoder.cpp ../utilities/request_policy.cpp ../utilities/config.cpp ../utilities/model_profiles.cpp ../utilities/model_preloader.cpp ../utilities/endpoint_pool.cpp ../utilities/metrics.cpp ../utilities/logging.cpp ../utilities/speech_normalizer.cpp -pthread -o amfq.out -g
 #include <iostream>
 #include <string>
 #include <vector>
 #include <cstring>
 #include "../utilities/call_the_model.hpp"  // Include your existing model call functions
+#include "../utilities/config.hpp"
+#include "../utilities/model_preloader.hpp"
 
 // Function to display help information
 void show_help();
@@ -25,10 +27,19 @@ int main(int argc, char* argv[]) {
     // Extract prompt and flags
     std::string prompt;
     bool detailed_response = false;
+    bool progressive = false;
+    double timeoutSeconds = 0.0;
+    double budgetSeconds = 0.0;
 
     for (int i = 1; i < argc; ++i) {
         if (std::strcmp(argv[i], "-d") == 0) {
             detailed_response = true;
+        } else if (std::strcmp(argv[i], "-p") == 0 || std::strcmp(argv[i], "--progressive") == 0) {
+            progressive = true;
+        } else if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            timeoutSeconds = std::stod(argv[++i]);
+        } else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            budgetSeconds = std::stod(argv[++i]);
         } else if (argv[i][0] != '-') { // Ignore other flags for now
             prompt += std::string(argv[i]) + " ";
         }
@@ -42,36 +53,85 @@ int main(int argc, char* argv[]) {
     std::string comand_dir = get_commands_directory();
     
     std::string historial_json = comand_dir+"/historial_test.json";  
-    std::string opciones_json = comand_dir+"/opcions.json";  
 
-    ollama::options opciones;
-    inicializar_opciones(opciones_json, opciones);
+    // opcions.json, ya validado
+    const Config &cfg = config();
+    const ollama::options &opciones = cfg.options;
 
     ollama::messages historial;
     inicializar_historial(historial_json, historial);
 
-    std::string modelo = opciones["model_fast_response"];
-    std::string initial_instruction = opciones["initial_intrucion"];
+    std::string modelo = cfg.model_fast_response;
+    std::string initial_instruction = cfg.initial_instruction;
 
-    // Adjust for detailed response if flag is set
-    if (detailed_response) {
-        initial_instruction = opciones["detail_initial_intrucion"];
-        modelo = opciones["model_chat_response"];
+    std::string detailed_model = cfg.model_chat_response;
+    std::string detailed_instruction = cfg.detail_instruction;
+
+    // Adjust for detailed response if flag is set (progressive mode asks both models anyway)
+    if (detailed_response && !progressive) {
+        initial_instruction = detailed_instruction;
+        modelo = detailed_model;
     }
 
     // Verify if Ollama server is running
     verificar_ollama(modelo);
+    if (progressive) verificar_ollama(detailed_model);
 
-    // Process the prompt and generate a response
-    obtener_respuesta(historial, modelo, opciones, initial_instruction, prompt, "user");
-    print_formatted_output(historial.back()["content"]);
+    // Process the prompt and generate a response; a deadline keeps scripts from waiting forever
+    // and the latency budget trades the detailed answer for a quick one when it runs late
+    ControlGeneracion control;
+    CtrlCCancela ctrlC(control);
+    control.presupuesto = latency_budget(detailed_response && !progressive ? "amfq_detail" : "amfq");
+    // Lo que aprende el precargador de modelos (model_preloader)
+    record_model_usage(control.presupuesto.mode, modelo);
+    if (progressive) record_model_usage("amfq_detail", detailed_model);
+    if (budgetSeconds > 0) control.presupuesto.total_s = budgetSeconds;
+    if (timeoutSeconds > 0) {
+        control.limite = std::chrono::steady_clock::now() +
+                         std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeoutSeconds));
+    }
+    FormattedStreamPrinter printer;
+    std::string respuesta;
+    auto on_text = [&printer, &respuesta](const std::string& texto, size_t inicio) {
+        printer.feed(texto, inicio);
+        if (inicio == 0) respuesta.clear();
+        respuesta.append(texto, inicio, std::string::npos);
+    };
+    EstadoRespuesta estado;
+    if (progressive) {
+        // The fast answer right away, the detailed one below it when it arrives; Ctrl+C keeps the fast one
+        RefinamientoProgresivo refinamiento(historial, modelo, detailed_model, opciones, initial_instruction, detailed_instruction, prompt, "user");
+        estado = refinamiento.rapida(on_text, &control);
+        printer.finish(respuesta);
+        if (estado != EstadoRespuesta::cancelada) {
+            std::cerr << "🔎 Refining with " << detailed_model << "... (Ctrl+C keeps this answer)\n";
+            if (refinamiento.esperar_detallada(&control)) {
+                std::cout << "\n🔎 Detailed answer:\n";
+                print_formatted_output(refinamiento.detallada());
+                estado = EstadoRespuesta::completa;
+            }
+        }
+    } else {
+        estado = obtener_respuesta_stream(historial, modelo, opciones, initial_instruction, prompt, "user", on_text, &control);
+        printer.finish(respuesta);
+    }
 
-    return 0;
+    if (estado == EstadoRespuesta::fuera_de_tiempo) {
+        if (timeoutSeconds > 0) std::cerr << "Error: No complete answer within " << timeoutSeconds << " s (partial answer shown).\n";
+        return 2;
+    }
+    if (estado == EstadoRespuesta::error) return 1;
+    return estado == EstadoRespuesta::completa ? 0 : 130;
 }
 
 inline void show_help() {
-    std::cout << "Usage: ./amfq [PROMPT] [-d] [--help]\n"
+    std::cout << "Usage: ./amfq [PROMPT] [-d | -p] [--timeout SECONDS] [--budget SECONDS] [--help]\n"
               << "  PROMPT    The question you want to ask the model.\n"
               << "  -d        Request a detailed response.\n"
+              << "  -p        Progressive: show the fast answer at once and the detailed one when it is\n"
+              << "            ready (--progressive). Ctrl+C while waiting keeps the fast answer.\n"
+              << "  --timeout Stop the answer after SECONDS and exit with status 2 (partial answer kept).\n"
+              << "  --budget  Latency budget in SECONDS for this question (overrides latency_budgets in\n"
+              << "            opcions.json): a late detailed answer is redone with the fast model.\n"
               << "  --help    Show this help message.\n";
 }
@@ -0,0 +1,57 @@
+//g++ -std=c++17 batch_transcribe.cpp ../utilities/transcriber.cpp ../utilities/wav_reader.cpp ../utilities/model_selector.cpp ../utilities/vad.cpp ../utilities/spectrum.cpp ../utilities/audio_capture.cpp ../utilities/audio_frontend.cpp ../utilities/metrics.cpp ../utilities/logging.cpp -I ../utilities/whisper.cpp/include -I ../utilities/whisper.cpp/ggml/include -L ../utilities/whisper.cpp/build/src -lwhisper -pthread -o batch_transcribe.out
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../utilities/transcriber.hpp"
+#include "../utilities/wav_reader.hpp"
+
+// Function to display help information
+void show_help();
+
+int main(int argc, char* argv[]) {
+    std::string output = "transcriptions.jsonl";
+    std::string model; // empty: calibrated choice
+    int nStates = 0;
+    bool denoise = false;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (std::strcmp(argv[i], "--states") == 0 && i + 1 < argc) {
+            nStates = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            model = argv[++i];
+        } else if (std::strcmp(argv[i], "--denoise") == 0) {
+            denoise = true;
+        } else {
+            collect_wav_inputs(argv[i], files);
+        }
+    }
+
+    if (files.empty()) {
+        std::cerr << "Error: No input files. Use --help for usage information.\n";
+        return 1;
+    }
+
+    Transcriber transcriber(model);
+    if (denoise) transcriber.set_frontend(FrontEndConfig());
+    int processed = transcriber.transcribe_batch(files, output, nStates);
+    std::cout << "✅ " << processed << " archivos transcritos (" << files.size() << " en total) -> " << output << std::endl;
+    return 0;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./batch_transcribe.out [DIR|LIST.txt|FILE.wav]... [-o OUT.jsonl] [--states N] [--model PATH] [--denoise]\n"
+              << "  DIR         Transcribe every .wav file in the directory.\n"
+              << "  LIST.txt    Transcribe the files listed one per line.\n"
+              << "  -o          JSONL output (default transcriptions.jsonl). Files already in it are skipped.\n"
+              << "  --states    Number of whisper states decoding in parallel (default: cores / 4).\n"
+              << "  --model     Whisper model to load once for the whole batch (default: calibrated choice).\n"
+              << "  --denoise   High-pass, noise reduction and gain control before decoding.\n"
+              << "  --help      Show this help message.\n";
+}
@@ -0,0 +1,263 @@
+//g++ -std=c++17 endpoint_pool.cpp ../utilities/call_the_model.cpp ../utilities/stream_decoder.cpp ../utilities/request_policy.cpp ../utilities/config.cpp ../utilities/model_profiles.cpp ../utilities/model_preloader.cpp ../utilities/endpoint_pool.cpp ../utilities/metrics.cpp ../utilities/logging.cpp ../utilities/speech_normalizer.cpp -pthread -o endpoint_pool.out
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../utilities/call_the_model.hpp"
+#include "../utilities/config.hpp"
+#include "../utilities/endpoint_pool.hpp"
+#include "../utilities/metrics.hpp"
+#include "../utilities/request_policy.hpp"
+
+#define DEMO_MOCKS          3       // Servidores simulados por defecto
+#define DEMO_BASE_PORT      11500   // Puerto del primero; los demás siguen
+#define DEMO_SESSIONS       24
+#define DEMO_TURNS          3       // Turnos por sesión en cada fase
+#define DEMO_WORKERS        16      // Peticiones a la vez de una misma sesión en la última fase
+
+// Function to display help information
+void show_help();
+
+// Servidor que responde como Ollama en /, /api/ps y /api/chat, con algo de latencia
+struct MockBackend {
+    int port = 0;
+    std::unique_ptr<httplib::Server> server;
+    std::thread thread;
+    std::atomic<int> requests{0};
+
+    void start() {
+        server = std::make_unique<httplib::Server>();
+        server->Get("/", [](const httplib::Request &, httplib::Response &res) {
+            res.set_content("Ollama is running", "text/plain");
+        });
+        server->Get("/api/ps", [](const httplib::Request &, httplib::Response &res) {
+            res.set_content("{\"models\":[{\"name\":\"mock\"}]}", "application/json");
+        });
+        server->Post("/api/chat", [this](const httplib::Request &, httplib::Response &res) {
+            static thread_local std::mt19937 rng(std::random_device{}());
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int>(2, 20)(rng)));
+            requests++;
+            res.set_content("{\"model\":\"mock\",\"message\":{\"role\":\"assistant\",\"content\":\"" + std::to_string(port) +
+                            "\"},\"done\":true}", "application/json");
+        });
+        httplib::Server *listening = server.get();
+        thread = std::thread([listening, this] { listening->listen("127.0.0.1", port); });
+        server->wait_until_ready();
+    }
+
+    void stop() {
+        if (!server) return;
+        server->stop();
+        if (thread.joinable()) thread.join();
+        server.reset();
+    }
+};
+
+// Peticiones recibidas por cada endpoint hasta ahora
+std::vector<long> served_counts() {
+    std::vector<long> served;
+    for (const EndpointStatus &endpoint : request_pool().status()) served.push_back(endpoint.served);
+    return served;
+}
+
+// Un turno por el mismo camino que amfq, chat y OVA: request_targets, reintentos y
+// cortocircuito en obtener_respuesta_stream. Devuelve el endpoint que respondió.
+std::string send_turn(const std::string &session, const std::string &model) {
+    std::vector<long> before = served_counts();
+    set_request_session(session);
+    ollama::messages historial;
+    EstadoRespuesta estado = obtener_respuesta_stream(historial, model, config().options, "", "hola", "user", nullptr);
+    if (estado != EstadoRespuesta::completa) return "";
+
+    // Respondió el que recibió la petición y sigue en pie; los que no conectaron quedan caídos
+    std::vector<EndpointStatus> after = request_pool().status();
+    for (size_t i = 0; i < after.size(); ++i) {
+        if (after[i].served > before[i] && after[i].healthy) return after[i].url;
+    }
+    return "";
+}
+
+// Endpoint que atiende cada sesión; "" si algún turno falló o cambió de endpoint a mitad
+std::map<std::string, std::string> run_sessions(int sessions, const std::string &model) {
+    std::map<std::string, std::string> homes;
+    for (int s = 0; s < sessions; ++s) {
+        std::string session = "sesion-" + std::to_string(s);
+        std::string first = send_turn(session, model);
+        for (int t = 1; t < DEMO_TURNS; ++t) {
+            if (send_turn(session, model) != first) first = "";
+        }
+        homes[session] = first;
+    }
+    return homes;
+}
+
+// Cuántas sesiones cambiaron de endpoint, y si alguna se movió sin que el suyo se fuera
+int count_moved(const std::map<std::string, std::string> &before, const std::map<std::string, std::string> &after,
+                const std::string &gone, bool &onlyFromGone) {
+    int moved = 0;
+    for (const auto &[session, home] : before) {
+        if (after.at(session) == home) continue;
+        moved++;
+        if (home != gone) onlyFromGone = false;
+    }
+    return moved;
+}
+
+bool all_served(const std::map<std::string, std::string> &homes) {
+    for (const auto &entry : homes) {
+        if (entry.second.empty()) return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    int mocks = DEMO_MOCKS;
+    int basePort = DEMO_BASE_PORT;
+    int sessions = DEMO_SESSIONS;
+    std::string model = "mock";
+    std::vector<std::string> urls;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "--mock") == 0 && i + 1 < argc) {
+            mocks = std::max(2, std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            basePort = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) {
+            sessions = std::max(1, std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--endpoints") == 0 && i + 1 < argc) {
+            std::stringstream list(argv[++i]);
+            for (std::string url; std::getline(list, url, ',');) urls.push_back(url);
+        } else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            model = argv[++i];
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << ". Use --help for usage information.\n";
+            return 1;
+        }
+    }
+
+    // Sin --endpoints: servidores simulados en puertos consecutivos
+    bool simulated = urls.empty();
+    std::vector<std::unique_ptr<MockBackend>> backends;
+    if (simulated) {
+        for (int m = 0; m < mocks; ++m) {
+            backends.push_back(std::make_unique<MockBackend>());
+            backends.back()->port = basePort + m;
+            backends.back()->start();
+            urls.push_back("http://127.0.0.1:" + std::to_string(basePort + m));
+        }
+    }
+
+    // La configuración que leerían los comandos de opcions.json, antes de crear el pool
+    Config settings;
+    settings.model = model;
+    settings.endpoints = urls;
+    set_config(settings);
+    EndpointPool &pool = request_pool();
+    bool ok = true;
+
+    // 1. Afinidad: todos los turnos de una sesión en el mismo endpoint
+    auto homes = run_sessions(sessions, model);
+    bool affinity = all_served(homes);
+    std::map<std::string, int> perEndpoint;
+    for (const auto &entry : homes) perEndpoint[entry.second]++;
+    std::cout << "Sesiones por endpoint:\n";
+    for (const std::string &url : urls) std::cout << "  " << url << "  " << perEndpoint[url] << "\n";
+    std::cout << "Afinidad (" << DEMO_TURNS << " turnos por sesión en el mismo endpoint): " << (affinity ? "ok" : "FALLO") << "\n";
+    ok = ok && affinity;
+
+    // 2. Un endpoint se va: solo sus sesiones cambian; 3. vuelve: regresan
+    int movedDown = 0, movedBack = 0;
+    bool onlyGone = true, returned = true;
+    if (simulated) {
+        backends[0]->stop();
+        auto failover = run_sessions(sessions, model);
+        movedDown = count_moved(homes, failover, urls[0], onlyGone);
+        std::cout << urls[0] << " parado: " << movedDown << " sesiones reubicadas, "
+                  << (onlyGone && all_served(failover) && movedDown == perEndpoint[urls[0]] ? "solo las suyas" : "FALLO") << "\n";
+        ok = ok && onlyGone && all_served(failover) && movedDown == perEndpoint[urls[0]];
+
+        backends[0]->start();
+        pool.check_health(); // Sin esperar a la comprobación periódica
+        auto back = run_sessions(sessions, model);
+        bool unused = true;
+        movedBack = count_moved(failover, back, urls[0], unused);
+        returned = back == homes;
+        std::cout << urls[0] << " de vuelta: " << movedBack << " sesiones regresan, " << (returned ? "ok" : "FALLO") << "\n";
+        ok = ok && returned;
+    }
+
+    // 4. Drenar otro endpoint por mantenimiento, con "drain" como en opcions.json
+    const std::string &drained = urls[urls.size() > 1 ? 1 : 0];
+    settings.drain = {drained};
+    set_config(settings);
+    auto drainedHomes = run_sessions(sessions, model);
+    bool onlyDrained = true;
+    int movedDrain = count_moved(homes, drainedHomes, drained, onlyDrained);
+    settings.drain.clear();
+    set_config(settings);
+    std::cout << drained << " drenado: " << movedDrain << " sesiones reubicadas, " << (onlyDrained ? "solo las suyas" : "FALLO") << "\n";
+    ok = ok && onlyDrained && all_served(drainedHomes);
+
+    // 5. Muchas peticiones a la vez de una sesión: la carga acotada manda parte al siguiente
+    std::vector<long> before = served_counts();
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int w = 0; w < DEMO_WORKERS; ++w) {
+        workers.emplace_back([&] {
+            for (int r = 0; r < sessions * DEMO_TURNS / DEMO_WORKERS; ++r) send_turn("sesion-0", model);
+        });
+    }
+    for (std::thread &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::vector<long> after = served_counts();
+    long most = 0, least = 1L << 30;
+    for (size_t i = 0; i < after.size(); ++i) {
+        most = std::max(most, after[i] - before[i]);
+        least = std::min(least, after[i] - before[i]);
+    }
+    std::cout << "Una sesión con " << DEMO_WORKERS << " peticiones a la vez: entre " << least << " y " << most
+              << " por endpoint en " << seconds << " s\n";
+
+    pool.stop_health_checks();
+    for (auto &backend : backends) backend->stop();
+
+    record_metric("endpoint_pool", {
+        {"endpoints", urls.size()},
+        {"sessions", sessions},
+        {"affinity", affinity},
+        {"moved_on_failure", movedDown},
+        {"returned", returned},
+        {"moved_on_drain", movedDrain},
+        {"rehomed", pool.rehomed()},
+        {"bounded_load_min", least},
+        {"bounded_load_max", most},
+        {"ok", ok},
+    });
+    std::cout << (ok ? "Todo correcto" : "Hay fallos") << "\n";
+    return ok ? 0 : 1;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./endpoint_pool.out [--mock N] [--port P] [--sessions S] [--endpoints URL,URL] [--model M]\n"
+              << "  --mock       Number of simulated Ollama servers (default " << DEMO_MOCKS << ").\n"
+              << "  --port       Port of the first simulated server (default " << DEMO_BASE_PORT << ").\n"
+              << "  --sessions   Sessions to route (default " << DEMO_SESSIONS << ").\n"
+              << "  --endpoints  Use real servers instead of simulated ones (skips the stop/restart phase).\n"
+              << "  --model      Model to ask on real servers (default mock).\n"
+              << "  --help       Show this help message.\n"
+              << "Sends every turn through obtener_respuesta_stream, as amfq, chat and OVA do, and\n"
+              << "checks that every turn of a session reaches the same server, that stopping it or\n"
+              << "listing it under \"drain\" moves only its sessions, that they return when it comes\n"
+              << "back, and how concurrent requests of one session spill over to the next server.\n"
+              << "Load is counted per process. Summary in logs/metrics.jsonl.\n";
+}
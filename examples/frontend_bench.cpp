@@ -0,0 +1,156 @@
+//g++ -std=c++17 -O3 -march=native -fno-math-errno frontend_bench.cpp ../utilities/audio_frontend.cpp ../utilities/transcriber.cpp ../utilities/wav_reader.cpp ../utilities/model_selector.cpp ../utilities/vad.cpp ../utilities/spectrum.cpp ../utilities/audio_capture.cpp ../utilities/metrics.cpp ../utilities/logging.cpp -I ../utilities/whisper.cpp/include -I ../utilities/whisper.cpp/ggml/include -L ../utilities/whisper.cpp/build/src -lwhisper -pthread -o frontend_bench.out
+#include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+#include "../utilities/audio_frontend.hpp"
+#include "../utilities/metrics.hpp"
+#include "../utilities/transcriber.hpp"
+#include "../utilities/wav_reader.hpp"
+
+#define BENCH_REPEATS 5 // Pasadas del front end por archivo para medir su coste
+
+// Function to display help information
+void show_help();
+
+// Sin archivos: 10 s de tono con zumbido y ruido blanco, para medir solo el coste
+std::vector<float> synthetic_audio() {
+    std::vector<float> samples(10 * WHISPER_SAMPLE_RATE);
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 0.02f);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float t = static_cast<float>(i) / WHISPER_SAMPLE_RATE;
+        samples[i] = 0.1f * std::sin(2.0f * static_cast<float>(M_PI) * 220.0f * t) +
+                     0.05f * std::sin(2.0f * static_cast<float>(M_PI) * 50.0f * t) + 0.01f + noise(rng);
+    }
+    return samples;
+}
+
+// CPU de cada etapa por segundo de audio, repitiendo sobre una copia
+void measure_cost(const std::vector<float> &samples, const FrontEndConfig &config,
+                  FrontEndTimings &timings, double &cpuSeconds, double &audioSeconds) {
+    for (int r = 0; r < BENCH_REPEATS; ++r) {
+        std::vector<float> copy = samples;
+        double cpuStart = thread_cpu_seconds();
+        preprocess_audio(copy, config, WHISPER_SAMPLE_RATE, &timings);
+        cpuSeconds += thread_cpu_seconds() - cpuStart;
+        audioSeconds += static_cast<double>(samples.size()) / WHISPER_SAMPLE_RATE;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string model; // empty: calibrated choice
+    bool costOnly = false;
+    FrontEndConfig config;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            model = argv[++i];
+        } else if (std::strcmp(argv[i], "--cost-only") == 0) {
+            costOnly = true;
+        } else if (std::strcmp(argv[i], "--no-highpass") == 0) {
+            config.highpass = false;
+        } else if (std::strcmp(argv[i], "--no-denoise") == 0) {
+            config.denoise = false;
+        } else if (std::strcmp(argv[i], "--no-agc") == 0) {
+            config.agc = false;
+        } else {
+            collect_wav_inputs(argv[i], files);
+        }
+    }
+
+    // 1. Coste del front end
+    FrontEndTimings timings;
+    double cpuSeconds = 0.0, audioSeconds = 0.0;
+    if (files.empty()) {
+        measure_cost(synthetic_audio(), config, timings, cpuSeconds, audioSeconds);
+    }
+    for (const std::string &file : files) {
+        WavReader reader;
+        if (!reader.open(file)) {
+            std::cerr << "❌ " << reader.error() << std::endl;
+            continue;
+        }
+        measure_cost(reader.read_all(), config, timings, cpuSeconds, audioSeconds);
+    }
+    if (audioSeconds <= 0.0) {
+        std::cerr << "Error: No audio to process. Use --help for usage information.\n";
+        return 1;
+    }
+
+    auto perSecondMs = [&](double seconds) { return 1000.0 * seconds / audioSeconds; };
+    printf("Front end over %.1f s of audio (x%d):\n", audioSeconds / BENCH_REPEATS, BENCH_REPEATS);
+    printf("  highpass  %7.3f ms per audio second\n", perSecondMs(timings.highpass_s));
+    printf("  denoise   %7.3f ms per audio second\n", perSecondMs(timings.denoise_s));
+    printf("  agc       %7.3f ms per audio second\n", perSecondMs(timings.agc_s));
+    printf("  total CPU %7.3f ms per audio second (%.3f%% of one core)\n",
+           perSecondMs(cpuSeconds), 100.0 * cpuSeconds / audioSeconds);
+
+    nlohmann::json metric = {
+        {"audio_s", audioSeconds / BENCH_REPEATS},
+        {"highpass_ms_per_s", perSecondMs(timings.highpass_s)},
+        {"denoise_ms_per_s", perSecondMs(timings.denoise_s)},
+        {"agc_ms_per_s", perSecondMs(timings.agc_s)},
+        {"cpu_ms_per_s", perSecondMs(cpuSeconds)},
+    };
+
+    // 2. Efecto sobre la decodificación: mismo archivo sin y con preprocesado
+    if (!costOnly && !files.empty()) {
+        Transcriber transcriber(model);
+        transcriber.transcribe_file(files.front()); // warm-up: the first decode pays the allocations
+
+        double rawDecode = 0.0, processedDecode = 0.0, totalAudio = 0.0;
+        int rawFallbacks = 0, processedFallbacks = 0, changed = 0;
+        printf("\n%-40s %10s %10s %6s %6s\n", "file", "raw s", "front s", "fb", "fb'");
+        for (const std::string &file : files) {
+            transcriber.disable_frontend();
+            TranscriptionResult raw = transcriber.transcribe_file(file);
+            transcriber.set_frontend(config);
+            TranscriptionResult processed = transcriber.transcribe_file(file);
+            if (!raw.ok || !processed.ok) continue;
+
+            rawDecode += raw.processing_seconds;
+            processedDecode += processed.processing_seconds;
+            totalAudio += raw.audio_seconds;
+            rawFallbacks += raw.fallbacks;
+            processedFallbacks += processed.fallbacks;
+            if (raw.text != processed.text) changed++;
+            printf("%-40s %10.3f %10.3f %6d %6d\n", std::filesystem::path(file).filename().string().c_str(),
+                   raw.processing_seconds, processed.processing_seconds, raw.fallbacks, processed.fallbacks);
+        }
+
+        if (totalAudio > 0.0) {
+            printf("\nDecode RTF   raw %.3f -> front end %.3f\n", rawDecode / totalAudio, processedDecode / totalAudio);
+            printf("Fallbacks    raw %d -> front end %d\n", rawFallbacks, processedFallbacks);
+            printf("Transcripts changed: %d of %zu\n", changed, files.size());
+            metric["files"] = files.size();
+            metric["rtf_raw"] = rawDecode / totalAudio;
+            metric["rtf_frontend"] = processedDecode / totalAudio;
+            metric["fallbacks_raw"] = rawFallbacks;
+            metric["fallbacks_frontend"] = processedFallbacks;
+            metric["transcripts_changed"] = changed;
+        }
+    }
+
+    record_metric("frontend_bench", metric);
+    return 0;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./frontend_bench.out [DIR|LIST.txt|FILE.wav]... [--model PATH] [--cost-only] [--no-highpass] [--no-denoise] [--no-agc]\n"
+              << "  DIR           Recorded test set: every .wav file in the directory.\n"
+              << "  LIST.txt      Files listed one per line.\n"
+              << "  --model       Whisper model for the decode comparison (default: calibrated choice).\n"
+              << "  --cost-only   Only measure the front end CPU cost (synthetic audio if no files).\n"
+              << "  --no-*        Disable one stage of the front end.\n"
+              << "  --help        Show this help message.\n"
+              << "Results are also appended to logs/metrics.jsonl as a \"frontend_bench\" event.\n";
+}
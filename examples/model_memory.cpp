@@ -0,0 +1,127 @@
+//g++ -std=c++17 model_memory.cpp ../utilities/transcriber.cpp ../utilities/wav_reader.cpp ../utilities/model_selector.cpp ../utilities/vad.cpp ../utilities/spectrum.cpp ../utilities/audio_capture.cpp ../utilities/audio_frontend.cpp ../utilities/metrics.cpp ../utilities/logging.cpp -I ../utilities/whisper.cpp/include -I ../utilities/whisper.cpp/ggml/include -L ../utilities/whisper.cpp/build/src -lwhisper -pthread -o model_memory.out
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../utilities/metrics.hpp"
+#include "../utilities/transcriber.hpp"
+
+// Function to display help information
+void show_help();
+
+// Memoria disponible en todo el sistema (kB), para medir lo que cuesta cada proceso extra
+long mem_available_kb() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    long kb = 0;
+    std::string unit;
+    while (meminfo >> key >> kb >> unit) {
+        if (key == "MemAvailable:") return kb;
+    }
+    return 0;
+}
+
+struct LoaderReport {
+    double load_s = 0.0;
+    ResidentMemory memory;
+};
+
+// Hijo: carga el modelo, informa por el pipe y espera a que el padre cierre "release"
+void run_loader(const std::string &model, int reportFd, int releaseFd) {
+    auto start = std::chrono::steady_clock::now();
+    Transcriber transcriber(model, "audio.wav");
+    LoaderReport report;
+    report.load_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    report.memory = resident_memory();
+    if (write(reportFd, &report, sizeof(report)) != sizeof(report)) _exit(1);
+
+    char byte;
+    while (read(releaseFd, &byte, 1) > 0) {}
+    _exit(0);
+}
+
+int main(int argc, char* argv[]) {
+    std::string model; // empty: calibrated choice
+    int processes = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            processes = std::max(1, std::stoi(argv[++i]));
+        } else {
+            model = argv[i];
+        }
+    }
+
+    int reportPipe[2], releasePipe[2];
+    if (pipe(reportPipe) != 0 || pipe(releasePipe) != 0) {
+        std::cerr << "Error: pipe() failed." << std::endl;
+        return 1;
+    }
+
+    // Cada proceso se carga después del anterior, como usuarios que arrancan ova uno tras otro
+    std::vector<pid_t> children;
+    std::vector<LoaderReport> reports;
+    std::vector<long> available{mem_available_kb()};
+    for (int p = 0; p < processes; ++p) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(reportPipe[0]);
+            close(releasePipe[1]);
+            run_loader(model, reportPipe[1], releasePipe[0]);
+        }
+        if (pid < 0) break;
+        children.push_back(pid);
+
+        LoaderReport report;
+        if (read(reportPipe[0], &report, sizeof(report)) != sizeof(report)) {
+            std::cerr << "Error: Loader " << p << " did not report (see logs/whisper.log)." << std::endl;
+            break;
+        }
+        reports.push_back(report);
+        available.push_back(mem_available_kb());
+    }
+
+    printf("%-8s %9s %11s %11s %11s %13s\n", "process", "load s", "RSS MB", "private MB", "file MB", "system -MB");
+    for (size_t p = 0; p < reports.size(); ++p) {
+        const ResidentMemory &m = reports[p].memory;
+        printf("%-8zu %9.3f %11.1f %11.1f %11.1f %13.1f\n", p + 1, reports[p].load_s, m.total_kb / 1024.0,
+               m.anon_kb / 1024.0, m.file_kb / 1024.0, (available[p] - available[p + 1]) / 1024.0);
+    }
+    if (reports.size() > 1) {
+        // The first process also pulls the file into the page cache; the rest show the real marginal cost
+        double extra = (available[1] - available.back()) / 1024.0 / (reports.size() - 1);
+        printf("\nMemory per extra process: %.1f MB\n", extra);
+        record_metric("model_memory", {
+            {"model", model},
+            {"processes", reports.size()},
+            {"first_load_s", reports.front().load_s},
+            {"last_load_s", reports.back().load_s},
+            {"rss_kb", reports.back().memory.total_kb},
+            {"rss_anon_kb", reports.back().memory.anon_kb},
+            {"extra_process_kb", extra * 1024.0},
+        });
+    }
+
+    close(releasePipe[1]);
+    for (pid_t pid : children) waitpid(pid, nullptr, 0);
+    return 0;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./model_memory.out [MODEL.bin] [-n PROCESSES]\n"
+              << "  MODEL.bin   Whisper model to load (default: calibrated choice).\n"
+              << "  -n          Number of processes to start, each loading the model after the previous\n"
+              << "              one has finished and keeping it loaded until the end (default 3).\n"
+              << "  --help      Show this help message.\n"
+              << "Prints load time and resident memory per process and the drop in MemAvailable\n"
+              << "each extra process causes; the summary is appended to logs/metrics.jsonl.\n";
+}
@@ -0,0 +1,97 @@
+//g++ -std=c++17 model_preloader.cpp ../utilities/model_preloader.cpp ../utilities/config.cpp ../utilities/model_profiles.cpp ../utilities/call_the_model.cpp ../utilities/stream_decoder.cpp ../utilities/request_policy.cpp ../utilities/endpoint_pool.cpp ../utilities/metrics.cpp ../utilities/logging.cpp ../utilities/speech_normalizer.cpp -pthread -o model_preloader.out
+#include <iostream>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../utilities/call_the_model.hpp"
+#include "../utilities/config.hpp"
+#include "../utilities/model_preloader.hpp"
+#include "../utilities/model_profiles.hpp"
+
+// Function to display help information
+void show_help();
+
+int main(int argc, char* argv[]) {
+    std::string endpoint;
+    bool once = false, status = false;
+    int interval = 0;
+    long memory = -1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (std::strcmp(argv[i], "--status") == 0) {
+            status = true;
+        } else if (std::strcmp(argv[i], "--endpoint") == 0 && i + 1 < argc) {
+            endpoint = argv[++i];
+        } else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = std::max(1, std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--memory-mb") == 0 && i + 1 < argc) {
+            memory = std::stol(argv[++i]);
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << ". Use --help for usage information.\n";
+            return 1;
+        }
+    }
+
+    // logs/ y opcions.json se buscan junto a los comandos, se arranque desde donde se arranque
+    if (chdir(get_commands_directory().c_str()) != 0) {
+        std::cerr << "Error: No se pudo entrar en " << get_commands_directory() << std::endl;
+        return 1;
+    }
+    // Las opciones de la línea de comandos mandan sobre "preload" de opcions.json
+    PreloadConfig settings = config().preload;
+    if (interval > 0) settings.interval_s = interval;
+    if (memory >= 0) settings.memory_mb = memory;
+
+    // El mismo servidor al que irán las preguntas de este usuario
+    if (endpoint.empty()) endpoint = request_pool().route(request_session()).front();
+    ModelPreloader preloader(endpoint, getuid(), settings);
+
+    if (status) {
+        std::vector<PreloadCandidate> candidates = preloader.predictions();
+        if (candidates.empty()) std::cout << "Nothing to preload right now.\n";
+        for (const PreloadCandidate &candidate : candidates) {
+            printf("%-28s %-24s %6.2f  %s\n", candidate.model.c_str(), base_model(candidate.model).c_str(), candidate.score, candidate.reason.c_str());
+        }
+        return 0;
+    }
+    if (once) {
+        for (const std::string &model : preloader.run_once()) std::cout << "✅ Loaded " << model << "\n";
+        return 0;
+    }
+
+    // SIGINT/SIGTERM only wake sigwait, so the preloader stops between loads
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    preloader.start();
+    std::cout << "✅ Preloading models on " << endpoint << " every " << settings.interval_s << " s. Ctrl+C to stop." << std::endl;
+    int received = 0;
+    sigwait(&signals, &received);
+    preloader.stop();
+    return 0;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./model_preloader.out [--once | --status] [--endpoint URL] [--interval S] [--memory-mb MB]\n"
+              << "  --once       Check and preload once, then exit (for cron or a systemd timer).\n"
+              << "  --status     Print what would be preloaded now and why, without loading anything.\n"
+              << "  --endpoint   Ollama server (default: the one this user's questions go to).\n"
+              << "  --interval   Seconds between checks (default " << PRELOAD_INTERVAL_S << ", or preload.interval_s).\n"
+              << "  --memory-mb  Most memory the loaded models may use together (default: free memory only).\n"
+              << "  --help       Show this help message.\n"
+              << "Learns from logs/model_usage.jsonl which models this user asks for at this time of day\n"
+              << "and after the command just used, and loads them before the question arrives. It only\n"
+              << "loads what fits without making Ollama unload another model, and never unloads any.\n";
+}
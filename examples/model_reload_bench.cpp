@@ -0,0 +1,116 @@
+//g++ -std=c++17 model_reload_bench.cpp ../utilities/model_profiles.cpp ../utilities/call_the_model.cpp ../utilities/stream_decoder.cpp ../utilities/request_policy.cpp ../utilities/config.cpp ../utilities/endpoint_pool.cpp ../utilities/metrics.cpp ../utilities/logging.cpp ../utilities/speech_normalizer.cpp -pthread -o model_reload_bench.out
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../utilities/metrics.hpp"
+#include "../utilities/model_profiles.hpp"
+#include "../utilities/ollama.hpp"
+
+#define BENCH_ROUNDS        3       // Vueltas por la secuencia de modos
+#define BENCH_NUM_PREDICT   8       // Lo justo para que conteste: aquí interesa la carga, no la respuesta
+
+// Function to display help information
+void show_help();
+
+int main(int argc, char* argv[]) {
+    int rounds = BENCH_ROUNDS;
+    bool legacy = false;
+    std::string endpoint = "http://localhost:11434";
+    // Lo que piden amfq, amfq -d y chat -d
+    std::vector<std::string> models = {"fast_response", "chat_response", "chat_response_unrestricted"};
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "--legacy") == 0) {
+            legacy = true;
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            rounds = std::max(1, std::stoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--endpoint") == 0 && i + 1 < argc) {
+            endpoint = argv[++i];
+        } else if (std::strcmp(argv[i], "--models") == 0 && i + 1 < argc) {
+            models.clear();
+            std::stringstream list(argv[++i]);
+            for (std::string model; std::getline(list, model, ',');) models.push_back(model);
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << ". Use --help for usage information.\n";
+            return 1;
+        }
+    }
+    if (legacy) {
+        // Los modelos que creaba restart_server.sh, uno por MODELFILE
+        for (std::string &model : models) {
+            if (model == "fast_response") model = "fast_response_assistant";
+            else if (model == "chat_response") model = "chat_response_assistant";
+        }
+    }
+
+    Ollama client(endpoint);
+    int loads = 0, failures = 0;
+    double stall = 0.0, wall = 0.0;
+    printf("%-28s %-24s %9s %9s\n", "model", "loaded", "load s", "total s");
+    for (int round = 0; round < rounds; ++round) {
+        for (const std::string &model : models) {
+            ollama::messages messages = {ollama::message("user", "Say hi.")};
+            ollama::options options;
+            options["num_predict"] = BENCH_NUM_PREDICT;
+            ollama::request request(model, messages, options, false);
+            // Con --legacy cada nombre es un modelo del servidor, como antes
+            if (!legacy) apply_model_profile(request);
+
+            auto start = std::chrono::steady_clock::now();
+            double load = 0.0;
+            try {
+                ollama::response response = client.chat(request);
+                load = response.as_json().value("load_duration", int64_t(0)) / 1e9;
+            } catch (const std::exception &e) {
+                std::cerr << "❌ " << model << ": " << e.what() << "\n";
+                failures++;
+                continue;
+            }
+            double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("%-28s %-24s %9.3f %9.3f\n", model.c_str(), request["model"].get<std::string>().c_str(), load, total);
+
+            // La primera petición carga el modelo en cualquier caso; lo que importa son las recargas
+            bool first = round == 0 && &model == &models.front();
+            if (!first && load * 1000 >= PROFILE_RELOAD_MS) {
+                loads++;
+                stall += load;
+            }
+            wall += total;
+        }
+    }
+
+    int requests = rounds * static_cast<int>(models.size());
+    printf("\n%s: %d reloads in %d requests, %.1f s waiting for loads of %.1f s total\n",
+           legacy ? "Separate models" : "Profiles", loads, requests - 1, stall, wall);
+    record_metric("model_reload_bench", {
+        {"mode", legacy ? "legacy" : "profiles"},
+        {"endpoint", endpoint},
+        {"requests", requests},
+        {"failures", failures},
+        {"reloads", loads},
+        {"reload_s", stall},
+        {"total_s", wall},
+    });
+    return failures == 0 ? 0 : 1;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./model_reload_bench.out [--legacy] [-n ROUNDS] [--endpoint URL] [--models A,B,C]\n"
+              << "  --legacy    Ask the separate models the old restart_server.sh created\n"
+              << "              (fast_response_assistant, ...) instead of the profiles.\n"
+              << "  -n          Rounds through the model sequence (default " << BENCH_ROUNDS << ").\n"
+              << "  --endpoint  Ollama server (default http://localhost:11434).\n"
+              << "  --models    Sequence to cycle (default fast_response,chat_response,chat_response_unrestricted,\n"
+              << "              what amfq, amfq -d and chat -d ask for).\n"
+              << "  --help      Show this help message.\n"
+              << "Switches between modes the way a user does and counts the requests whose\n"
+              << "load_duration shows the server loading a model (over " << PROFILE_RELOAD_MS << " ms). Run it with\n"
+              << "--legacy and without to compare; the summary goes to logs/metrics.jsonl.\n";
+}
@@ -1,14 +1,20 @@
-//compile with g++ -std=c++17 -fsanitize=undefined speak_with_the_model.cpp ../utilities/call_the_model.cpp -o chat.out -g
+//compile with g++ -std=c++17 -fsanitize=undefined speak_with_the_model.cpp ../utilities/call_the_model.cpp ../utilities/stream_decoder.cpp ../utilities/request_policy.cpp ../utilities/config.cpp ../utilities/model_profiles.cpp ../utilities/model_preloader.cpp ../utilities/endpoint_pool.cpp ../utilities/metrics.cpp ../utilities/logging.cpp ../utilities/speech_normalizer.cpp -pthread -o chat.out -g
 #include <iostream>
+#include <poll.h>
+#include <unistd.h>
 #include "../utilities/call_the_model.hpp"  // Incluir el header
+#include "../utilities/config.hpp"
+#include "../utilities/model_preloader.hpp"
 
 // Function to display help information
 void show_help();
+bool siguiente_pregunta_escrita();
 
 int main(int argc, char* argv[]) {
 
     // Check for help or detailed flag
     bool detailed_response = false;
+    bool progresivo = false;
 
     
     for (int i = 1; i < argc; ++i) {
@@ -17,6 +23,8 @@ int main(int argc, char* argv[]) {
             return 0;
         } else if (std::strcmp(argv[i], "-d") == 0) {
             detailed_response = true;
+        } else if (std::strcmp(argv[i], "-p") == 0) {
+            progresivo = true;
         } else {
             std::cerr << "Invalid argument: " << argv[i] << "\n";
             show_help();
@@ -26,25 +34,16 @@ int main(int argc, char* argv[]) {
     std::string comand_dir = get_commands_directory();
     
     std::string historial_json = comand_dir+"/historial_test.json";  
-    std::string opciones_json = comand_dir+"/opcions.json";  
-
-    ollama::options opciones;
-    inicializar_opciones(opciones_json, opciones);
 
     ollama::messages historial;
     inicializar_historial(historial_json, historial);
 
-    std::string modelo = opciones["model_chat_response"];
-    std::string initial_instruction = opciones["initial_intrucion"];
-
-    // Adjust for detailed response if flag is set
-    if (detailed_response) {
-        initial_instruction = opciones["detail_initial_intrucion"];
-        std::string modelo = opciones["model_chat_response_unrestricted"];
-
-    }
+    // opcions.json se recarga al guardarlo; cada pregunta usa la última versión válida
+    ConfigWatcher recarga;
 
-    verificar_ollama(modelo);
+    const Config &inicial = config();
+    verificar_ollama(progresivo ? inicial.model_fast_response : detailed_response ? inicial.model_chat_response_unrestricted : inicial.model_chat_response);
+    if (progresivo) verificar_ollama(inicial.model_chat_response);
 
     while (true) {
         std::string prompt;
@@ -56,17 +55,80 @@ int main(int argc, char* argv[]) {
             break;
         }
 
-        obtener_respuesta(historial, modelo, opciones, initial_instruction, prompt, "user");
-        print_formatted_output(historial.back()["content"]);
+        const Config &cfg = config();
+        const ollama::options &opciones = cfg.options;
+        std::string modelo = cfg.model_chat_response;
+        std::string initial_instruction = cfg.initial_instruction;
+
+        // Adjust for detailed response if flag is set
+        if (detailed_response) {
+            initial_instruction = cfg.detail_instruction;
+            modelo = cfg.model_chat_response_unrestricted;
+        }
+
+        // -p: el modelo rápido responde enseguida y el detallado, si llega a tiempo, lo amplía
+        const std::string &modelo_rapido = cfg.model_fast_response;
+        const std::string &modelo_detallado = cfg.model_chat_response;
+        const std::string &instruccion_rapida = cfg.initial_instruction;
+        const std::string &instruccion_detallada = cfg.detail_instruction;
+
+        // Ctrl+C corta la respuesta en curso; la sesión y el historial siguen
+        ControlGeneracion control;
+        CtrlCCancela ctrlC(control);
+        control.presupuesto = latency_budget(detailed_response && !progresivo ? "chat_detail" : "chat");
+        record_model_usage(control.presupuesto.mode, modelo);
+        if (progresivo) record_model_usage("chat_detail", modelo_detallado);
+        FormattedStreamPrinter printer;
+        std::string respuesta;
+        auto on_text = [&printer, &respuesta](const std::string& texto, size_t inicio) {
+            printer.feed(texto, inicio);
+            if (inicio == 0) respuesta.clear();
+            respuesta.append(texto, inicio, std::string::npos);
+        };
+        EstadoRespuesta estado;
+        if (progresivo) {
+            RefinamientoProgresivo refinamiento(historial, modelo_rapido, modelo_detallado, opciones,
+                                                instruccion_rapida, instruccion_detallada, prompt, "user");
+            estado = refinamiento.rapida(on_text, &control);
+            printer.finish(respuesta);
+            if (estado != EstadoRespuesta::cancelada) {
+                // Escribir la siguiente pregunta descarta la detallada; la línea queda para getline.
+                // Con stdin redirigido poll() avisa siempre (hay datos o EOF): se espera a la detallada
+                bool terminal = isatty(STDIN_FILENO);
+                std::cout << "🔎 Ampliando con " << modelo_detallado
+                          << (terminal ? "... (escribe tu siguiente pregunta para seguir)\n" : "...\n");
+                if (terminal) control.comprobar = siguiente_pregunta_escrita;
+                if (refinamiento.esperar_detallada(&control)) {
+                    std::cout << "\n🔎 Respuesta detallada:\n";
+                    print_formatted_output(refinamiento.detallada());
+                    estado = EstadoRespuesta::completa;
+                }
+            }
+        } else {
+            estado = obtener_respuesta_stream(historial, modelo, opciones, initial_instruction, prompt, "user", on_text, &control);
+            printer.finish(respuesta);
+        }
+        if (estado != EstadoRespuesta::completa && !(estado == EstadoRespuesta::error && respuesta.empty())) {
+            std::cout << "⏹️ Respuesta interrumpida.\n";
+        }
     }
 
 
     return 0;
 }
 
+// Hay una línea entera esperando en stdin (la terminal la entrega al pulsar Enter)
+bool siguiente_pregunta_escrita() {
+    struct pollfd entrada = {STDIN_FILENO, POLLIN, 0};
+    return poll(&entrada, 1, 0) > 0;
+}
+
 inline void show_help() {
-    std::cout << "Usage: ./session_chat [-d]\n"
+    std::cout << "Usage: ./session_chat [-d] [-p]\n"
               << "  -d        Start the session with detailed responses.\n"
+              << "  -p        Progressive: the fast model answers at once and the detailed model's answer\n"
+              << "            follows when ready, unless you type the next question first.\n"
+              << "  Ctrl+C stops the answer being generated without leaving the session.\n"
               << "  --help    Show this help message.\n";
 }
 
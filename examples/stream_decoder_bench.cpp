@@ -0,0 +1,201 @@
+//g++ -std=c++17 -O2 stream_decoder_bench.cpp ../utilities/stream_decoder.cpp ../utilities/metrics.cpp ../utilities/logging.cpp -pthread -o stream_decoder_bench.out
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <numeric>
+#include <string>
+#include <vector>
+#include "../utilities/json.hpp"
+#include "../utilities/metrics.hpp"
+#include "../utilities/ollama.hpp"
+#include "../utilities/stream_decoder.hpp"
+
+#define BENCH_TOKENS 20000  // Líneas NDJSON por pasada
+#define BENCH_REPEATS 5     // Pasadas por decodificador; se informa la mejor
+
+// Cuenta todas las reservas de memoria del proceso para poder medir las de cada ruta.
+// GCC cree que el free() de abajo no corresponde con el new reemplazado; es un falso positivo.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// Function to display help information
+void show_help();
+
+// Respuesta sintética con la forma de /api/chat en streaming: una línea por token y una
+// línea final con los contadores
+std::vector<std::string> make_stream(size_t tokens) {
+    static const char *words[] = {"El", " modelo", " responde", " con", " \\\"comillas\\\"", " y", " acentos:",
+                                  " canción", " \\u00f1and\\u00fa", ".\\n", " 42", " tokens"};
+    std::vector<std::string> lines;
+    lines.reserve(tokens + 1);
+    for (size_t t = 0; t < tokens; ++t) {
+        lines.push_back(std::string("{\"model\":\"llama3.2\",\"created_at\":\"2025-03-01T10:00:00.123456Z\","
+                                    "\"message\":{\"role\":\"assistant\",\"content\":\"") +
+                        words[t % (sizeof(words) / sizeof(words[0]))] + "\"},\"done\":false}\n");
+    }
+    lines.push_back("{\"model\":\"llama3.2\",\"created_at\":\"2025-03-01T10:00:09.000000Z\","
+                    "\"message\":{\"role\":\"assistant\",\"content\":\"\"},\"done_reason\":\"stop\",\"done\":true,"
+                    "\"total_duration\":9000000000,\"load_duration\":12000000,\"prompt_eval_count\":31,"
+                    "\"prompt_eval_duration\":80000000,\"eval_count\":" + std::to_string(tokens) +
+                    ",\"eval_duration\":8900000000}\n");
+    return lines;
+}
+
+// Lo que hace hoy Ollama::chat(request, callback) con cada trozo: copia, concatena los
+// pendientes y construye un ollama::response (DOM + json_string + simple_string)
+struct DomPath {
+    std::vector<std::string> partial;
+    void feed(const char *data, size_t size, std::string &out) {
+        partial.push_back(std::string(data, size));
+        std::string total = std::accumulate(partial.begin(), partial.end(), std::string(""));
+        try {
+            ollama::response response(total, ollama::message_type::chat);
+            partial.clear();
+            out += response.as_simple_string();
+        } catch (const ollama::invalid_json_exception &) {}
+    }
+};
+
+// nlohmann::json::sax_parse con un manejador mínimo: sin DOM, pero el lexer de la
+// biblioteca sigue reservando su buffer de tokens y una cadena por clave en cada línea
+struct SaxHandler : nlohmann::json_sax<nlohmann::json> {
+    std::string *out = nullptr;
+    int depth = 0;
+    bool inMessage = false, isContent = false;
+    bool null() override { return true; }
+    bool boolean(bool) override { return true; }
+    bool number_integer(number_integer_t) override { return true; }
+    bool number_unsigned(number_unsigned_t) override { return true; }
+    bool number_float(number_float_t, const string_t &) override { return true; }
+    bool string(string_t &val) override {
+        if (isContent) out->append(val);
+        isContent = false;
+        return true;
+    }
+    bool binary(binary_t &) override { return true; }
+    bool start_object(size_t) override { depth++; return true; }
+    bool key(string_t &val) override {
+        if (depth == 1) inMessage = (val == "message");
+        isContent = inMessage && depth == 2 && val == "content";
+        return true;
+    }
+    bool end_object() override { depth--; return true; }
+    bool start_array(size_t) override { return true; }
+    bool end_array() override { return true; }
+    bool parse_error(size_t, const std::string &, const nlohmann::detail::exception &) override { return false; }
+};
+
+struct SaxPath {
+    SaxHandler handler;
+    void feed(const char *data, size_t size, std::string &out) {
+        handler.out = &out;
+        handler.depth = 0;
+        nlohmann::json::sax_parse(data, data + size, &handler);
+    }
+};
+
+struct DecoderPath {
+    StreamDecoder decoder;
+    void feed(const char *data, size_t size, std::string &out) { decoder.feed(data, size, out); }
+};
+
+struct PathResult {
+    double ns_per_token = 0.0;
+    double allocs_per_token = 0.0;
+    std::string text;
+};
+
+template <typename Path>
+PathResult run_path(const std::vector<std::string> &lines) {
+    PathResult result;
+    result.ns_per_token = 1e300;
+    for (int r = 0; r < BENCH_REPEATS; ++r) {
+        Path path;
+        std::string out;
+        out.reserve(lines.size() * 16);
+        size_t before = allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string &line : lines) path.feed(line.data(), line.size(), out);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        result.ns_per_token = std::min(result.ns_per_token, ns / lines.size());
+        result.allocs_per_token = double(allocations.load() - before) / lines.size();
+        result.text = std::move(out);
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    size_t tokens = BENCH_TOKENS;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            tokens = std::max(1, std::stoi(argv[++i]));
+        } else {
+            std::cerr << "Error: Unknown option " << argv[i] << ". Use --help for usage information.\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::string> lines = make_stream(tokens);
+    PathResult dom = run_path<DomPath>(lines);
+    PathResult sax = run_path<SaxPath>(lines);
+    PathResult decoder = run_path<DecoderPath>(lines);
+
+    // Las líneas también pueden llegar partidas o varias en un mismo trozo HTTP
+    std::string whole;
+    for (const std::string &line : lines) whole += line;
+    std::string chunked;
+    StreamDecoder splitDecoder;
+    for (size_t pos = 0, step = 7; pos < whole.size(); pos += step, step = step * 5 % 97 + 1) {
+        splitDecoder.feed(whole.data() + pos, std::min(step, whole.size() - pos), chunked);
+    }
+    splitDecoder.finish(chunked);
+
+    bool same = decoder.text == dom.text && sax.text == dom.text && chunked == dom.text;
+    const StreamReply &reply = splitDecoder.reply();
+    bool counters = reply.done && reply.eval_count == int64_t(tokens) && reply.prompt_eval_count == 31;
+
+    printf("%-16s %12s %14s\n", "path", "ns/token", "allocs/token");
+    printf("%-16s %12.1f %14.2f\n", "ollama::response", dom.ns_per_token, dom.allocs_per_token);
+    printf("%-16s %12.1f %14.2f\n", "json::sax_parse", sax.ns_per_token, sax.allocs_per_token);
+    printf("%-16s %12.1f %14.2f\n", "StreamDecoder", decoder.ns_per_token, decoder.allocs_per_token);
+    printf("\n%zu tokens, %.1fx faster than ollama::response; output %s, split chunks %s, counters %s\n",
+           tokens, dom.ns_per_token / decoder.ns_per_token, same ? "identical" : "DIFFERENT",
+           chunked == dom.text ? "ok" : "WRONG", counters ? "ok" : "WRONG");
+
+    record_metric("stream_decoder_bench", {
+        {"tokens", tokens},
+        {"dom_ns_per_token", dom.ns_per_token},
+        {"dom_allocs_per_token", dom.allocs_per_token},
+        {"sax_ns_per_token", sax.ns_per_token},
+        {"sax_allocs_per_token", sax.allocs_per_token},
+        {"decoder_ns_per_token", decoder.ns_per_token},
+        {"decoder_allocs_per_token", decoder.allocs_per_token},
+        {"identical", same && counters},
+    });
+    return same && counters ? 0 : 1;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./stream_decoder_bench.out [-n TOKENS]\n"
+              << "  -n        Streamed lines per pass (default " << BENCH_TOKENS << ").\n"
+              << "  --help    Show this help message.\n"
+              << "Decodes a synthetic /api/chat stream with ollama::response (the current path),\n"
+              << "nlohmann's SAX parser and StreamDecoder, checks that the text matches and prints\n"
+              << "time and heap allocations per token; the summary goes to logs/metrics.jsonl.\n";
+}
@@ -1,24 +1,63 @@
+//g++ -std=c++17 transcripe.cpp ../utilities/transcriber.cpp ../utilities/wav_reader.cpp ../utilities/model_selector.cpp ../utilities/vad.cpp ../utilities/spectrum.cpp ../utilities/audio_capture.cpp ../utilities/audio_frontend.cpp ../utilities/metrics.cpp ../utilities/logging.cpp -I ../utilities/whisper.cpp/include -I ../utilities/whisper.cpp/ggml/include -L ../utilities/whisper.cpp/build/src -lwhisper -pthread -o transcripe.out
 #include <iostream>
-#include "microkey.hpp"  // Include the header file of microkey
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../utilities/transcriber.hpp"
 
-int main() {
-    // Initialize Whisper with the correct parameters
+// Formatea milisegundos como hh:mm:ss.mmm
+std::string format_timestamp(int64_t ms) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld.%03lld",
+             static_cast<long long>(ms / 3600000), static_cast<long long>(ms / 60000 % 60),
+             static_cast<long long>(ms / 1000 % 60), static_cast<long long>(ms % 1000));
+    return buffer;
+}
 
-    AudioFile audioFile = "audios/audio.wav";
-    struct whisper_context_params wparams = whisper_context_default_params();
-    ctx = whisper_init_from_file_with_params("../whisper.cpp/models/ggml-base.bin", wparams);
-    
-    if (!ctx) {
-        std::cerr << "❌ Error: No se pudo cargar el modelo Whisper." << std::endl;
-        return 1;
+int main(int argc, char* argv[]) {
+    // Uso: ./transcripe.out [audio.wav] [--long] [--states N]
+    std::string audioFile;
+    bool longMode = false;
+    int nStates = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--long") == 0) {
+            longMode = true;
+        } else if (std::strcmp(argv[i], "--states") == 0 && i + 1 < argc) {
+            nStates = std::stoi(argv[++i]);
+        } else {
+            audioFile = argv[i];
+        }
     }
 
-    start_microphone(audioFile);  // Wait for 'R' to start recording
-    stop_microphone();   // Wait for 'S' to stop recording
-    std::cout << "✅ Grabación finalizada. Archivo guardado en " << audioFile << std::endl;
+    if (audioFile.empty()) {
+        // Sin archivo: grabar con el micrófono como antes
+        Transcriber transcriber("", "audio.wav");
+        transcriber.start_microphone();  // Wait for 'R' to start recording
+        transcriber.stop_microphone();   // Wait for 'S' to stop recording
+        std::cout << "✅ Grabación finalizada." << std::endl;
+        std::cout << "📝 Transcripción: " << transcriber.transcribe_audio() << std::endl;
+        return 0;
+    }
 
-    transcribe_audio(audioFile); // Transcribe recorded audio
+    Transcriber transcriber("", audioFile);
+
+    if (!longMode) {
+        std::cout << "📝 Transcripción: " << transcriber.transcribe_audio() << std::endl;
+        return 0;
+    }
 
-    whisper_free(ctx); // Free Whisper memory
+    std::vector<TranscriptSegment> segments;
+    transcriber.transcribe_long_audio(audioFile, nStates, &segments);
+    if (segments.empty()) {
+        std::cerr << "❌ No se pudo transcribir " << audioFile << std::endl;
+        return 1;
+    }
+
+    for (const TranscriptSegment &segment : segments) {
+        std::cout << "[" << format_timestamp(segment.t0_ms) << " --> " << format_timestamp(segment.t1_ms) << "]"
+                  << segment.text << std::endl;
+    }
     return 0;
-}
\ No newline at end of file
+}
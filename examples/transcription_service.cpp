@@ -0,0 +1,92 @@
+//g++ -std=c++17 transcription_service.cpp ../utilities/transcription_service.cpp ../utilities/transcriber.cpp ../utilities/wav_reader.cpp ../utilities/model_selector.cpp ../utilities/vad.cpp ../utilities/spectrum.cpp ../utilities/audio_capture.cpp ../utilities/audio_frontend.cpp ../utilities/metrics.cpp ../utilities/logging.cpp -I ../utilities/whisper.cpp/include -I ../utilities/whisper.cpp/ggml/include -L ../utilities/whisper.cpp/build/src -lwhisper -pthread -o transcription_service.out
+#include <iostream>
+#include <csignal>
+#include <pthread.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../utilities/transcription_service.hpp"
+
+// Function to display help information
+void show_help();
+
+int main(int argc, char* argv[]) {
+    std::string socketPath = transcription_socket_path();
+    std::string model; // empty: calibrated choice
+    bool serveMode = false, denoise = false;
+    int nStates = 0;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0) {
+            show_help();
+            return 0;
+        } else if (std::strcmp(argv[i], "serve") == 0) {
+            serveMode = true;
+        } else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+            model = argv[++i];
+        } else if (std::strcmp(argv[i], "--states") == 0 && i + 1 < argc) {
+            nStates = std::stoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--denoise") == 0) {
+            denoise = true;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (serveMode) {
+        // SIGINT/SIGTERM only wake sigwait, so the service shuts down cleanly
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        Transcriber transcriber(model, "audio.wav");
+        if (denoise) transcriber.set_frontend(FrontEndConfig());
+        TranscriptionService service(transcriber, socketPath, nStates);
+        if (!service.start()) {
+            std::cerr << service.error() << std::endl;
+            return 1;
+        }
+        std::cout << "✅ Listening on " << socketPath << " with " << service.states() << " whisper states. Ctrl+C to stop." << std::endl;
+
+        int received = 0;
+        sigwait(&signals, &received);
+        service.stop();
+        return 0;
+    }
+
+    if (files.empty()) {
+        std::cerr << "Error: No input files. Use --help for usage information.\n";
+        return 1;
+    }
+
+    int failures = 0;
+    for (const std::string &file : files) {
+        TranscriptionResult result;
+        if (!transcribe_remote(file, result, socketPath)) {
+            std::cerr << "❌ " << file << ": no answer from " << socketPath << " (see logs/transcription_service.log)" << std::endl;
+            failures++;
+            continue;
+        }
+        std::cout << file << ":" << result.text << std::endl;
+    }
+    return failures ? 1 : 0;
+}
+
+inline void show_help() {
+    std::cout << "Usage: ./transcription_service.out serve [--socket PATH] [--states N] [--model PATH] [--denoise]\n"
+              << "       ./transcription_service.out [--socket PATH] FILE.wav...\n"
+              << "  serve         Load whisper once and transcribe for every client of this user.\n"
+              << "  --socket      Unix socket (default $XDG_RUNTIME_DIR/" TRANSCRIPTION_SOCKET_NAME ",\n"
+              << "                or /tmp/ova-UID/" TRANSCRIPTION_SOCKET_NAME ").\n"
+              << "  --states      Whisper states decoding in parallel (default: cores / 4).\n"
+              << "  --model       Whisper model (default: calibrated choice).\n"
+              << "  --denoise     High-pass, noise reduction and gain control before decoding.\n"
+              << "  FILE.wav      Client mode: send the files to the running service and print the text.\n"
+              << "  --help        Show this help message.\n";
+}
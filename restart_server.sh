@@ -62,7 +62,6 @@ if [ $? -ne 0 ]; then
     return 1
 fi
 
-# Generate models
-ollama create fast_response_assistant -f "$ROOT_DIR/utilities/models/fast_response_MODELFILE"
-ollama create chat_response_assistant -f "$ROOT_DIR/utilities/models/chat_response_MODELFILE"
-ollama create chat_response_unrestricted -f "$ROOT_DIR/utilities/models/unrestricted_chat_response_MODELFILE"
\ No newline at end of file
+# fast_response, chat_response y chat_response_unrestricted ya no son modelos aparte: son
+# perfiles de utilities/models/profiles.json que se aplican sobre deepseek-coder en cada
+# petición, así el servidor no recarga el modelo al pasar de uno a otro
\ No newline at end of file
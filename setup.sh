@@ -115,10 +115,9 @@ sleep 5
 echo "Descargando el modelo deepseek-coder..."
 ollama pull deepseek-coder 2>&1 | tee "$LOG_DIR/pull_log.txt" || handle_error "Error al descargar el modelo."
 
-# Generate models
-ollama create fast_response_assistant -f "$ROOT_DIR/utilities/models/fast_response_MODELFILE"
-ollama create chat_response_assistant -f "$ROOT_DIR/utilities/models/chat_response_MODELFILE"
-ollama create chat_response_unrestricted -f "$ROOT_DIR/utilities/models/unrestricted_chat_response_MODELFILE"
+# fast_response, chat_response y chat_response_unrestricted ya no son modelos aparte: son
+# perfiles de utilities/models/profiles.json que se aplican sobre deepseek-coder en cada
+# petición, así el servidor no recarga el modelo al pasar de uno a otro
 
 # Copy example files (if recompiling)
 if [ "$RECOMPILE" = true ]; then
@@ -142,14 +141,20 @@ fi
 # Compile C++ files if recompiling
 if [ "$RECOMPILE" = true ]; then
     echo "Compilando los archivos C++..."
-    
-    if g++ -std=c++17 -fsanitize=undefined "$COMMANDS_DIR/ask_the_model.cpp" "$ROOT_DIR/utilities/call_the_model.cpp" -o "$COMMANDS_DIR/amfq.out"; then
+
+    # Lo que necesitan amfq y chat además de su propio .cpp (lo mismo que en sus comentarios de compilación)
+    MODEL_SRCS=()
+    for src in call_the_model stream_decoder request_policy config model_profiles model_preloader endpoint_pool metrics logging speech_normalizer; do
+        MODEL_SRCS+=("$ROOT_DIR/utilities/$src.cpp")
+    done
+
+    if g++ -std=c++17 -fsanitize=undefined "$COMMANDS_DIR/ask_the_model.cpp" "${MODEL_SRCS[@]}" -pthread -o "$COMMANDS_DIR/amfq.out"; then
         echo "Compilación de ask_the_model.cpp exitosa."
     else
         handle_error "Fallo la compilación de ask_the_model.cpp."
     fi
 
-    if g++ -std=c++17 -fsanitize=undefined "$COMMANDS_DIR/speak_with_the_model.cpp" "$ROOT_DIR/utilities/call_the_model.cpp" -o "$COMMANDS_DIR/chat.out" -g; then
+    if g++ -std=c++17 -fsanitize=undefined "$COMMANDS_DIR/speak_with_the_model.cpp" "${MODEL_SRCS[@]}" -pthread -o "$COMMANDS_DIR/chat.out" -g; then
         echo "Compilación de speak_with_the_model.cpp exitosa."
     else
         handle_error "Fallo la compilación de speak_with_the_model.cpp."
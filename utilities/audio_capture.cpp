@@ -0,0 +1,73 @@
+#include "audio_capture.hpp"
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+AudioCapture::AudioCapture(int sampleRate) : sampleRate(sampleRate) {}
+
+AudioCapture::~AudioCapture() {
+    stop();
+}
+
+bool AudioCapture::start() {
+    if (running()) return true;
+
+    int pipefd[2];
+    if (pipe(pipefd) != 0) return false;
+
+    pid = fork();
+    if (pid < 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        pid = -1;
+        return false;
+    }
+
+    if (pid == 0) {
+        // Child: arecord writes raw PCM to the pipe, its chatter goes to /dev/null
+        dup2(pipefd[1], STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        std::string rate = std::to_string(sampleRate);
+        execlp("arecord", "arecord", "-q", "-f", "S16_LE", "-r", rate.c_str(), "-c", "1", "-t", "raw", (char *)nullptr);
+        _exit(127);
+    }
+
+    close(pipefd[1]);
+    fd = pipefd[0];
+    return true;
+}
+
+void AudioCapture::stop() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        pid = -1;
+    }
+}
+
+bool AudioCapture::read(float *out, size_t n) {
+    if (fd < 0) return false;
+
+    scratch.resize(n);
+    char *buffer = reinterpret_cast<char *>(scratch.data());
+    size_t wanted = n * sizeof(int16_t), got = 0;
+    while (got < wanted) {
+        ssize_t r = ::read(fd, buffer + got, wanted - got);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false; // arecord exited or the device went away
+        got += static_cast<size_t>(r);
+    }
+
+    for (size_t i = 0; i < n; ++i) out[i] = scratch[i] / 32768.0f;
+    return true;
+}
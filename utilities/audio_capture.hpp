@@ -0,0 +1,33 @@
+#ifndef AUDIO_CAPTURE_HPP
+#define AUDIO_CAPTURE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+// Captura del micrófono como flujo PCM: lanza arecord escribiendo audio crudo
+// (S16_LE, mono) a una tubería y entrega las muestras normalizadas a [-1, 1).
+class AudioCapture {
+public:
+    explicit AudioCapture(int sampleRate = 16000);
+    ~AudioCapture();
+
+    AudioCapture(const AudioCapture &) = delete;
+    AudioCapture &operator=(const AudioCapture &) = delete;
+
+    bool start();
+    void stop();
+    bool running() const { return pid > 0; }
+
+    // Lee exactamente n muestras (bloquea). Devuelve false si la captura terminó.
+    bool read(float *out, size_t n);
+
+private:
+    int sampleRate;
+    pid_t pid = -1;
+    int fd = -1;
+    std::vector<int16_t> scratch;
+};
+
+#endif // AUDIO_CAPTURE_HPP
@@ -0,0 +1,188 @@
+#include "audio_frontend.hpp"
+#include "spectrum.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+
+#define FRONTEND_AGC_ATTACK     0.5f    // Bajar la ganancia: rápido (evita saturar)
+#define FRONTEND_AGC_RELEASE    0.1f    // Subirla: despacio (no amplificar pausas)
+#define FRONTEND_AGC_RELATIVE_DB 15.0f  // Bloques tan por debajo de la voz fuerte mantienen la ganancia
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Butterworth de 2º orden (RBJ cookbook), forma directa II transpuesta
+void highpass_filter(float *samples, size_t n, float cutoffHz, int sampleRate) {
+    const double w0 = 2.0 * M_PI * cutoffHz / sampleRate;
+    const double alpha = std::sin(w0) * M_SQRT1_2; // sin(w0) / (2Q), Q = 1/sqrt(2)
+    const double a0 = 1.0 + alpha;
+    const float b0 = static_cast<float>((1.0 + std::cos(w0)) / 2.0 / a0);
+    const float b1 = static_cast<float>(-(1.0 + std::cos(w0)) / a0);
+    const float b2 = b0;
+    const float a1 = static_cast<float>(-2.0 * std::cos(w0) / a0);
+    const float a2 = static_cast<float>((1.0 - alpha) / a0);
+
+    float z1 = 0.0f, z2 = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float x = samples[i];
+        float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        samples[i] = y;
+    }
+}
+
+// Ganancia espectral por bin: plano y sin ramas, para que se vectorice
+static void spectral_gain(const float *__restrict power, const float *__restrict noise, float *__restrict gain,
+                          size_t bins, float oversub, float floorPower) {
+    for (size_t k = 0; k < bins; ++k) {
+        float g = 1.0f - oversub * noise[k] / (power[k] + 1e-12f);
+        gain[k] = std::sqrt(std::max(g, floorPower));
+    }
+}
+
+void spectral_subtraction(std::vector<float> &samples, float oversub, float floorGain, float highpassHz, int sampleRate) {
+    const size_t nfft = FRONTEND_NFFT, hop = nfft / 2, bins = nfft / 2 + 1;
+    if (samples.size() < nfft) return;
+
+    // Periodic Hann at 50% overlap sums to one, so plain overlap-add reconstructs
+    std::vector<float> window(nfft);
+    for (size_t i = 0; i < nfft; ++i) window[i] = 0.5f - 0.5f * std::cos(2.0f * static_cast<float>(M_PI) * i / nfft);
+
+    // hop zeros in front so the first samples are covered by two windows too
+    std::vector<float> padded(hop + samples.size() + nfft, 0.0f);
+    std::copy(samples.begin(), samples.end(), padded.begin() + hop);
+    const size_t frames = (padded.size() - nfft) / hop + 1;
+
+    std::vector<std::vector<std::complex<float>>> spectra(frames, std::vector<std::complex<float>>(nfft));
+    std::vector<float> power(frames * bins);
+    std::vector<float> energy(frames);
+    for (size_t f = 0; f < frames; ++f) {
+        std::vector<std::complex<float>> &spec = spectra[f];
+        const float *x = padded.data() + f * hop;
+        for (size_t i = 0; i < nfft; ++i) spec[i] = x[i] * window[i];
+        fft_inplace(spec);
+        float *p = power.data() + f * bins;
+        float sum = 0.0f;
+        for (size_t k = 0; k < bins; ++k) {
+            p[k] = std::norm(spec[k]);
+            sum += p[k];
+        }
+        energy[f] = sum;
+    }
+
+    // Stationary noise (fans, hum): mean spectrum of the quietest frames
+    std::vector<size_t> order(frames);
+    for (size_t f = 0; f < frames; ++f) order[f] = f;
+    size_t quiet = std::max<size_t>(1, static_cast<size_t>(frames * FRONTEND_NOISE_PERCENTILE));
+    std::nth_element(order.begin(), order.begin() + (quiet - 1), order.end(),
+                     [&](size_t a, size_t b) { return energy[a] < energy[b]; });
+    std::vector<float> noise(bins, 0.0f);
+    for (size_t q = 0; q < quiet; ++q) {
+        const float *p = power.data() + order[q] * bins;
+        for (size_t k = 0; k < bins; ++k) noise[k] += p[k];
+    }
+    for (size_t k = 0; k < bins; ++k) noise[k] /= quiet;
+
+    const size_t cutoffBin = static_cast<size_t>(highpassHz * nfft / sampleRate);
+    std::vector<float> gain(bins);
+    std::vector<float> out(padded.size(), 0.0f);
+    for (size_t f = 0; f < frames; ++f) {
+        spectral_gain(power.data() + f * bins, noise.data(), gain.data(), bins, oversub, floorGain * floorGain);
+        for (size_t k = 0; k < std::min(cutoffBin, bins); ++k) gain[k] = 0.0f;
+
+        // Real signal: apply the same gain to the mirrored bins, then inverse FFT by conjugation
+        std::vector<std::complex<float>> &spec = spectra[f];
+        for (size_t k = 0; k < bins; ++k) spec[k] *= gain[k];
+        for (size_t k = 1; k < nfft - bins + 1; ++k) spec[nfft - k] = std::conj(spec[k]);
+        for (auto &c : spec) c = std::conj(c);
+        fft_inplace(spec);
+
+        float *y = out.data() + f * hop;
+        const float scale = 1.0f / nfft;
+        for (size_t i = 0; i < nfft; ++i) y[i] += spec[i].real() * scale;
+    }
+    std::copy(out.begin() + hop, out.begin() + hop + samples.size(), samples.begin());
+}
+
+// Ocho sumas parciales: sin -ffast-math el compilador no reordena una única suma
+// en float, con ellas cada carril SIMD lleva la suya
+static float block_rms(const float *__restrict x, size_t n) {
+    float lanes[8] = {0.0f};
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (size_t l = 0; l < 8; ++l) lanes[l] += x[i + l] * x[i + l];
+    }
+    float sum = 0.0f;
+    for (; i < n; ++i) sum += x[i] * x[i];
+    for (size_t l = 0; l < 8; ++l) sum += lanes[l];
+    return std::sqrt(sum / std::max<size_t>(1, n));
+}
+
+// Rampa lineal de ganancia y recorte a [-1, 1]
+static void apply_gain_ramp(float *__restrict x, size_t n, float from, float to) {
+    const float step = n ? (to - from) / n : 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float v = x[i] * (from + step * i);
+        x[i] = std::min(1.0f, std::max(-1.0f, v));
+    }
+}
+
+void automatic_gain_control(float *samples, size_t n, float targetDbfs, float maxGainDb, int sampleRate) {
+    const size_t block = std::max<size_t>(1, static_cast<size_t>(sampleRate) * FRONTEND_AGC_BLOCK_MS / 1000);
+    const float target = std::pow(10.0f, targetDbfs / 20.0f);
+    const float maxGain = std::pow(10.0f, maxGainDb / 20.0f);
+    const size_t blocks = (n + block - 1) / block;
+    std::vector<float> levels(blocks);
+    for (size_t b = 0; b < blocks; ++b) levels[b] = block_rms(samples + b * block, std::min(block, n - b * block));
+
+    // The whole utterance is known: pauses and leftover noise are judged against its
+    // loud parts (90th percentile) so they are never pulled up to the target
+    std::vector<float> sorted = levels;
+    size_t loudIndex = blocks * 9 / 10;
+    std::nth_element(sorted.begin(), sorted.begin() + loudIndex, sorted.end());
+    const float gate = std::max(std::pow(10.0f, FRONTEND_AGC_GATE_DBFS / 20.0f),
+                                sorted[loudIndex] * std::pow(10.0f, -FRONTEND_AGC_RELATIVE_DB / 20.0f));
+
+    float gain = 1.0f;
+    bool first = true;
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t pos = b * block, len = std::min(block, n - pos);
+        float rms = levels[b];
+
+        float next = gain;
+        if (rms > gate) {
+            float desired = std::min(maxGain, target / rms);
+            if (first) {
+                next = desired;
+                first = false;
+            } else {
+                float rate = desired < gain ? FRONTEND_AGC_ATTACK : FRONTEND_AGC_RELEASE;
+                next = gain + rate * (desired - gain);
+            }
+        }
+        apply_gain_ramp(samples + pos, len, gain, next);
+        gain = next;
+    }
+}
+
+void preprocess_audio(std::vector<float> &samples, const FrontEndConfig &config, int sampleRate, FrontEndTimings *timings) {
+    if (samples.empty()) return;
+
+    auto start = std::chrono::steady_clock::now();
+    if (config.highpass) highpass_filter(samples.data(), samples.size(), config.highpass_hz, sampleRate);
+    if (timings) timings->highpass_s += seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    if (config.denoise) {
+        spectral_subtraction(samples, config.noise_oversub, config.spectral_floor,
+                             config.highpass ? config.highpass_hz : 0.0f, sampleRate);
+    }
+    if (timings) timings->denoise_s += seconds_since(start);
+
+    start = std::chrono::steady_clock::now();
+    if (config.agc) automatic_gain_control(samples.data(), samples.size(), config.agc_target_dbfs, config.agc_max_gain_db, sampleRate);
+    if (timings) timings->agc_s += seconds_since(start);
+}
@@ -0,0 +1,48 @@
+#ifndef AUDIO_FRONTEND_HPP
+#define AUDIO_FRONTEND_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Valores por defecto del preprocesado antes de Whisper
+#define FRONTEND_HIGHPASS_HZ        80.0f   // Corta DC, zumbido de ventiladores y golpes
+#define FRONTEND_NFFT               512     // STFT de la reducción de ruido (32 ms a 16 kHz)
+#define FRONTEND_NOISE_PERCENTILE   0.1f    // Fracción de frames más silenciosos = ruido
+#define FRONTEND_NOISE_OVERSUB      1.5f    // Cuánto ruido se resta (sobre-sustracción)
+#define FRONTEND_SPECTRAL_FLOOR     0.1f    // Ganancia mínima por bin (-20 dB): evita ruido musical
+#define FRONTEND_AGC_BLOCK_MS       100     // Bloque de medida del control de ganancia
+#define FRONTEND_AGC_TARGET_DBFS    -20.0f  // Nivel RMS objetivo de la voz
+#define FRONTEND_AGC_MAX_GAIN_DB    24.0f   // Ganancia máxima
+#define FRONTEND_AGC_GATE_DBFS      -50.0f  // Bloques por debajo no cambian la ganancia
+
+struct FrontEndConfig {
+    bool highpass = true;
+    float highpass_hz = FRONTEND_HIGHPASS_HZ;
+    bool denoise = true;
+    float noise_oversub = FRONTEND_NOISE_OVERSUB;
+    float spectral_floor = FRONTEND_SPECTRAL_FLOOR;
+    bool agc = true;
+    float agc_target_dbfs = FRONTEND_AGC_TARGET_DBFS;
+    float agc_max_gain_db = FRONTEND_AGC_MAX_GAIN_DB;
+};
+
+// Tiempo de CPU de cada etapa (para el benchmark).
+struct FrontEndTimings {
+    double highpass_s = 0.0;
+    double denoise_s = 0.0;
+    double agc_s = 0.0;
+};
+
+// Paso alto -> reducción de ruido por sustracción espectral -> control automático de
+// ganancia, sobre el audio completo antes de whisper_full. Los bucles por muestra y por
+// bin son planos sobre float para que el compilador los vectorice (SSE/AVX/NEON); el
+// paso alto es un biquad y por naturaleza es secuencial.
+void preprocess_audio(std::vector<float> &samples, const FrontEndConfig &config = FrontEndConfig(),
+                      int sampleRate = 16000, FrontEndTimings *timings = nullptr);
+
+// Etapas sueltas.
+void highpass_filter(float *samples, size_t n, float cutoffHz, int sampleRate);
+void spectral_subtraction(std::vector<float> &samples, float oversub, float floorGain, float highpassHz, int sampleRate);
+void automatic_gain_control(float *samples, size_t n, float targetDbfs, float maxGainDb, int sampleRate);
+
+#endif // AUDIO_FRONTEND_HPP
@@ -0,0 +1,168 @@
+#include "audio_output.hpp"
+#include <algorithm>
+#include <chrono>
+
+AudioOutput::AudioOutput(std::unique_ptr<PcmSink> sink, size_t maxQueued)
+    : sink(sink ? std::move(sink) : std::make_unique<AudioSink>()), maxQueued(std::max<size_t>(1, maxQueued)) {
+    worker = std::thread(&AudioOutput::run, this);
+}
+
+AudioOutput::~AudioOutput() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        quit = true;
+        paused = false;
+    }
+    cv.notify_all();
+    if (worker.joinable()) worker.join();
+}
+
+uint64_t AudioOutput::generation() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return currentGeneration;
+}
+
+uint64_t AudioOutput::enqueue(std::vector<int16_t> pcm, int sampleRate, uint64_t generation) {
+    std::unique_lock<std::mutex> lock(mtx);
+    cvSpace.wait(lock, [&]() { return queue.size() < maxQueued || generation != currentGeneration || quit; });
+    if (generation != currentGeneration || quit || pcm.empty() || sampleRate <= 0) return 0;
+
+    uint64_t id = nextId++;
+    queue.push_back({id, sampleRate, std::move(pcm)});
+    cv.notify_all();
+    return id;
+}
+
+void AudioOutput::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        currentGeneration++;
+        queue.clear();
+        stopRequested = true;
+        paused = false;
+        playedId = nextId - 1; // nobody waits for discarded audio
+    }
+    cv.notify_all();
+    cvSpace.notify_all();
+    cvPlayed.notify_all();
+}
+
+void AudioOutput::flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    uint64_t last = nextId - 1;
+    cvPlayed.wait(lock, [&]() { return playedId >= last || quit; });
+}
+
+void AudioOutput::wait_until_played(uint64_t id) {
+    if (id == 0) return;
+    std::unique_lock<std::mutex> lock(mtx);
+    cvPlayed.wait(lock, [&]() { return playedId >= id || quit; });
+}
+
+void AudioOutput::pause() {
+    std::lock_guard<std::mutex> lock(mtx);
+    paused = true;
+}
+
+void AudioOutput::resume() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        paused = false;
+    }
+    cv.notify_all();
+}
+
+bool AudioOutput::busy() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return playing || !queue.empty();
+}
+
+void AudioOutput::set_gain(float newGain) {
+    std::lock_guard<std::mutex> lock(mtx);
+    gain = std::max(0.0f, newGain);
+}
+
+void AudioOutput::drain() {
+    std::unique_lock<std::mutex> lock(mtx);
+    uint64_t last = nextId - 1;
+    cvPlayed.wait(lock, [&]() { return (playedId >= last && !playing) || quit; });
+    // The worker only touches the sink outside the lock while playing; close() waits for
+    // the device (or aplay) to play what it still buffers, where abort() would clip it
+    if (sink->is_open()) sink->close();
+}
+
+void AudioOutput::set_sink(std::unique_ptr<PcmSink> newSink) {
+    stop();
+    std::unique_lock<std::mutex> lock(mtx);
+    // The worker only touches the sink outside the lock while playing, and stop() makes
+    // it drop the current buffer; wait for that before swapping
+    cvPlayed.wait(lock, [&]() { return !playing; });
+    if (sink->is_open()) sink->abort();
+    sink = newSink ? std::move(newSink) : std::make_unique<AudioSink>();
+}
+
+void AudioOutput::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        bool woke = cv.wait_for(lock, std::chrono::milliseconds(AUDIO_OUTPUT_IDLE_MS),
+                                [&]() { return quit || stopRequested || !queue.empty(); });
+        if (stopRequested) {
+            stopRequested = false;
+            if (sink->is_open()) sink->abort();
+            continue;
+        }
+        if (queue.empty()) {
+            // Nothing left: on exit or after a while idle, let the device drain and free it
+            if (quit || !woke) {
+                if (sink->is_open()) sink->close();
+                if (quit) break;
+            }
+            continue;
+        }
+
+        Buffer buffer = std::move(queue.front());
+        queue.pop_front();
+        playing = true;
+        cvSpace.notify_one();
+
+        bool cut = false;
+        lock.unlock();
+        if (sink->open(buffer.sampleRate)) {
+            const size_t block = std::max<size_t>(1, static_cast<size_t>(buffer.sampleRate) * AUDIO_OUTPUT_BLOCK_MS / 1000);
+            for (size_t pos = 0; pos < buffer.pcm.size(); pos += block) {
+                lock.lock();
+                if (paused && !stopRequested) {
+                    sink->pause(true);
+                    cv.wait(lock, [&]() { return !paused || stopRequested || quit; });
+                    sink->pause(false);
+                }
+                cut = stopRequested;
+                float blockGain = gain;
+                lock.unlock();
+                if (cut) break;
+
+                size_t n = std::min(block, buffer.pcm.size() - pos);
+                const int16_t *samples = buffer.pcm.data() + pos;
+                if (blockGain != 1.0f) {
+                    scaled.resize(n);
+                    for (size_t i = 0; i < n; ++i) {
+                        float v = samples[i] * blockGain;
+                        scaled[i] = static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, v)));
+                    }
+                    samples = scaled.data();
+                }
+                if (!sink->write(samples, n)) break;
+            }
+        }
+        lock.lock();
+
+        playing = false;
+        playedId = std::max(playedId, buffer.id);
+        cvPlayed.notify_all();
+    }
+}
+
+AudioOutput &audio_output() {
+    static AudioOutput output;
+    return output;
+}
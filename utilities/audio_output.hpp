@@ -0,0 +1,90 @@
+#ifndef AUDIO_OUTPUT_HPP
+#define AUDIO_OUTPUT_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "audio_sink.hpp"
+
+#define AUDIO_OUTPUT_MAX_QUEUE  32      // Buffers (frases) en cola antes de bloquear al productor
+#define AUDIO_OUTPUT_BLOCK_MS   20      // Granularidad de escritura: stop/pause se ven entre bloques
+#define AUDIO_OUTPUT_IDLE_MS    1500    // Sin audio durante este tiempo se libera el dispositivo
+
+// Motor de reproducción: un único hilo es dueño del dispositivo y reproduce en orden una
+// cola acotada de buffers PCM. Buffers seguidos con la misma frecuencia suenan sin huecos.
+// stop(), pause() y resume() solo afectan a nuestro audio (nada de pkill aplay).
+class AudioOutput {
+public:
+    // Sin sink se usa el dispositivo de audio (AudioSink).
+    explicit AudioOutput(std::unique_ptr<PcmSink> sink = nullptr, size_t maxQueued = AUDIO_OUTPUT_MAX_QUEUE);
+    // Termina de reproducir lo que haya en cola y libera el dispositivo.
+    ~AudioOutput();
+
+    AudioOutput(const AudioOutput &) = delete;
+    AudioOutput &operator=(const AudioOutput &) = delete;
+
+    // Encola un buffer (bloquea si la cola está llena). Devuelve su id, o 0 si se rechazó
+    // porque hubo un stop() después de leer generation (el productor debe abandonar).
+    uint64_t enqueue(std::vector<int16_t> pcm, int sampleRate, uint64_t generation);
+    uint64_t enqueue(std::vector<int16_t> pcm, int sampleRate) { return enqueue(std::move(pcm), sampleRate, generation()); }
+
+    // Se incrementa en cada stop(); permite a un productor saber que lo cortaron.
+    uint64_t generation();
+
+    // Corta lo que suena y vacía la cola.
+    void stop();
+    // Espera a que todo lo encolado se haya escrito en el dispositivo.
+    void flush();
+    // Espera a que el buffer id se haya escrito (o descartado por stop()).
+    void wait_until_played(uint64_t id);
+    // Espera a que suene todo lo encolado, también lo que el dispositivo aún tiene en su
+    // buffer, y lo libera. Para terminar sin cortar el final; stop() es para interrumpir.
+    void drain();
+    void pause();
+    void resume();
+
+    bool busy();
+
+    // Volumen aplicado desde el siguiente bloque (1 = normal). Para bajar la voz del
+    // asistente mientras se confirma que el usuario habla (barge-in).
+    void set_gain(float gain);
+
+    // Cambia el destino (p. ej. WavFileSink); corta lo que esté sonando.
+    void set_sink(std::unique_ptr<PcmSink> sink);
+
+private:
+    struct Buffer {
+        uint64_t id;
+        int sampleRate;
+        std::vector<int16_t> pcm;
+    };
+
+    void run();
+
+    std::unique_ptr<PcmSink> sink;
+    size_t maxQueued;
+    std::deque<Buffer> queue;
+    std::mutex mtx;
+    std::condition_variable cv;         // trabajo nuevo, stop, pause/resume, salida
+    std::condition_variable cvSpace;    // hueco en la cola
+    std::condition_variable cvPlayed;   // avance de playedId
+    uint64_t nextId = 1;
+    uint64_t playedId = 0;              // todo id <= playedId ya sonó o se descartó
+    uint64_t currentGeneration = 0;
+    bool stopRequested = false;
+    bool paused = false;
+    bool playing = false;
+    bool quit = false;
+    float gain = 1.0f;
+    std::vector<int16_t> scaled;        // bloque con el volumen aplicado (solo el hilo de salida)
+    std::thread worker;
+};
+
+// Salida de audio compartida por todo el proceso.
+AudioOutput &audio_output();
+
+#endif // AUDIO_OUTPUT_HPP
@@ -0,0 +1,225 @@
+#include "audio_sink.hpp"
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define AUDIO_SINK_LATENCY_US   100000  // Buffer del dispositivo (100 ms)
+#define AUDIO_SINK_PIPE_BYTES   4096    // Tubería hacia aplay: lo mínimo (~90 ms a 22050 Hz)
+
+AudioSink::AudioSink(int sampleRate) : sampleRate(sampleRate) {}
+
+AudioSink::~AudioSink() {
+    close();
+}
+
+bool AudioSink::open(int rate) {
+    if (is_open() && rate == sampleRate) return true;
+    close();
+    sampleRate = rate;
+    return open();
+}
+
+#ifdef OVA_WITH_ALSA
+
+bool AudioSink::is_open() const {
+    return pcm != nullptr;
+}
+
+bool AudioSink::open() {
+    if (pcm) return true;
+    if (snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0) < 0) {
+        pcm = nullptr;
+        return false;
+    }
+    if (snd_pcm_set_params(pcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED, 1,
+                           static_cast<unsigned int>(sampleRate), 1, AUDIO_SINK_LATENCY_US) < 0) {
+        snd_pcm_close(pcm);
+        pcm = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool AudioSink::write(const int16_t *samples, size_t n) {
+    if (!pcm) return false;
+    while (n > 0) {
+        snd_pcm_sframes_t written = snd_pcm_writei(pcm, samples, n);
+        if (written < 0) {
+            // Underrun or suspend: recover and retry, anything else is fatal
+            if (snd_pcm_recover(pcm, static_cast<int>(written), 1) < 0) return false;
+            continue;
+        }
+        samples += written;
+        n -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void AudioSink::close() {
+    if (!pcm) return;
+    snd_pcm_drain(pcm);
+    snd_pcm_close(pcm);
+    pcm = nullptr;
+}
+
+void AudioSink::abort() {
+    if (!pcm) return;
+    snd_pcm_drop(pcm);
+    snd_pcm_close(pcm);
+    pcm = nullptr;
+}
+
+void AudioSink::pause(bool paused) {
+    if (!pcm) return;
+    // Not every device can pause; those just underrun and recover on the next write
+    if (snd_pcm_pause(pcm, paused ? 1 : 0) < 0 && !paused) snd_pcm_prepare(pcm);
+}
+
+#else
+
+bool AudioSink::is_open() const {
+    return pid > 0;
+}
+
+bool AudioSink::open() {
+    if (is_open()) return true;
+
+    int pipefd[2];
+    if (pipe(pipefd) != 0) return false;
+
+    pid = fork();
+    if (pid < 0) {
+        ::close(pipefd[0]);
+        ::close(pipefd[1]);
+        pid = -1;
+        return false;
+    }
+
+    if (pid == 0) {
+        // Child: aplay reads raw PCM from the pipe, its chatter goes to /dev/null
+        dup2(pipefd[0], STDIN_FILENO);
+        int devnull = ::open("/dev/null", O_WRONLY);
+        if (devnull >= 0) {
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+        ::close(pipefd[0]);
+        ::close(pipefd[1]);
+        std::string rate = std::to_string(sampleRate);
+        std::string buffer = std::to_string(AUDIO_SINK_LATENCY_US);
+        execlp("aplay", "aplay", "-q", "-f", "S16_LE", "-r", rate.c_str(), "-c", "1", "-t", "raw",
+               "-B", buffer.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+
+    ::close(pipefd[0]);
+    fd = pipefd[1];
+#ifdef F_SETPIPE_SZ
+    fcntl(fd, F_SETPIPE_SZ, AUDIO_SINK_PIPE_BYTES);
+#endif
+    // A dead aplay must not kill us with SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+}
+
+bool AudioSink::write(const int16_t *samples, size_t n) {
+    if (fd < 0) return false;
+
+    const char *buffer = reinterpret_cast<const char *>(samples);
+    size_t wanted = n * sizeof(int16_t), sent = 0;
+    while (sent < wanted) {
+        ssize_t w = ::write(fd, buffer + sent, wanted - sent);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false; // aplay exited or was killed
+        sent += static_cast<size_t>(w);
+    }
+    return true;
+}
+
+void AudioSink::close() {
+    // Closing the pipe lets aplay play what is left and exit on its own
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+        pid = -1;
+    }
+}
+
+void AudioSink::abort() {
+    // Only our own aplay: whatever it still buffers is dropped with it
+    if (pid > 0) {
+        kill(pid, SIGKILL);
+    }
+    close();
+}
+
+void AudioSink::pause(bool paused) {
+    if (pid > 0) kill(pid, paused ? SIGSTOP : SIGCONT);
+}
+
+#endif
+
+WavFileSink::WavFileSink(const std::string &path) : path(path) {}
+
+WavFileSink::~WavFileSink() {
+    close();
+}
+
+bool WavFileSink::open(int rate) {
+    if (!file.is_open()) {
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "❌ Error: No se pudo crear " << path << std::endl;
+            return false;
+        }
+        sampleRate = rate;
+        write_header();
+    } else if (rate != sampleRate) {
+        // A WAV has a single rate: keep the first one
+        std::cerr << "⚠️ " << path << ": " << rate << " Hz audio written into a " << sampleRate << " Hz file" << std::endl;
+    }
+    opened = true;
+    return true;
+}
+
+bool WavFileSink::write(const int16_t *samples, size_t n) {
+    if (!opened) return false;
+    file.write(reinterpret_cast<const char *>(samples), static_cast<std::streamsize>(n * sizeof(int16_t)));
+    dataBytes += static_cast<uint32_t>(n * sizeof(int16_t));
+    return static_cast<bool>(file);
+}
+
+void WavFileSink::close() {
+    if (!opened) return;
+    write_header();
+    file.flush();
+    opened = false;
+}
+
+void WavFileSink::write_header() {
+    auto put16 = [&](uint16_t v) { file.write(reinterpret_cast<const char *>(&v), 2); };
+    auto put32 = [&](uint32_t v) { file.write(reinterpret_cast<const char *>(&v), 4); };
+
+    std::streampos end = file.tellp();
+    file.seekp(0);
+    file.write("RIFF", 4);
+    put32(36 + dataBytes);
+    file.write("WAVEfmt ", 8);
+    put32(16);
+    put16(1);                                           // PCM
+    put16(1);                                           // mono
+    put32(static_cast<uint32_t>(sampleRate));
+    put32(static_cast<uint32_t>(sampleRate) * 2);       // byte rate
+    put16(2);                                           // block align
+    put16(16);                                          // bits per sample
+    file.write("data", 4);
+    put32(dataBytes);
+    if (end > 44) file.seekp(end);
+}
@@ -0,0 +1,85 @@
+#ifndef AUDIO_SINK_HPP
+#define AUDIO_SINK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <sys/types.h>
+
+#ifdef OVA_WITH_ALSA
+#include <alsa/asoundlib.h>
+#endif
+
+// Destino de PCM S16_LE mono. Lo usa un solo hilo a la vez (el de AudioOutput).
+class PcmSink {
+public:
+    virtual ~PcmSink() = default;
+
+    virtual bool open(int sampleRate) = 0;
+    // Escribe n muestras (bloquea hasta que el destino las acepta).
+    virtual bool write(const int16_t *samples, size_t n) = 0;
+    // Espera a que suene todo lo escrito y libera el destino.
+    virtual void close() = 0;
+    // Descarta lo que aún no ha sonado y libera el destino.
+    virtual void abort() { close(); }
+    virtual void pause(bool paused) { (void)paused; }
+    virtual bool is_open() const = 0;
+};
+
+// Salida de audio PCM (S16_LE, mono) dentro del proceso. Con OVA_WITH_ALSA escribe
+// directamente en el dispositivo "default" de ALSA; sin él lanza un único aplay que
+// lee audio crudo por una tubería (sin archivos temporales). En los dos casos el
+// audio en vuelo se limita a unos 200 ms para que parar y pausar sean inmediatos.
+class AudioSink : public PcmSink {
+public:
+    explicit AudioSink(int sampleRate = 22050);
+    ~AudioSink() override;
+
+    AudioSink(const AudioSink &) = delete;
+    AudioSink &operator=(const AudioSink &) = delete;
+
+    bool open();
+    bool open(int sampleRate) override;
+    bool write(const int16_t *samples, size_t n) override;
+    void close() override;
+    void abort() override;
+    void pause(bool paused) override;
+    bool is_open() const override;
+
+    int sample_rate() const { return sampleRate; }
+
+private:
+    int sampleRate;
+#ifdef OVA_WITH_ALSA
+    snd_pcm_t *pcm = nullptr;
+#else
+    pid_t pid = -1;
+    int fd = -1;
+#endif
+};
+
+// Escribe todo lo reproducido en un WAV (pruebas y grabaciones sin tarjeta de sonido).
+// Varias aperturas seguidas se acumulan en el mismo archivo; la cabecera se actualiza
+// en cada close().
+class WavFileSink : public PcmSink {
+public:
+    explicit WavFileSink(const std::string &path);
+    ~WavFileSink() override;
+
+    bool open(int sampleRate) override;
+    bool write(const int16_t *samples, size_t n) override;
+    void close() override;
+    bool is_open() const override { return opened; }
+
+private:
+    void write_header();
+
+    std::string path;
+    std::ofstream file;
+    int sampleRate = 0;
+    uint32_t dataBytes = 0;
+    bool opened = false;
+};
+
+#endif // AUDIO_SINK_HPP
@@ -3,6 +3,8 @@
 #include <vector>
 #include "../utilities/json.hpp"
 #include "../utilities/ollama.hpp"
+#include "../utilities/speech_normalizer.hpp"
+#include "../utilities/stream_decoder.hpp"
 #include <iostream>
 #include <cstdlib>
 #include <unistd.h>
@@ -10,52 +12,33 @@
 #include <limits.h>
 #include <filesystem>
 #include <string>
-
-// Alias para el namespace JSON
-using json = nlohmann::json;
-
-// Estructura para almacenar los mensajes del historial
-struct Mensaje {
-        std::string role;
-        std::string content;
-    };
-
-    // Función para verificar si Ollama está corriendo e iniciarlo si es necesario
-
-void verificar_ollama(const std::string& modelo);
-
-void obtener_respuesta(
-            ollama::messages& historial, 
-            const std::string& modelo, 
-            const ollama::options& opciones,
-            const std::string& initial_instruction,
-            const std::string& prompt,
-            const std::string& speaking_role
-        );
-
-void inicializar_historial(const std::string& ruta_json, ollama::messages& historial);
-void inicializar_opciones(const std::string& ruta_json, ollama::options& opciones);
-void print_formatted_output(const std::string& input);
-void guardar_en_log(const std::string& usuario, const std::string& mensaje, const std::string& respuesta, bool esError);
+#include <csignal>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "../utilities/call_the_model.hpp"
+#include "../utilities/logging.hpp"
+#include "../utilities/metrics.hpp"
+#include "../utilities/model_profiles.hpp"
+#include "../utilities/request_policy.hpp"
+
+// Funciones internas
 void truncar_historial(ollama::messages& historial, int limit);
-void format_response_for_audio(const std::string& input, std::string &output);
 void reiniciar_servidor();
-
-std::string get_commands_directory();
 /*
 int main() {
         std::string historial_json = "historial_test.json";  // Archivo JSON con historial previo
-        std::string opciones_json = "opcions.json";  // Archivo JSON con historial previo
-
-        ollama::options opciones;
-        inicializar_opciones(opciones_json,opciones);
+        const Config& cfg = config();  // opcions.json
+        const ollama::options& opciones = cfg.options;
 
         ollama::messages historial = {};  // Historial del chat
         inicializar_historial(historial_json, historial);
 
-        std::string modelo = opciones["model"];//"deepseek-coder";  // Nombre del modelo a usar
+        std::string modelo = cfg.model;//"deepseek-coder";  // Nombre del modelo a usar
 
-        std::string initial_instruction = opciones["initial_intrucion"];
+        std::string initial_instruction = cfg.initial_instruction;
 
         // Verificar e iniciar Ollama
         verificar_ollama(modelo);
@@ -76,18 +59,7 @@ int main() {
 */
 
 void modelog(const std::string& message) {
-    
-    std::string logDirectory = "../logs/"; 
-    std::filesystem::create_directories(logDirectory);
-    std::string logFilePath = logDirectory + "call_the_model.log";
-
-    std::ofstream logFile(logFilePath, std::ios::app); // Open in append mode
-    if (logFile) {
-        logFile << message << std::endl;
-        logFile.close();
-    } else {
-        std::cerr << "❌ Error: No se pudo abrir el archivo de registro en " << logFilePath << std::endl;
-    }
+    write_log("call_the_model.log", message);
 }
 
 void verificar_ollama(const std::string& modelo) {
@@ -102,7 +74,8 @@ void verificar_ollama(const std::string& modelo) {
             std::cout << "Script 'setup.sh' ejecutado exitosamente.\n";
             
             // Intentar cargar el modelo después de ejecutar el script
-            if (ollama::load_model(modelo)) {
+            // Los perfiles (fast_response, ...) no existen en el servidor: se carga su modelo base
+            if (ollama::load_model(base_model(modelo), load_options(modelo))) {
                 std::cout << "Modelo '" << modelo << "' cargado exitosamente.\n";
             } else {
                 std::cerr << "Error: No se pudo cargar el modelo '" << modelo << "'.\n";
@@ -126,6 +99,458 @@ void obtener_respuesta(
     const std::string& prompt,
     const std::string speaking_role
 )
+{
+    // Misma ruta que el streaming: reintentos, respaldo y reinicio limitado en lugar de exit(1)
+    obtener_respuesta_stream(historial, modelo, opciones, initial_instruction, prompt, speaking_role, nullptr);
+}
+
+// Ctrl+C durante una generación: el manejador solo marca el control activo
+static std::atomic<std::atomic<bool>*> control_ctrl_c{nullptr};
+
+static void cancelar_por_sigint(int) {
+    if (std::atomic<bool>* cancelada = control_ctrl_c.load()) cancelada->store(true);
+}
+
+CtrlCCancela::CtrlCCancela(ControlGeneracion& control) {
+    control_ctrl_c.store(&control.cancelada);
+    struct sigaction accion {};
+    accion.sa_handler = cancelar_por_sigint;
+    sigemptyset(&accion.sa_mask);
+    sigaction(SIGINT, &accion, &anterior);
+}
+
+CtrlCCancela::~CtrlCCancela() {
+    sigaction(SIGINT, &anterior, nullptr);
+    control_ctrl_c.store(nullptr);
+}
+
+// Lo que comparten la espera y el hilo de E/S que recibe el stream. Al cerrarla el hilo de
+// E/S deja de tocar la respuesta y devuelve false, lo que cierra la conexión.
+struct RecepcionStream {
+    std::mutex mtx;
+    std::string respuesta;
+    StreamDecoder decoder;
+    bool cerrada = false;
+    std::chrono::steady_clock::time_point primerToken;
+};
+
+// Vigilancia del presupuesto de latencia durante un intento. Sin presupuesto (ya es el modelo
+// rápido o no hay a cuál bajar) no se vigila: solo corta el límite total.
+struct VigilanciaPresupuesto {
+    const LatencyBudget* presupuesto = nullptr;
+    std::chrono::steady_clock::time_point inicio;   // De la pregunta, no del intento
+    int num_predict = -1;
+    std::string motivo;                              // Qué no se cumplió; vacío si nada
+    double ritmo = 0.0;                              // Tokens/s cuando se decidió
+};
+
+// Motivo por el que la respuesta en curso no va a caber en el presupuesto, o "" si va bien.
+static std::string riesgo_presupuesto(const VigilanciaPresupuesto& vigilancia, const RecepcionStream& recepcion, double& ritmo) {
+    using segundos = std::chrono::duration<double>;
+    const LatencyBudget& presupuesto = *vigilancia.presupuesto;
+    auto ahora = std::chrono::steady_clock::now();
+    double transcurrido = segundos(ahora - vigilancia.inicio).count();
+    if (recepcion.respuesta.empty()) {
+        double limite = presupuesto.first_token_limit();
+        return limite > 0 && transcurrido > limite ? "primer token" : "";
+    }
+
+    size_t tokens = recepcion.decoder.lines();
+    if (tokens < BUDGET_RATE_MIN_TOKENS) return "";
+    ritmo = (tokens - 1) / std::max(segundos(ahora - recepcion.primerToken).count(), 1e-3);
+    if (presupuesto.min_tokens_per_s > 0 && ritmo < presupuesto.min_tokens_per_s) return "ritmo";
+    // Con num_predict se sabe cuánto falta como mucho: si a este ritmo no cabe, mejor saberlo ya
+    if (presupuesto.total_s > 0 && vigilancia.num_predict > static_cast<int>(tokens) &&
+        transcurrido + (vigilancia.num_predict - tokens) / ritmo > presupuesto.total_s) return "ritmo";
+    return "";
+}
+
+static bool generacion_cancelada(ControlGeneracion* control) {
+    return control && (control->cancelada || (control->comprobar && control->comprobar()));
+}
+
+// Un intento en un destino. respuesta recibe el texto aunque la petición falle a mitad. Si
+// la vigilancia ve que no cabe en el presupuesto, lo corta como fuera_de_tiempo con motivo.
+static EstadoRespuesta intentar_stream(
+    const RequestTarget& destino,
+    ollama::request& request,
+    const std::function<void(const std::string&, size_t)>& on_text,
+    ControlGeneracion* control,
+    std::chrono::steady_clock::time_point fin,
+    VigilanciaPresupuesto* vigilancia,
+    std::string& respuesta,
+    std::string& error
+)
+{
+    EstadoRespuesta estado = EstadoRespuesta::completa;
+    ollama::async_options limite;
+    if (fin != std::chrono::steady_clock::time_point::max()) {
+        auto restante = std::chrono::duration_cast<std::chrono::milliseconds>(fin - std::chrono::steady_clock::now());
+        limite.timeout = std::max(restante, std::chrono::milliseconds(1));
+    }
+
+    auto recepcion = std::make_shared<RecepcionStream>();
+    ollama::async<bool> peticion = client_for(destino.endpoint).chat_raw_async(request, [recepcion, on_text](const char* data, size_t size) {
+        std::lock_guard<std::mutex> lock(recepcion->mtx);
+        if (recepcion->cerrada) return false;
+        size_t nuevo = recepcion->respuesta.size();
+        if (!recepcion->decoder.feed(data, size, recepcion->respuesta)) modelog("Línea de streaming no válida descartada");
+        if (nuevo == 0 && !recepcion->respuesta.empty()) recepcion->primerToken = std::chrono::steady_clock::now();
+        if (on_text && recepcion->respuesta.size() > nuevo) on_text(recepcion->respuesta, nuevo);
+        return true;
+    }, limite);
+
+    // Mientras no llegan tokens (evaluación del prompt) el callback no se ejecuta, así que
+    // la cancelación se comprueba aquí y cierra la conexión aunque el stream esté callado
+    bool cortar = false;
+    while (!peticion.wait_for(std::chrono::milliseconds(GENERATION_POLL_MS))) {
+        if (generacion_cancelada(control)) {
+            estado = EstadoRespuesta::cancelada;
+            cortar = true;
+            break;
+        }
+        if (vigilancia && vigilancia->presupuesto) {
+            std::lock_guard<std::mutex> lock(recepcion->mtx);
+            vigilancia->motivo = riesgo_presupuesto(*vigilancia, *recepcion, vigilancia->ritmo);
+            if (!vigilancia->motivo.empty()) {
+                estado = EstadoRespuesta::fuera_de_tiempo;
+                cortar = true;
+                break;
+            }
+        }
+    }
+    if (cortar) {
+        peticion.cancel();
+    } else {
+        try {
+            peticion.get();
+        } catch (const ollama::timeout_exception&) {
+            estado = EstadoRespuesta::fuera_de_tiempo;
+        } catch (const std::exception& e) {
+            error = e.what();
+            estado = EstadoRespuesta::error;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(recepcion->mtx);
+    recepcion->cerrada = true;
+    // Un cuerpo de error ({"error": ...} sin '\n') también se decodifica aquí
+    if (estado == EstadoRespuesta::completa || estado == EstadoRespuesta::error) {
+        size_t nuevo = recepcion->respuesta.size();
+        recepcion->decoder.finish(recepcion->respuesta);
+        if (on_text && recepcion->respuesta.size() > nuevo) on_text(recepcion->respuesta, nuevo);
+        // Segundos de carga del modelo antes de empezar: cambios de modelo o de num_thread
+        record_model_load(destino.model, request["model"].get<std::string>(), destino.endpoint, recepcion->decoder.reply().load_duration);
+    }
+    // Ollama también manda los errores como una línea {"error": ...}
+    if (!recepcion->decoder.reply().error.empty()) {
+        error += (error.empty() ? "" : ": ") + recepcion->decoder.reply().error;
+        estado = EstadoRespuesta::error;
+    }
+    respuesta.swap(recepcion->respuesta);
+    return estado;
+}
+
+// Espera antes de reintentar; false si mientras tanto se canceló o pasaría el límite.
+static bool esperar_reintento(std::chrono::milliseconds espera, ControlGeneracion* control, std::chrono::steady_clock::time_point limite) {
+    auto fin = std::chrono::steady_clock::now() + espera;
+    if (fin > limite) return false;
+    while (std::chrono::steady_clock::now() < fin) {
+        if (generacion_cancelada(control)) return false;
+        std::this_thread::sleep_for(std::min(std::chrono::duration_cast<std::chrono::milliseconds>(fin - std::chrono::steady_clock::now()),
+                                             std::chrono::milliseconds(GENERATION_POLL_MS)));
+    }
+    return true;
+}
+
+// Pide la respuesta sin tocar el historial: destinos, reintentos y presupuesto.
+static EstadoRespuesta generar_respuesta(
+    const ollama::messages& mensajes,
+    const std::string& modelo,
+    const ollama::options& opciones,
+    const std::function<void(const std::string&, size_t)>& on_text,
+    ControlGeneracion* control,
+    std::string& respuesta,
+    std::string& error
+)
+{
+    std::vector<RequestTarget> destinos = request_targets(modelo);
+    auto inicio = std::chrono::steady_clock::now();
+
+    EstadoRespuesta estado = EstadoRespuesta::error;
+    RequestFailure fallo = RequestFailure::none, primerFallo = RequestFailure::none;
+    int intentos = 0;
+    bool reiniciado = false;
+    bool localSinConexion = false;  // Un intento real al servidor local no pudo conectar
+    const RequestTarget* usado = &destinos.front();
+    EndpointPool& pool = request_pool();
+    std::set<std::string> caidos;  // Endpoints que no conectaron en esta llamada
+
+    // El presupuesto total es un límite más; el primer token y el ritmo se vigilan solo si
+    // hay un modelo más rápido al que bajar
+    const LatencyBudget* presupuesto = control && control->presupuesto.active() ? &control->presupuesto : nullptr;
+    auto limite = control ? control->limite : std::chrono::steady_clock::time_point::max();
+    bool cortePorPresupuesto = false;
+    if (presupuesto && presupuesto->total_s > 0) {
+        auto finPresupuesto = inicio + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(presupuesto->total_s));
+        cortePorPresupuesto = finPresupuesto < limite;
+        limite = std::min(limite, finPresupuesto);
+    }
+    VigilanciaPresupuesto vigilancia;
+    vigilancia.inicio = inicio;
+    if (presupuesto && !presupuesto->downgrade_model.empty() && presupuesto->downgrade_model != modelo) {
+        vigilancia.presupuesto = presupuesto;
+        vigilancia.num_predict = opciones.at("options").value("num_predict", -1);
+    }
+
+    // Intenta un destino hasta RETRY_MAX_ATTEMPTS veces; true si hay que dejar de probar destinos
+    auto probar = [&](const RequestTarget& destino, const ollama::options& opcionesIntento, VigilanciaPresupuesto* vigilar) {
+        CircuitBreaker& breaker = breaker_for(destino.endpoint);
+        if (caidos.count(destino.endpoint)) return false;
+        for (int reintento = 0; reintento < RETRY_MAX_ATTEMPTS; ++reintento) {
+            if (!breaker.allow()) {
+                // Saltado sin intentarlo: el cortocircuito también se abre con un servidor ocupado
+                // o con errores 500, así que no cuenta como "no conecta" ni lleva a reiniciarlo
+                modelog("Cortocircuito abierto para " + destino.endpoint + ", se salta");
+                return false;
+            }
+            if (reintento > 0 && !esperar_reintento(backoff_delay(reintento - 1), control, limite)) {
+                estado = generacion_cancelada(control) ? EstadoRespuesta::cancelada : EstadoRespuesta::fuera_de_tiempo;
+                return true;
+            }
+
+            ollama::request request(destino.model, mensajes, opcionesIntento, true);
+            apply_model_profile(request);
+            error.clear();
+            intentos++;
+            usado = &destino;
+            pool.acquire(destino.endpoint);
+            estado = intentar_stream(destino, request, on_text, control, limite, vigilar, respuesta, error);
+            pool.release(destino.endpoint);
+            if (estado != EstadoRespuesta::error) {
+                breaker.success();
+                pool.mark_up(destino.endpoint);
+                return true;
+            }
+
+            fallo = classify_failure(error);
+            if (primerFallo == RequestFailure::none) primerFallo = fallo;
+            modelog(std::string("Fallo ") + failure_name(fallo) + " en " + destino.endpoint + " (" + destino.model + "): " + error);
+            if (fallo != RequestFailure::model_missing && fallo != RequestFailure::invalid) breaker.failure();
+            // El usuario ya vio parte de la respuesta: repetirla la duplicaría
+            if (!respuesta.empty() || fallo == RequestFailure::invalid) return true;
+            if (!is_retryable(fallo)) return false;
+            if (fallo == RequestFailure::unreachable) {
+                if (is_local_endpoint(destino.endpoint) && failure_is_refused(error)) localSinConexion = true;
+                // Con otros servidores en el pool no se espera a este: sus sesiones pasan al siguiente
+                pool.mark_down(destino.endpoint);
+                if (pool.size() > 1) {
+                    caidos.insert(destino.endpoint);
+                    return false;
+                }
+            }
+        }
+        return false;
+    };
+
+    for (const RequestTarget& destino : destinos) {
+        if (probar(destino, opciones, &vigilancia)) break;
+    }
+    if (estado == EstadoRespuesta::error && localSinConexion && respuesta.empty()) {
+        // Último recurso: ningún destino responde y el servidor local rechazó la conexión en esta
+        // llamada. Uno que solo está ocupado o devuelve 500 no se reinicia: es de todos los usuarios
+        auto local = std::find_if(destinos.begin(), destinos.end(), [](const RequestTarget& d) { return is_local_endpoint(d.endpoint); });
+        if (local != destinos.end() && restart_server_rate_limited(reiniciar_servidor)) {
+            reiniciado = true;
+            breaker_for(local->endpoint).reset();
+            caidos.erase(local->endpoint);
+            probar(*local, opciones, &vigilancia);
+        }
+    }
+
+    RequestTarget rapido;
+    if (!vigilancia.motivo.empty()) {
+        // Mejor una respuesta suficiente a tiempo: el modelo rápido, más corta, en lo que queda
+        rapido = {usado->endpoint, presupuesto->downgrade_model};
+        std::cerr << (respuesta.empty() ? "" : "\n") << "⏱️ " << modelo << " no llega a tiempo (" << vigilancia.motivo
+                  << "); respondo con " << rapido.model << "." << std::endl;
+        modelog("Presupuesto " + presupuesto->mode + ": " + vigilancia.motivo + " con " + modelo + ", se pasa a " + rapido.model);
+        ollama::options opcionesRapidas = opciones;
+        opcionesRapidas["num_predict"] = presupuesto->downgrade_num_predict;
+        respuesta.clear();
+        probar(rapido, opcionesRapidas, nullptr);
+    }
+    if (estado == EstadoRespuesta::fuera_de_tiempo && cortePorPresupuesto) {
+        std::cerr << "\n⏱️ Presupuesto de " << presupuesto->total_s << " s agotado; respuesta cortada." << std::endl;
+    }
+    if (!vigilancia.motivo.empty() || (estado == EstadoRespuesta::fuera_de_tiempo && cortePorPresupuesto)) {
+        record_metric("latency_budget", {
+            {"mode", presupuesto->mode},
+            {"model", modelo},
+            {"downgraded_to", vigilancia.motivo.empty() ? "" : rapido.model},
+            {"reason", vigilancia.motivo.empty() ? "total" : vigilancia.motivo},
+            {"tokens_per_s", vigilancia.ritmo},
+            {"cut", estado == EstadoRespuesta::fuera_de_tiempo},
+            {"seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count()},
+        });
+    }
+
+    // Las bajadas por presupuesto ya van en latency_budget
+    bool servidoPorOtro = usado != &destinos.front() && vigilancia.motivo.empty();
+    if (primerFallo != RequestFailure::none || servidoPorOtro || reiniciado || estado == EstadoRespuesta::error) {
+        record_metric("model_request", {
+            {"model", modelo},
+            {"served_by", usado->model},
+            {"endpoint", usado->endpoint},
+            {"attempts", intentos},
+            {"failure", failure_name(primerFallo)},
+            {"recovered", estado != EstadoRespuesta::error},
+            {"server_restarted", reiniciado},
+            {"seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count()},
+        });
+    }
+
+    // Todos los destinos saltados por el cortocircuito: no hubo ni un intento
+    if (estado == EstadoRespuesta::error && error.empty()) error = "Could not establish connection (cortocircuito abierto)";
+    return estado;
+}
+
+// Pasa la respuesta al historial y al log; una cortada va marcada con RESPUESTA_TRUNCADA.
+static void guardar_respuesta(
+    ollama::messages& historial,
+    const std::string& prompt,
+    const std::string& speaking_role,
+    std::string respuesta,
+    EstadoRespuesta estado,
+    const std::string& error
+)
+{
+    if (estado == EstadoRespuesta::error && respuesta.empty()) {
+        // Sin respuesta: el historial no cambia y la sesión sigue
+        guardar_en_log(speaking_role, prompt, error, true);
+        std::cerr << "Error: No se pudo generar la respuesta (" << failure_name(classify_failure(error)) << "): " << error << std::endl;
+        return;
+    }
+
+    // La respuesta cortada también queda en el historial, marcada para el modelo y el usuario
+    if (estado != EstadoRespuesta::completa) {
+        respuesta += RESPUESTA_TRUNCADA;
+        const char* motivo = estado == EstadoRespuesta::cancelada ? "cancelada" : estado == EstadoRespuesta::fuera_de_tiempo ? "fuera de tiempo" : "cortada por un error";
+        modelog(std::string("Generación ") + motivo + " tras " + std::to_string(respuesta.size()) + " bytes");
+    }
+
+    // Agregar al historial
+    historial.push_back({speaking_role, prompt});
+    historial.push_back({"assistant", respuesta});
+
+    // Guardar en el log
+    guardar_en_log(speaking_role, prompt, respuesta, false);
+}
+
+// Igual que obtener_respuesta pero en streaming: on_text recibe la respuesta acumulada y
+// la posición donde empieza el texto nuevo. Cada línea se decodifica con StreamDecoder
+// directamente sobre la respuesta, sin construir un ollama::response por token.
+//
+// Los fallos se clasifican (request_policy.hpp): los transitorios se reintentan con espera
+// exponencial mientras no se haya mostrado texto, un modelo inexistente pasa al de respaldo
+// y un endpoint que falla seguido se salta (cortocircuito) en favor del de respaldo. Solo si
+// el servidor no responde en ningún destino se reinicia, como mucho una vez cada
+// RESTART_MIN_INTERVAL_S entre todos los procesos. Con varios servidores en "endpoints" cada
+// sesión va al suyo (endpoint_pool.hpp) y uno que no conecta se deja al primer fallo.
+//
+// Con control->presupuesto, total_s es un límite más y si el primer token o el ritmo no
+// llegan la pregunta se repite con el modelo rápido y menos num_predict en el tiempo que
+// queda. En ambos casos se avisa por stderr.
+EstadoRespuesta obtener_respuesta_stream(
+    ollama::messages& historial,
+    const std::string& modelo,
+    const ollama::options& opciones,
+    const std::string& initial_instruction,
+    const std::string& prompt,
+    const std::string& speaking_role,
+    const std::function<void(const std::string&, size_t)>& on_text,
+    ControlGeneracion* control
+)
+{
+    ollama::messages mensajes = construir_mensajes(historial, initial_instruction, prompt, speaking_role);
+    std::string respuesta, error;
+    EstadoRespuesta estado = generar_respuesta(mensajes, modelo, opciones, on_text, control, respuesta, error);
+    guardar_respuesta(historial, prompt, speaking_role, respuesta, estado, error);
+    return estado;
+}
+
+RefinamientoProgresivo::RefinamientoProgresivo(
+    ollama::messages& historial,
+    const std::string& modelo_rapido,
+    const std::string& modelo_detallado,
+    const ollama::options& opciones,
+    const std::string& instruccion_rapida,
+    const std::string& instruccion_detallada,
+    const std::string& prompt,
+    const std::string& speaking_role
+)
+    : historial(historial), modeloRapido(modelo_rapido), modeloDetallado(modelo_detallado), opciones(opciones),
+      prompt(prompt), speakingRole(speaking_role), inicio(std::chrono::steady_clock::now())
+{
+    mensajesRapidos = construir_mensajes(historial, instruccion_rapida, prompt, speaking_role);
+    mensajesDetallados = construir_mensajes(historial, instruccion_detallada, prompt, speaking_role);
+    // La detallada no muestra nada hasta terminar ni tiene presupuesto
+    pendiente = std::async(std::launch::async, [this] {
+        return generar_respuesta(mensajesDetallados, modeloDetallado, this->opciones, nullptr, &controlDetallado, respuestaDetallada, errorDetallado);
+    });
+}
+
+RefinamientoProgresivo::~RefinamientoProgresivo() {
+    if (pendiente.valid()) {
+        controlDetallado.cancelada = true;
+        estadoDetallado = pendiente.get();
+    }
+    terminar(false);
+}
+
+EstadoRespuesta RefinamientoProgresivo::rapida(const std::function<void(const std::string&, size_t)>& on_text, ControlGeneracion* control) {
+    estadoRapido = generar_respuesta(mensajesRapidos, modeloRapido, opciones, on_text, control, respuestaRapida, errorRapido);
+    segundosRapida = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    return estadoRapido;
+}
+
+bool RefinamientoProgresivo::esperar_detallada(ControlGeneracion* control) {
+    if (!pendiente.valid()) return false;
+    // Pasar a otra cosa (Ctrl+C, una tecla, el límite) cancela la detallada
+    while (pendiente.wait_for(std::chrono::milliseconds(GENERATION_POLL_MS)) != std::future_status::ready) {
+        if (generacion_cancelada(control) || (control && std::chrono::steady_clock::now() >= control->limite)) {
+            controlDetallado.cancelada = true;
+        }
+    }
+    estadoDetallado = pendiente.get();
+    return terminar(estadoDetallado == EstadoRespuesta::completa && !controlDetallado.cancelada);
+}
+
+// Guarda en el historial solo la respuesta elegida, una vez.
+bool RefinamientoProgresivo::terminar(bool mejorada) {
+    if (terminado) return mejorada;
+    terminado = true;
+    record_metric("progressive_answer", {
+        {"fast_model", modeloRapido},
+        {"detailed_model", modeloDetallado},
+        {"fast_seconds", segundosRapida},
+        {"detailed_seconds", std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count()},
+        {"fast_state", static_cast<int>(estadoRapido)},
+        {"detailed_state", static_cast<int>(estadoDetallado)},
+        {"chosen", mejorada ? "detailed" : "fast"},
+    });
+    if (mejorada) {
+        guardar_respuesta(historial, prompt, speakingRole, respuestaDetallada, EstadoRespuesta::completa, "");
+    } else {
+        if (!errorDetallado.empty()) modelog("Respuesta detallada descartada: " + errorDetallado);
+        guardar_respuesta(historial, prompt, speakingRole, respuestaRapida, estadoRapido, errorRapido);
+    }
+    return mejorada;
+}
+
+// Mensajes exactos que se envían al modelo; la pre-carga especulativa usa el mismo
+// orden para que el servidor pueda reutilizar el prefijo ya evaluado.
+ollama::messages construir_mensajes(const ollama::messages& historial, const std::string& initial_instruction, const std::string& prompt, const std::string& speaking_role)
 {
     // Clonar historial
     ollama::messages mensajes = historial;
@@ -134,26 +559,7 @@ void obtener_respuesta(
 
     // Truncar el historial si es necesario
     truncar_historial(mensajes, 2);
-
-    try {
-        // Generar respuesta del modelo
-        std::string respuesta = ollama::chat(modelo, mensajes, opciones);
-
-        // Agregar al historial
-        historial.push_back({speaking_role, prompt});  
-        historial.push_back({"assistant", respuesta}); 
-
-        // Guardar en el log
-        guardar_en_log(speaking_role, prompt, respuesta, false);
-
-    } catch (const std::exception& e) {
-        std::cerr << "un error en la generacion ha ocurrido se reinciara el servidor" << "\n";
-        reiniciar_servidor();
-        // Guardar error en log
-        guardar_en_log(speaking_role, prompt, e.what(), true);
-        std::cerr << "Error critico en la generación de respuesta: " << e.what() << std::endl;
-        exit(1);
-    }
+    return mensajes;
 }
 
 void guardar_en_log(const std::string& usuario, const std::string& mensaje, const std::string& respuesta, bool esError)
@@ -259,59 +665,35 @@ void inicializar_historial(const std::string& ruta_json, ollama::messages& histo
         modelog(Msg);
 }
 
-void inicializar_opciones(const std::string& ruta_json, ollama::options& opciones) {
-    std::ifstream archivo(ruta_json);
-    if (!archivo) {
-        std::cerr << "Error: No se pudo abrir el archivo JSON: " << ruta_json << std::endl;
-        return;
-    }
+// Marca saltos de línea y código con las etiquetas de speech_normalizer.hpp
+void format_response_for_audio(const std::string& input, std::string &output) {
+    output.clear();
+    SpeechNormalizer tagger(SpeechNormalizer::Output::TAGGED);
+    tagger.feed(input, output);
+    tagger.finish(output);
+}
 
-    // Leer el archivo JSON
-    json json_data;
-    archivo >> json_data;
-
-    // Convertir a ollama::options
-    for (auto& [clave, valor] : json_data.items()) {
-        if (valor.is_number_integer()) {
-            opciones[clave] = valor.get<int>();
-        } else if (valor.is_number_float()) {
-            opciones[clave] = valor.get<double>();
-        } else if (valor.is_string()) {
-            opciones[clave] = valor.get<std::string>();
-        } else {
-            std::cerr << "Advertencia: Clave ignorada en el JSON, tipo de dato no compatible -> " << clave << std::endl;
-        }
+static void print_formatted_line(std::string line) {
+    // Trim leading spaces
+    size_t first_char = line.find_first_not_of(" \t");
+    if (first_char != std::string::npos) {
+        line = line.substr(first_char);
     }
 
-    std::string Msg = "Opciones cargadas desde " + ruta_json + "\n";
-    modelog(Msg);
-}
+    // Highlight commands in green
+    if (line.find("`") != std::string::npos) {
+        size_t start = line.find("`");
+        size_t end = line.rfind("`");
 
-void format_response_for_audio(const std::string& input, std::string &output) {
-    std::istringstream stream(input);
-    std::string line;
-    output.clear();
-    int line_count = 0;
-
-    while (std::getline(stream, line)) {
-        if (line_count > 0) {
-            output += "<|jump_line|>"; // Add jump line tag between lines
-        }
-        
-        for (size_t i = 0; i < line.size(); ++i) {
-            if (line[i] == '`') {
-                if (i + 2 < line.size() && line[i + 1] == '`' && line[i + 2] == '`') {
-                    output += "<|long_comand|>";
-                    i += 2; // Skip the next two backticks
-                } else {
-                    output += "<|short_comand|>";
-                }
-            } else {
-                output += line[i];
-            }
+        if (start != std::string::npos && end != std::string::npos && start != end) {
+            std::cout << line.substr(0, start);
+            std::cout << "\033[1;32m" << line.substr(start + 1, end - start - 1) << "\033[0m"; // Green text
+            std::cout << line.substr(end + 1) << std::endl;
+        } else {
+            std::cout << line << std::endl;
         }
-
-        line_count++;
+    } else {
+        std::cout << line << std::endl;
     }
 }
 
@@ -322,40 +704,31 @@ void print_formatted_output(const std::string& input) {
     std::cout << "================ Asistant out ================\n\n";
 
     while (std::getline(stream, line)) {
-        // Trim leading spaces
-        size_t first_char = line.find_first_not_of(" \t");
-        if (first_char != std::string::npos) {
-            line = line.substr(first_char);
-        }
-
-        // Highlight commands in green
-        if (line.find("`") != std::string::npos) {
-            size_t start = line.find("`");
-            size_t end = line.rfind("`");
-
-            if (start != std::string::npos && end != std::string::npos && start != end) {
-                std::cout << line.substr(0, start);
-                std::cout << "\033[1;32m" << line.substr(start + 1, end - start - 1) << "\033[0m"; // Green text
-                std::cout << line.substr(end + 1) << std::endl;
-            } else {
-                std::cout << line << std::endl;
-            }
-        } else {
-            std::cout << line << std::endl;
-        }
+        print_formatted_line(line);
     }
 
     std::cout << "\n==========================================================\n";
 }
 
-// Function that always points to the /commands directory relative to ROOT_DIR
-std::string get_commands_directory() {
-    char result[PATH_MAX];
-    ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
-    if (count != -1) {
-        std::string path(result, count);
-        // Forcefully target the parent directory where the executable is stored
-        return std::filesystem::path(path).parent_path().string();
+void FormattedStreamPrinter::feed(const std::string& response, size_t start) {
+    if (!started) {
+        std::cout << "================ Asistant out ================\n\n";
+        started = true;
+    } else if (start == 0 && printed > 0) {
+        std::cout << "\n";
+        printed = 0;
     }
-    return "";
-}
\ No newline at end of file
+    size_t end;
+    while ((end = response.find('\n', printed)) != std::string::npos) {
+        print_formatted_line(response.substr(printed, end - printed));
+        printed = end + 1;
+    }
+}
+
+void FormattedStreamPrinter::finish(const std::string& response) {
+    if (!started && response.empty()) return; // Nada que mostrar (error o cancelada antes del primer token)
+    feed(response);
+    if (printed < response.size()) print_formatted_line(response.substr(printed));
+    printed = response.size();
+    std::cout << "\n==========================================================\n";
+}
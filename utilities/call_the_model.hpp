@@ -5,11 +5,21 @@
 #include <vector>
 #include "json.hpp"
 #include "ollama.hpp"
+#include "request_policy.hpp"
+#include "logging.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <future>
 #include <string>
 
 // Alias para JSON
 using json = nlohmann::json;
 
+#define GENERATION_POLL_MS 50                           // Cada cuánto se comprueba la cancelación mientras se genera
+#define RESPUESTA_TRUNCADA " [respuesta interrumpida]"  // Marca en el historial de una respuesta cortada
+
 // Estructura para mensajes
 struct Mensaje {
     std::string role;
@@ -26,11 +36,105 @@ void obtener_respuesta(
     const std::string& prompt,
     const std::string speaking_role
 );
+// Cancelación cooperativa de una generación en streaming. cancelada se puede poner desde
+// cualquier hilo (o con CtrlCCancela), comprobar se consulta cada GENERATION_POLL_MS (p. ej.
+// una tecla) y limite corta la generación en los modos por lotes. presupuesto vigila el
+// primer token y el ritmo (request_policy.hpp) y puede pasar la respuesta al modelo rápido.
+struct ControlGeneracion {
+    std::atomic<bool> cancelada{false};
+    std::function<bool()> comprobar;
+    std::chrono::steady_clock::time_point limite = std::chrono::steady_clock::time_point::max();
+    LatencyBudget presupuesto;
+};
+
+// Mientras existe, Ctrl+C cancela la generación en lugar de terminar el proceso.
+class CtrlCCancela {
+public:
+    explicit CtrlCCancela(ControlGeneracion& control);
+    ~CtrlCCancela();
+private:
+    struct sigaction anterior;
+};
+
+// error: ningún destino respondió; si ya había texto se guarda como cortado.
+enum class EstadoRespuesta { completa, cancelada, fuera_de_tiempo, error };
+
+// Variante en streaming: on_text(respuesta, inicio) se llama con cada trozo nuevo. Si control
+// la corta, la conexión se cierra (el servidor deja de generar) y la respuesta parcial queda
+// en el historial terminada en RESPUESTA_TRUNCADA. Si el presupuesto obliga a empezar de
+// nuevo con el modelo rápido, on_text vuelve a llegar con inicio 0 y una respuesta nueva.
+EstadoRespuesta obtener_respuesta_stream(
+    ollama::messages& historial,
+    const std::string& modelo,
+    const ollama::options& opciones,
+    const std::string& initial_instruction,
+    const std::string& prompt,
+    const std::string& speaking_role,
+    const std::function<void(const std::string&, size_t)>& on_text,
+    ControlGeneracion* control = nullptr
+);
+// Refinamiento progresivo: la pregunta sale a la vez hacia el modelo rápido y el detallado.
+// rapida() muestra la rápida según llega; esperar_detallada() espera a la otra hasta que
+// control corte (Ctrl+C, una tecla, el límite) y, si llegó completa, la deja en detallada()
+// para que sustituya o amplíe a la rápida. Al historial solo va la respuesta elegida: la
+// detallada si llegó, si no la rápida (también si el objeto se destruye sin esperar).
+class RefinamientoProgresivo {
+public:
+    RefinamientoProgresivo(
+        ollama::messages& historial,
+        const std::string& modelo_rapido,
+        const std::string& modelo_detallado,
+        const ollama::options& opciones,
+        const std::string& instruccion_rapida,
+        const std::string& instruccion_detallada,
+        const std::string& prompt,
+        const std::string& speaking_role
+    );
+    ~RefinamientoProgresivo();
+    RefinamientoProgresivo(const RefinamientoProgresivo&) = delete;
+    RefinamientoProgresivo& operator=(const RefinamientoProgresivo&) = delete;
+
+    EstadoRespuesta rapida(const std::function<void(const std::string&, size_t)>& on_text, ControlGeneracion* control = nullptr);
+    bool esperar_detallada(ControlGeneracion* control = nullptr);
+    const std::string& detallada() const { return respuestaDetallada; }
+    const std::string& modelo_detallado() const { return modeloDetallado; }
+
+private:
+    bool terminar(bool mejorada);
+
+    ollama::messages& historial;
+    std::string modeloRapido, modeloDetallado;
+    ollama::options opciones;
+    std::string prompt, speakingRole;
+    ollama::messages mensajesRapidos, mensajesDetallados;
+    std::chrono::steady_clock::time_point inicio;
+
+    ControlGeneracion controlDetallado;
+    std::future<EstadoRespuesta> pendiente;
+    std::string respuestaRapida, errorRapido, respuestaDetallada, errorDetallado;
+    EstadoRespuesta estadoRapido = EstadoRespuesta::error;
+    EstadoRespuesta estadoDetallado = EstadoRespuesta::error;
+    double segundosRapida = 0.0;
+    bool terminado = false;
+};
+
+ollama::messages construir_mensajes(
+    const ollama::messages& historial,
+    const std::string& initial_instruction,
+    const std::string& prompt,
+    const std::string& speaking_role
+);
 void inicializar_historial(const std::string& ruta_json, ollama::messages& historial);
-void inicializar_opciones(const std::string& ruta_json, ollama::options& opciones);
 void print_formatted_output(const std::string& input);
+// Imprime una respuesta en streaming con el mismo formato, línea a línea según llega.
+// Con start == 0 tras haber impreso algo, la respuesta empieza de nuevo.
+struct FormattedStreamPrinter {
+    size_t printed = 0;
+    bool started = false;
+    void feed(const std::string& response, size_t start = std::string::npos);
+    void finish(const std::string& response);
+};
 void format_response_for_audio(const std::string& input, std::string &output);  
 void guardar_en_log(const std::string& usuario, const std::string& mensaje, const std::string& respuesta, bool esError);
-std::string get_commands_directory();
 
 #endif // CALL_THE_MODEL_HPP
\ No newline at end of file
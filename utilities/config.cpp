@@ -0,0 +1,319 @@
+#include "config.hpp"
+#include "logging.hpp"
+#include "call_the_model.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+//Logging error and success messages from other functions
+void configlog(const std::string &message) {
+    write_log("config.log", message);
+}
+
+// Claves que se leen aquí; el resto son opciones del modelo
+static const std::set<std::string> configKeys = {
+    "model", "model_fast_response", "model_chat_response", "model_chat_response_unrestricted",
+    "initial_intrucion", "detail_initial_intrucion", "endpoint", "endpoints",
+    "fallback_model", "fallback_endpoint", "latency_budgets", "preload", "drain"};
+
+// Los lectores solo cargan el puntero. Las versiones no se liberan nunca (son pocas y pequeñas),
+// así que una referencia obtenida antes de una recarga sigue siendo válida.
+static std::atomic<const Config *> current{nullptr};
+static std::vector<std::unique_ptr<const Config>> versions;
+static std::mutex writerMtx;
+static std::once_flag firstLoad;
+static unsigned loadedVersions = 0;
+
+static std::string config_path() {
+    return get_commands_directory() + "/" CONFIG_FILE;
+}
+
+// Cada lector deja el valor que ya tenía el campo si falta la clave
+static bool read_text(const nlohmann::json &obj, const std::string &where, const char *key, std::string &out, std::string &error) {
+    if (!obj.contains(key)) return true;
+    if (!obj[key].is_string()) {
+        error = where + key + " tiene que ser un texto";
+        return false;
+    }
+    out = obj[key].get<std::string>();
+    return true;
+}
+
+static bool read_number(const nlohmann::json &obj, const std::string &where, const char *key, double &out, std::string &error) {
+    if (!obj.contains(key)) return true;
+    if (!obj[key].is_number() || obj[key].get<double>() < 0) {
+        error = where + key + " tiene que ser un número >= 0";
+        return false;
+    }
+    out = obj[key].get<double>();
+    return true;
+}
+
+template <typename Int>
+static bool read_int(const nlohmann::json &obj, const std::string &where, const char *key, Int &out, long min, std::string &error) {
+    if (!obj.contains(key)) return true;
+    if (!obj[key].is_number_integer() || obj[key].get<long>() < min) {
+        error = where + key + " tiene que ser un entero >= " + std::to_string(min);
+        return false;
+    }
+    out = static_cast<Int>(obj[key].get<long>());
+    return true;
+}
+
+static bool read_endpoint(const std::string &endpoint, const std::string &key, std::string &error) {
+    if (endpoint.rfind("http://", 0) != 0 && endpoint.rfind("https://", 0) != 0) {
+        error = key + " \"" + endpoint + "\" no es una URL http:// o https://";
+        return false;
+    }
+    return true;
+}
+
+bool parse_config(const nlohmann::json &data, Config &out, std::string &error) {
+    if (!data.is_object()) {
+        error = "no es un objeto JSON";
+        return false;
+    }
+    Config parsed;
+    for (const char *key : {"model", "initial_intrucion"}) {
+        if (!data.contains(key)) {
+            error = std::string("falta ") + key;
+            return false;
+        }
+    }
+    if (!read_text(data, "", "model", parsed.model, error) ||
+        !read_text(data, "", "initial_intrucion", parsed.initial_instruction, error)) return false;
+
+    // Sin las claves de cada modo, el modelo y la instrucción generales
+    parsed.model_fast_response = parsed.model;
+    parsed.model_chat_response = parsed.model;
+    parsed.detail_instruction = parsed.initial_instruction;
+    if (!read_text(data, "", "model_fast_response", parsed.model_fast_response, error) ||
+        !read_text(data, "", "model_chat_response", parsed.model_chat_response, error) ||
+        !read_text(data, "", "detail_initial_intrucion", parsed.detail_instruction, error)) return false;
+    parsed.model_chat_response_unrestricted = parsed.model_chat_response;
+    if (!read_text(data, "", "model_chat_response_unrestricted", parsed.model_chat_response_unrestricted, error)) return false;
+
+    if (data.contains("endpoints")) {
+        const nlohmann::json &endpoints = data["endpoints"];
+        if (!endpoints.is_array() || endpoints.empty()) {
+            error = "endpoints tiene que ser una lista de URLs no vacía";
+            return false;
+        }
+        parsed.endpoints.clear();
+        for (const nlohmann::json &endpoint : endpoints) {
+            if (!endpoint.is_string()) {
+                error = "endpoints tiene que ser una lista de URLs";
+                return false;
+            }
+            parsed.endpoints.push_back(endpoint.get<std::string>());
+        }
+    } else if (data.contains("endpoint")) {
+        if (!read_text(data, "", "endpoint", parsed.endpoints.front(), error)) return false;
+    }
+    for (const std::string &endpoint : parsed.endpoints) {
+        if (!read_endpoint(endpoint, "endpoints", error)) return false;
+    }
+    if (data.contains("drain")) {
+        const nlohmann::json &drain = data["drain"];
+        if (!drain.is_array()) {
+            error = "drain tiene que ser una lista de URLs";
+            return false;
+        }
+        for (const nlohmann::json &endpoint : drain) {
+            if (!endpoint.is_string()) {
+                error = "drain tiene que ser una lista de URLs";
+                return false;
+            }
+            if (!read_endpoint(endpoint.get<std::string>(), "drain", error)) return false;
+            parsed.drain.push_back(endpoint.get<std::string>());
+        }
+    }
+    if (!read_text(data, "", "fallback_model", parsed.fallback_model, error) ||
+        !read_text(data, "", "fallback_endpoint", parsed.fallback_endpoint, error)) return false;
+    if (!parsed.fallback_endpoint.empty() && !read_endpoint(parsed.fallback_endpoint, "fallback_endpoint", error)) return false;
+
+    if (data.contains("latency_budgets")) {
+        const nlohmann::json &budgets = data["latency_budgets"];
+        if (!budgets.is_object()) {
+            error = "latency_budgets tiene que ser un objeto con un presupuesto por modo";
+            return false;
+        }
+        for (const auto &[mode, entry] : budgets.items()) {
+            std::string where = "latency_budgets." + mode + ".";
+            if (!entry.is_object()) {
+                error = "latency_budgets." + mode + " tiene que ser un objeto";
+                return false;
+            }
+            LatencyBudget budget;
+            budget.mode = mode;
+            budget.downgrade_model = parsed.model_fast_response;
+            if (!read_number(entry, where, "first_token_s", budget.first_token_s, error) ||
+                !read_number(entry, where, "total_s", budget.total_s, error) ||
+                !read_number(entry, where, "min_tokens_per_s", budget.min_tokens_per_s, error) ||
+                !read_text(entry, where, "downgrade_model", budget.downgrade_model, error) ||
+                !read_int(entry, where, "downgrade_num_predict", budget.downgrade_num_predict, 1, error)) return false;
+            parsed.latency_budgets[mode] = budget;
+        }
+    }
+
+    if (data.contains("preload")) {
+        const nlohmann::json &entry = data["preload"];
+        if (!entry.is_object()) {
+            error = "preload tiene que ser un objeto";
+            return false;
+        }
+        PreloadConfig &preload = parsed.preload;
+        if (entry.contains("enabled") && !entry["enabled"].is_boolean()) {
+            error = "preload.enabled tiene que ser true o false";
+            return false;
+        }
+        preload.enabled = entry.value("enabled", true); // Con la clave, activada salvo "enabled": false
+        if (!read_int(entry, "preload.", "memory_mb", preload.memory_mb, 0, error) ||
+            !read_int(entry, "preload.", "max_models", preload.max_models, 1, error) ||
+            !read_int(entry, "preload.", "interval_s", preload.interval_s, 1, error) ||
+            !read_int(entry, "preload.", "lookahead_min", preload.lookahead_min, 0, error) ||
+            !read_number(entry, "preload.", "min_score", preload.min_score, error) ||
+            !read_text(entry, "preload.", "keep_alive", preload.keep_alive, error)) return false;
+    }
+
+    // El resto van al modelo (top_k, temperature, stop, ...)
+    for (const auto &[key, value] : data.items()) {
+        if (configKeys.count(key)) continue;
+        if (value.is_number_integer()) {
+            parsed.options[key] = value.get<int>();
+        } else if (value.is_number_float()) {
+            parsed.options[key] = value.get<double>();
+        } else if (value.is_string() || value.is_boolean() || value.is_array()) {
+            parsed.options[key] = value; // Listas como "stop": ["\n\n"]
+        } else {
+            error = key + ": las opciones del modelo no pueden ser objetos";
+            return false;
+        }
+    }
+
+    out = std::move(parsed);
+    return true;
+}
+
+// Publica una versión nueva. Solo la llama quien tiene writerMtx.
+static const Config *publish(std::unique_ptr<Config> next) {
+    next->version = ++loadedVersions;
+    const Config *published = next.get();
+    versions.push_back(std::move(next));
+    current.store(published, std::memory_order_release);
+    return published;
+}
+
+static bool load_config(std::string &error) {
+    std::string path = config_path();
+    std::ifstream file(path);
+    if (!file) {
+        error = "no se pudo abrir " + path;
+        return false;
+    }
+    auto next = std::make_unique<Config>();
+    try {
+        nlohmann::json data = nlohmann::json::parse(file);
+        if (!parse_config(data, *next, error)) return false;
+    } catch (const std::exception &e) {
+        error = e.what();
+        return false;
+    }
+    next->path = path;
+    const Config *previous = current.load(std::memory_order_acquire);
+    if (previous && previous->endpoints != next->endpoints) {
+        // El pool de request_policy se crea una vez por proceso
+        configlog("ℹ️ endpoints ha cambiado: se usará al reiniciar el proceso");
+    }
+    const Config *published = publish(std::move(next));
+    configlog("✅ Configuración v" + std::to_string(published->version) + " cargada desde " + path);
+    return true;
+}
+
+const Config &config() {
+    const Config *loaded = current.load(std::memory_order_acquire);
+    if (loaded) return *loaded;
+
+    std::call_once(firstLoad, [] {
+        std::lock_guard<std::mutex> lock(writerMtx);
+        if (current.load(std::memory_order_acquire)) return; // Ya la cargó un ConfigWatcher
+        std::string error;
+        if (!load_config(error)) {
+            // Sin una versión válida no hay modelo al que preguntar: mejor parar aquí que en la primera petición
+            std::cerr << "Error: " << config_path() << " no es válido: " << error << std::endl;
+            configlog("❌ " + error + "; no hay configuración con la que arrancar");
+            exit(1);
+        }
+    });
+    return *current.load(std::memory_order_acquire);
+}
+
+void set_config(const Config &next) {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    publish(std::make_unique<Config>(next));
+}
+
+bool reload_config(std::string *error) {
+    std::lock_guard<std::mutex> lock(writerMtx);
+    std::string reason;
+    if (load_config(reason)) return true;
+    configlog("⚠️ " + reason + "; se mantiene la configuración anterior");
+    if (error) *error = reason;
+    return false;
+}
+
+ConfigWatcher::ConfigWatcher() {
+    config(); // La primera versión, antes de empezar a vigilar
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        configlog("❌ inotify no disponible: opcions.json no se recargará en caliente");
+        return;
+    }
+    // Se vigila la carpeta: los editores que guardan con rename sustituyen el archivo
+    std::string directory = get_commands_directory();
+    if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        configlog("❌ No se pudo vigilar " + directory + ": opcions.json no se recargará en caliente");
+        close(fd);
+        fd = -1;
+        return;
+    }
+    thread = std::thread(&ConfigWatcher::run, this);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    stopping = true;
+    if (thread.joinable()) thread.join();
+    if (fd >= 0) close(fd);
+}
+
+void ConfigWatcher::run() {
+    alignas(inotify_event) char buffer[4096];
+    pollfd watched{fd, POLLIN, 0};
+    while (!stopping) {
+        if (poll(&watched, 1, CONFIG_WATCH_POLL_MS) <= 0) continue;
+
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+            for (char *ptr = buffer; ptr < buffer + length;) {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>(ptr);
+                if (event->len > 0 && std::strcmp(event->name, CONFIG_FILE) == 0) changed = true;
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (!changed) continue;
+
+        std::string error;
+        if (!reload_config(&error)) {
+            // La sesión sigue con la versión anterior; se avisa para que el error no pase desapercibido
+            std::cerr << "\n⚠️ opcions.json no válido, se mantiene la configuración anterior: " << error << std::endl;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef CONFIG_HPP
+#define CONFIG_HPP
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "model_preloader.hpp"
+#include "ollama.hpp"
+#include "request_policy.hpp"
+
+#define CONFIG_FILE             "opcions.json"  // En la carpeta de los comandos
+#define CONFIG_WATCH_POLL_MS    250             // Cada cuánto comprueba el hilo de inotify si tiene que parar
+
+// opcions.json leído y validado una sola vez por versión del archivo. Los turnos leen los
+// campos directamente, sin buscar claves por nombre ni convertir tipos.
+struct Config {
+    std::string model;                              // "model"
+    std::string model_fast_response;                // Sin la clave: model
+    std::string model_chat_response;                // Sin la clave: model
+    std::string model_chat_response_unrestricted;   // Sin la clave: model_chat_response
+    std::string initial_instruction;                // "initial_intrucion"
+    std::string detail_instruction;                 // "detail_initial_intrucion"; sin ella, initial_intrucion
+    ollama::options options;                        // Las demás claves (top_k, temperature, ...), para el modelo
+
+    std::vector<std::string> endpoints{DEFAULT_ENDPOINT};  // "endpoints", o "endpoint"
+    std::vector<std::string> drain;                        // Endpoints retirados por mantenimiento; se aplica sin reiniciar
+    std::string fallback_model;
+    std::string fallback_endpoint;
+    std::map<std::string, LatencyBudget> latency_budgets;  // Por modo: amfq, amfq_detail, chat, chat_detail
+    PreloadConfig preload;
+
+    std::string path;
+    unsigned version = 0;   // 1 la primera versión publicada; cada recarga válida suma uno
+};
+
+// Configuración vigente. No bloquea: es una lectura atómica de un puntero a una versión que
+// nunca se libera, así que la referencia sigue siendo válida aunque se recargue el archivo.
+// Si la primera lectura falla, muestra el error y termina el proceso.
+const Config &config();
+
+// Vuelve a leer opcions.json. Si no se puede leer o no es válido se mantiene la versión
+// anterior, devuelve false y error explica por qué.
+bool reload_config(std::string *error = nullptr);
+
+// Publica una configuración hecha en código en lugar de leer opcions.json (demos y pruebas).
+void set_config(const Config &next);
+
+// Valida un opcions.json ya parseado: false y error si algún campo no tiene el tipo o el rango esperado.
+bool parse_config(const nlohmann::json &data, Config &out, std::string &error);
+
+// Mientras existe, un hilo recarga la configuración con inotify cada vez que se guarda
+// opcions.json, también si el editor lo reemplaza con un rename. Para procesos largos
+// (chat, OVA): una edición inválida se avisa y la sesión sigue con la versión anterior.
+class ConfigWatcher {
+public:
+    ConfigWatcher();
+    ~ConfigWatcher();
+
+    ConfigWatcher(const ConfigWatcher &) = delete;
+    ConfigWatcher &operator=(const ConfigWatcher &) = delete;
+
+private:
+    void run();
+
+    int fd = -1;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
+
+void configlog(const std::string &message);
+
+#endif // CONFIG_HPP
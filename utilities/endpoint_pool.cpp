@@ -0,0 +1,222 @@
+#include "endpoint_pool.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "ollama.hpp"
+
+//Logging error and success messages from other functions
+void poollog(const std::string &message) {
+    write_log("endpoint_pool.log", message);
+}
+
+uint64_t pool_hash(const std::string &key) {
+    uint64_t h = 1469598103934665603ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    // FNV-1a solo reparte mal claves casi iguales ("url#1", "url#2"); la mezcla lo corrige
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+EndpointPool::EndpointPool(const std::vector<std::string> &urls) {
+    for (const std::string &url : urls) {
+        if (url.empty() || index_of(url) >= 0) continue;
+        EndpointStatus endpoint;
+        endpoint.url = url;
+        endpoints.push_back(endpoint);
+        for (int v = 0; v < POOL_VIRTUAL_NODES; ++v) {
+            ring.push_back({pool_hash(url + "#" + std::to_string(v)), endpoints.size() - 1});
+        }
+    }
+    std::sort(ring.begin(), ring.end());
+}
+
+EndpointPool::~EndpointPool() {
+    stop_health_checks();
+}
+
+int EndpointPool::index_of(const std::string &url) const {
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        if (endpoints[i].url == url) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool EndpointPool::available(size_t index) const {
+    return endpoints[index].healthy && !endpoints[index].draining;
+}
+
+std::vector<std::string> EndpointPool::route(const std::string &session, const std::string &model) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<size_t> order;
+    if (endpoints.empty()) return {};
+
+    if (session.empty()) {
+        for (size_t i = 0; i < endpoints.size(); ++i) order.push_back(i);
+        auto loaded = [&](size_t i) {
+            const std::vector<std::string> &models = endpoints[i].runningModels;
+            return !model.empty() && std::find(models.begin(), models.end(), model) != models.end();
+        };
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            if (endpoints[a].inFlight != endpoints[b].inFlight) return endpoints[a].inFlight < endpoints[b].inFlight;
+            return loaded(a) && !loaded(b);
+        });
+    } else {
+        // Recorre el anillo desde el hash de la sesión; cada endpoint aparece una vez
+        std::vector<bool> seen(endpoints.size(), false);
+        auto it = std::lower_bound(ring.begin(), ring.end(), std::make_pair(pool_hash(session), size_t(0)));
+        for (size_t n = 0; n < ring.size() && order.size() < endpoints.size(); ++n, ++it) {
+            if (it == ring.end()) it = ring.begin();
+            if (!seen[it->second]) {
+                seen[it->second] = true;
+                order.push_back(it->second);
+            }
+        }
+
+        // Carga acotada: si el endpoint de la sesión va muy por encima de la media, la
+        // petición pasa al siguiente del anillo en lugar de hacer cola
+        int total = 1, count = 0;
+        for (size_t i = 0; i < endpoints.size(); ++i) {
+            if (available(i)) {
+                total += endpoints[i].inFlight;
+                count++;
+            }
+        }
+        if (count > 1) {
+            int cap = static_cast<int>(std::ceil(total * POOL_LOAD_FACTOR / count));
+            std::stable_partition(order.begin(), order.end(), [&](size_t i) { return endpoints[i].inFlight < cap; });
+        }
+    }
+    std::stable_partition(order.begin(), order.end(), [&](size_t i) { return available(i); });
+
+    if (!session.empty()) {
+        auto previous = homes.find(session);
+        if (previous != homes.end() && previous->second != order.front() && !available(previous->second)) {
+            rehomedSessions++;
+            poollog("🔀 Sesión " + session + ": " + endpoints[previous->second].url + " → " + endpoints[order.front()].url);
+        }
+        homes[session] = order.front();
+    }
+
+    std::vector<std::string> urls;
+    for (size_t i : order) urls.push_back(endpoints[i].url);
+    return urls;
+}
+
+void EndpointPool::acquire(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    int i = index_of(url);
+    if (i < 0) return;
+    endpoints[i].inFlight++;
+    endpoints[i].served++;
+}
+
+void EndpointPool::release(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    int i = index_of(url);
+    if (i >= 0 && endpoints[i].inFlight > 0) endpoints[i].inFlight--;
+}
+
+void EndpointPool::set_healthy(size_t index, bool healthy, const std::vector<std::string> *models) {
+    EndpointStatus &endpoint = endpoints[index];
+    if (endpoint.healthy != healthy) {
+        poollog(healthy ? "✅ " + endpoint.url + " vuelve a responder"
+                        : "❌ " + endpoint.url + " no responde; sus sesiones pasan al siguiente endpoint");
+    }
+    endpoint.healthy = healthy;
+    if (models) endpoint.runningModels = *models;
+}
+
+void EndpointPool::mark_down(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    int i = index_of(url);
+    if (i >= 0) set_healthy(i, false, nullptr);
+}
+
+void EndpointPool::mark_up(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    int i = index_of(url);
+    if (i >= 0) set_healthy(i, true, nullptr);
+}
+
+void EndpointPool::drain(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    int i = index_of(url);
+    if (i < 0 || endpoints[i].draining) return;
+    endpoints[i].draining = true;
+    poollog("🚧 Drenando " + url + " (" + std::to_string(endpoints[i].inFlight) + " peticiones en curso)");
+}
+
+void EndpointPool::restore(const std::string &url) {
+    std::lock_guard<std::mutex> lock(mtx);
+    int i = index_of(url);
+    if (i < 0 || !endpoints[i].draining) return;
+    endpoints[i].draining = false;
+    poollog("✅ " + url + " vuelve al reparto");
+}
+
+void EndpointPool::check_health() {
+    std::vector<std::string> urls;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const EndpointStatus &endpoint : endpoints) urls.push_back(endpoint.url);
+    }
+
+    // Sin el mutex: un endpoint colgado no debe frenar el reparto
+    for (const std::string &url : urls) {
+        Ollama client(url);
+        client.setConnectionTimeout(POOL_HEALTH_TIMEOUT_S);
+        client.setReadTimeout(POOL_HEALTH_TIMEOUT_S);
+        bool up = false;
+        std::vector<std::string> models;
+        try {
+            up = client.is_running();
+            if (up) models = client.list_running_models();
+        } catch (const std::exception &e) {
+            poollog("⚠️ Comprobación de " + url + " incompleta: " + e.what());
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+        int i = index_of(url);
+        if (i >= 0) set_healthy(i, up, up ? &models : nullptr);
+    }
+}
+
+void EndpointPool::start_health_checks(int intervalMs) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (healthThread.joinable()) return;
+    stopping = false;
+    healthThread = std::thread([this, intervalMs] {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stopping) {
+            lock.unlock();
+            check_health();
+            lock.lock();
+            healthCv.wait_for(lock, std::chrono::milliseconds(intervalMs), [this] { return stopping; });
+        }
+    });
+}
+
+void EndpointPool::stop_health_checks() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    healthCv.notify_all();
+    if (healthThread.joinable()) healthThread.join();
+}
+
+std::vector<EndpointStatus> EndpointPool::status() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return endpoints;
+}
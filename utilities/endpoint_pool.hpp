@@ -0,0 +1,86 @@
+#ifndef ENDPOINT_POOL_HPP
+#define ENDPOINT_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#define POOL_VIRTUAL_NODES      64      // Puntos de cada endpoint en el anillo de hashing consistente
+#define POOL_LOAD_FACTOR        1.25    // Una sesión sale de su endpoint si este pasa de 1.25x la carga media
+#define POOL_HEALTH_INTERVAL_MS 5000    // Cada cuánto se comprueban los endpoints
+#define POOL_HEALTH_TIMEOUT_S   1       // Conexión y lectura de cada comprobación
+
+// Estado de un endpoint visto desde este proceso.
+struct EndpointStatus {
+    std::string url;
+    bool healthy = true;        // Hasta la primera comprobación se supone que responde
+    bool draining = false;      // No recibe peticiones nuevas; sus sesiones pasan a otro
+    int inFlight = 0;           // Peticiones en curso de este proceso; Ollama no informa de las demás
+    long served = 0;
+    std::vector<std::string> runningModels;  // Última respuesta de list_running_models()
+};
+
+// Reparte las peticiones entre varios servidores de Ollama. Las de una misma sesión van
+// siempre al mismo endpoint (hashing consistente sobre el id de sesión), así la caché del
+// prompt de esa conversación sigue caliente en un solo servidor. Si el endpoint cae o se
+// drena, sus sesiones pasan al siguiente del anillo y las demás no se mueven; cuando vuelve,
+// regresan. Sin sesión gana el que tiene menos peticiones en curso. La carga es la de este
+// proceso: varios procesos reparten cada uno por su cuenta. Un hilo en segundo plano
+// comprueba is_running() y list_running_models() de cada endpoint.
+class EndpointPool {
+public:
+    explicit EndpointPool(const std::vector<std::string> &urls);
+    ~EndpointPool();
+
+    // Endpoints en orden de preferencia para la sesión (vacía: por carga, y a igualdad el que
+    // ya tiene model cargado). Los caídos o drenados van al final por si no queda otro.
+    std::vector<std::string> route(const std::string &session, const std::string &model = "");
+
+    // Peticiones en curso, para el reparto por carga. Se ignoran las URL que no son del pool.
+    void acquire(const std::string &url);
+    void release(const std::string &url);
+
+    // Resultado visto en una petición real, sin esperar a la siguiente comprobación.
+    void mark_down(const std::string &url);
+    void mark_up(const std::string &url);
+
+    // Retira un endpoint (mantenimiento) o lo devuelve al reparto.
+    void drain(const std::string &url);
+    void restore(const std::string &url);
+
+    void check_health();
+    void start_health_checks(int intervalMs = POOL_HEALTH_INTERVAL_MS);
+    void stop_health_checks();
+
+    std::vector<EndpointStatus> status();
+    long rehomed() const { return rehomedSessions; }
+    size_t size() const { return endpoints.size(); }
+
+private:
+    int index_of(const std::string &url) const;
+    bool available(size_t index) const;
+    void set_healthy(size_t index, bool healthy, const std::vector<std::string> *models);
+
+    std::mutex mtx;
+    std::vector<EndpointStatus> endpoints;
+    std::vector<std::pair<uint64_t, size_t>> ring;   // (hash, endpoint), ordenado por hash
+    std::map<std::string, size_t> homes;             // Último endpoint de cada sesión
+    std::atomic<long> rehomedSessions{0};
+
+    std::thread healthThread;
+    std::condition_variable healthCv;
+    bool stopping = false;
+};
+
+// Hash estable entre procesos y compilaciones (FNV-1a con mezcla final), a diferencia de std::hash.
+uint64_t pool_hash(const std::string &key);
+
+void poollog(const std::string &message);
+
+#endif // ENDPOINT_POOL_HPP
@@ -0,0 +1,34 @@
+#include "logging.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits.h>
+#include <mutex>
+#include <unistd.h>
+
+void write_log(const std::string &file, const std::string &message) {
+    static std::mutex mtx;
+
+    std::string logFilePath = LOG_DIRECTORY + file;
+    std::lock_guard<std::mutex> lock(mtx);
+    std::error_code ignored;
+    std::filesystem::create_directories(LOG_DIRECTORY, ignored);
+    std::ofstream logFile(logFilePath, std::ios::app); // Open in append mode
+    if (logFile) {
+        logFile << message << std::endl;
+    } else {
+        std::cerr << "❌ Error: No se pudo abrir el archivo de registro en " << logFilePath << std::endl;
+    }
+}
+
+// Function that always points to the /commands directory relative to ROOT_DIR
+std::string get_commands_directory() {
+    char result[PATH_MAX];
+    ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
+    if (count != -1) {
+        std::string path(result, count);
+        // Forcefully target the parent directory where the executable is stored
+        return std::filesystem::path(path).parent_path().string();
+    }
+    return "";
+}
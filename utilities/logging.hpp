@@ -0,0 +1,17 @@
+#ifndef LOGGING_HPP
+#define LOGGING_HPP
+
+#include <string>
+
+#define LOG_DIRECTORY "../logs/"
+
+// Añade message como una línea a ../logs/<file>, creando la carpeta si hace falta. Si no se
+// puede abrir el archivo lo avisa por stderr. Cada módulo tiene su función de log (modelog,
+// poollog, ...) que solo elige el archivo. Thread-safe.
+void write_log(const std::string &file, const std::string &message);
+
+// Carpeta del ejecutable (commands/). Los comandos se lanzan con alias desde cualquier
+// carpeta: los archivos compartidos entre ejecuciones se anclan aquí. Vacío si no se sabe.
+std::string get_commands_directory();
+
+#endif // LOGGING_HPP
@@ -0,0 +1,62 @@
+#include "metrics.hpp"
+#include "logging.hpp"
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+void record_metric(const std::string &event, const nlohmann::json &fields) {
+    static std::mutex mtx;
+
+    nlohmann::json line = {
+        {"ts", std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count()},
+        {"event", event},
+    };
+    if (fields.is_object()) line.update(fields);
+
+    // Como usage_file_path: amfq y chat se lanzan con alias desde cualquier carpeta
+    static const std::string path = get_commands_directory() + "/../logs/" METRICS_FILE;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    std::error_code ignored; // Sin carpeta de logs se avisa abajo; la petición sigue
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ignored);
+    std::ofstream file(path, std::ios::app);
+    if (file) {
+        file << line.dump() << '\n';
+    } else {
+        std::cerr << "❌ Error: No se pudo abrir el archivo de métricas en " << path << std::endl;
+    }
+}
+
+static double clock_seconds(clockid_t clock) {
+    timespec ts{};
+    if (clock_gettime(clock, &ts) != 0) return 0.0;
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double thread_cpu_seconds() {
+    return clock_seconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+double process_cpu_seconds() {
+    return clock_seconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+ResidentMemory resident_memory() {
+    ResidentMemory memory;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        long kb = 0;
+        if (!(fields >> key >> kb)) continue;
+        if (key == "VmRSS:") memory.total_kb = kb;
+        else if (key == "RssAnon:") memory.anon_kb = kb;
+        else if (key == "RssFile:") memory.file_kb = kb;
+    }
+    return memory;
+}
@@ -0,0 +1,26 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include "json.hpp"
+
+#define METRICS_FILE "metrics.jsonl"   // En logs/, junto a la carpeta del ejecutable
+
+// Métricas de rendimiento como líneas JSON en logs/metrics.jsonl, una por evento:
+// {"ts": <epoch s>, "event": "<nombre>", ...campos}. Thread-safe.
+void record_metric(const std::string &event, const nlohmann::json &fields);
+
+// Tiempo de CPU consumido por el hilo que llama / por todo el proceso, en segundos.
+double thread_cpu_seconds();
+double process_cpu_seconds();
+
+// Memoria residente del proceso (/proc/self/status), en kB: total (VmRSS), privada
+// (RssAnon) y respaldada por archivos (RssFile, compartible con otros procesos).
+struct ResidentMemory {
+    long total_kb = 0;
+    long anon_kb = 0;
+    long file_kb = 0;
+};
+ResidentMemory resident_memory();
+
+#endif // METRICS_HPP
@@ -0,0 +1,357 @@
+#include "model_preloader.hpp"
+#include "logging.hpp"
+#include "call_the_model.hpp"
+#include "metrics.hpp"
+#include "model_profiles.hpp"
+#include "request_policy.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <unistd.h>
+
+#define PRELOAD_CONNECT_TIMEOUT_S   2
+#define PRELOAD_LOAD_TIMEOUT_S      600     // Un modelo grande en CPU puede tardar minutos en cargar
+
+//Logging error and success messages from other functions
+void preloadlog(const std::string &message) {
+    write_log("model_preloader.log", message);
+}
+
+static double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Minuto del día y día (hora local) de un instante
+static int minute_of_day(double ts, long *day = nullptr) {
+    time_t t = static_cast<time_t>(ts);
+    tm local {};
+    localtime_r(&t, &local);
+    if (day) *day = local.tm_year * 400L + local.tm_yday;
+    return local.tm_hour * 60 + local.tm_min;
+}
+
+// /api/ps devuelve "deepseek-coder:latest" aunque se pidiera "deepseek-coder"
+static std::string with_tag(const std::string &model) {
+    return model.find(':') == std::string::npos ? model + ":latest" : model;
+}
+
+std::string usage_file_path() {
+    // Como guardar_en_log: amfq y chat se lanzan con alias desde cualquier carpeta
+    return get_commands_directory() + "/../logs/" USAGE_FILE_NAME;
+}
+
+void record_model_usage(const std::string &command, const std::string &model) {
+    static std::mutex mtx;
+    nlohmann::json line = {
+        {"ts", now_seconds()},
+        {"uid", getuid()},
+        {"command", command},
+        {"model", model},
+    };
+
+    // Una línea corta en modo append: los procesos que escriben a la vez no se mezclan
+    std::lock_guard<std::mutex> lock(mtx);
+    std::string path = usage_file_path();
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    std::ofstream file(path, std::ios::app);
+    if (file) {
+        file << line.dump() << '\n';
+    } else {
+        preloadlog("❌ No se pudo abrir " + path);
+    }
+}
+
+long available_memory_mb() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key, unit;
+    long kb = 0;
+    while (meminfo >> key >> kb >> unit) {
+        if (key == "MemAvailable:") return kb / 1024;
+    }
+    return 0;
+}
+
+UsageModel::UsageModel(unsigned uid, const std::string &path) : uid(uid), path(path) {}
+
+void UsageModel::add(const ModelUsage &usage) {
+    if (usage.uid == uid && !usage.model.empty()) events.push_back(usage);
+}
+
+void UsageModel::refresh() {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return;
+    file.seekg(0, std::ios::end);
+    std::streamoff end = file.tellg();
+    if (end < offset) {
+        // El archivo se vació o se rotó: se vuelve a aprender desde el principio
+        offset = 0;
+        events.clear();
+    }
+    if (end == offset) return;
+
+    std::string chunk(static_cast<size_t>(end - offset), '\0');
+    file.seekg(offset);
+    file.read(&chunk[0], static_cast<std::streamsize>(chunk.size()));
+    // Una línea a medio escribir se queda para la próxima vez
+    size_t complete = chunk.rfind('\n');
+    if (complete == std::string::npos) return;
+    offset += static_cast<std::streamoff>(complete + 1);
+
+    std::istringstream lines(chunk.substr(0, complete));
+    for (std::string line; std::getline(lines, line);) {
+        try {
+            nlohmann::json entry = nlohmann::json::parse(line);
+            ModelUsage usage;
+            usage.ts = entry.value("ts", 0.0);
+            usage.uid = entry.value("uid", 0u);
+            usage.command = entry.value("command", "");
+            usage.model = entry.value("model", "");
+            add(usage);
+        } catch (const std::exception &e) {
+            preloadlog("Línea de " + path + " no válida descartada");
+        }
+    }
+
+    double oldest = now_seconds() - PRELOAD_HISTORY_DAYS * 86400.0;
+    events.erase(events.begin(), std::find_if(events.begin(), events.end(), [oldest](const ModelUsage &u) { return u.ts >= oldest; }));
+}
+
+std::vector<PreloadCandidate> UsageModel::predict(double now, int lookaheadMin, double minScore) const {
+    // Por modelo base: fast_response y chat_response son la misma carga
+    std::map<std::string, std::map<long, double>> byDay;   // modelo -> día -> peso (uno por día)
+    std::map<std::string, double> afterLast;                // modelo -> peso tras el último comando
+    std::map<std::string, std::string> asked;               // modelo -> nombre pedido más reciente
+    int nowMinute = minute_of_day(now);
+    const ModelUsage *last = events.empty() ? nullptr : &events.back();
+    bool switching = last && now - last->ts <= PRELOAD_TRANSITION_MIN * 60.0;
+
+    for (size_t i = 0; i < events.size(); ++i) {
+        const ModelUsage &usage = events[i];
+        double ageDays = (now - usage.ts) / 86400.0;
+        if (ageDays < 0 || ageDays > PRELOAD_HISTORY_DAYS) continue;
+        double weight = std::pow(0.5, ageDays / PRELOAD_HALF_LIFE_DAYS);
+        std::string model = base_model(usage.model);
+        asked[model] = usage.model;
+
+        // Misma hora del día: desde media ventana antes hasta lookahead minutos después
+        long day = 0;
+        int after = (minute_of_day(usage.ts, &day) - nowMinute + 1440) % 1440;
+        if (after <= lookaheadMin || after >= 1440 - lookaheadMin / 2) {
+            double &best = byDay[model][day];
+            best = std::max(best, weight);
+        }
+
+        // Lo que suele venir después del mismo comando que se acaba de usar
+        if (switching && i > 0) {
+            const ModelUsage &previous = events[i - 1];
+            if (previous.command == last->command && usage.ts - previous.ts <= PRELOAD_TRANSITION_MIN * 60.0) {
+                afterLast[model] += weight;
+            }
+        }
+    }
+
+    std::map<std::string, PreloadCandidate> scored;
+    for (const auto &[model, days] : byDay) {
+        PreloadCandidate &candidate = scored[model];
+        candidate.model = asked[model];
+        for (const auto &entry : days) candidate.score += entry.second;
+        candidate.reason = "a esta hora " + std::to_string(days.size()) + " días";
+    }
+    for (const auto &[model, weight] : afterLast) {
+        PreloadCandidate &candidate = scored[model];
+        candidate.model = asked[model];
+        candidate.score += weight;
+        candidate.reason += std::string(candidate.reason.empty() ? "" : ", ") + "después de " + last->command;
+    }
+
+    std::vector<PreloadCandidate> candidates;
+    for (const auto &entry : scored) {
+        if (entry.second.score >= minScore) candidates.push_back(entry.second);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const PreloadCandidate &a, const PreloadCandidate &b) { return a.score > b.score; });
+    return candidates;
+}
+
+ModelPreloader::ModelPreloader(const std::string &endpoint, unsigned uid, const PreloadConfig &config)
+    : endpoint(endpoint), config(config), usage(uid) {}
+
+ModelPreloader::~ModelPreloader() {
+    stop();
+}
+
+std::vector<PreloadCandidate> ModelPreloader::predictions() {
+    std::lock_guard<std::mutex> lock(mtx);
+    usage.refresh();
+    return usage.predict(now_seconds(), config.lookahead_min, config.min_score);
+}
+
+std::vector<std::string> ModelPreloader::run_once() {
+    std::lock_guard<std::mutex> lock(mtx);
+    usage.refresh();
+    std::vector<PreloadCandidate> candidates = usage.predict(now_seconds(), config.lookahead_min, config.min_score);
+    std::vector<std::string> loadedNow;
+    if (candidates.empty()) return loadedNow;
+
+    Ollama client(endpoint);
+    client.setConnectionTimeout(PRELOAD_CONNECT_TIMEOUT_S);
+    client.setReadTimeout(PRELOAD_LOAD_TIMEOUT_S);
+    {
+        std::lock_guard<std::mutex> clientLock(clientMtx);
+        if (cancelled) return loadedNow;
+        activeClient = &client;
+    }
+    // El cliente es local: stop() no debe verlo después de esta función
+    struct Detach {
+        ModelPreloader *self;
+        ~Detach() {
+            std::lock_guard<std::mutex> clientLock(self->clientMtx);
+            self->activeClient = nullptr;
+        }
+    } detach{this};
+    // La memoria de /proc/meminfo es la de esta máquina: con un servidor remoto no dice nada
+    const bool local = is_local_endpoint(endpoint);
+
+    // Lo que ya está en memoria y cuánto ocupa
+    std::map<std::string, long> running;
+    long usedBytes = 0;
+    try {
+        nlohmann::json ps = client.running_model_json();
+        for (const nlohmann::json &model : ps.value("models", nlohmann::json::array())) {
+            std::string name = with_tag(model.value("name", ""));
+            long size = model.value("size", 0L);
+            running[name] = size;
+            knownSizes[name] = size;
+            usedBytes += size;
+        }
+    } catch (const std::exception &e) {
+        preloadlog("⚠️ " + endpoint + " no responde, no se precarga nada: " + e.what());
+        return loadedNow;
+    }
+
+    std::set<std::string> handled;
+    for (const PreloadCandidate &candidate : candidates) {
+        // Los perfiles comparten modelo base: se carga una vez, con sus opciones de carga
+        std::string base = base_model(candidate.model);
+        std::string tagged = with_tag(base);
+        if (!handled.insert(tagged).second) continue;
+        nlohmann::json options = load_options(candidate.model);
+
+        try {
+            if (running.count(tagged)) {
+                // Ya cargado: se alarga keep_alive para que no caduque justo antes de usarlo
+                client.load_model(base, options, config.keep_alive);
+                continue;
+            }
+        } catch (const std::exception &e) {
+            preloadlog("⚠️ No se pudo renovar " + base + ": " + e.what());
+            continue;
+        }
+
+        // Cargar otro modelo con el servidor lleno haría que Ollama descargara uno, quizá en uso
+        if (static_cast<int>(running.size()) >= config.max_models) {
+            if (skipped.insert(tagged).second) {
+                preloadlog("⏭️ " + base + " no se precarga: ya hay " + std::to_string(running.size()) + " modelos cargados");
+            }
+            continue;
+        }
+        long sizeMb = 0;
+        if (knownSizes.count(tagged)) {
+            sizeMb = knownSizes[tagged] / (1024 * 1024);
+        } else {
+            try {
+                for (const nlohmann::json &model : client.list_model_json().value("models", nlohmann::json::array())) {
+                    if (with_tag(model.value("name", "")) == tagged) sizeMb = model.value("size", 0L) / (1024 * 1024);
+                }
+            } catch (const std::exception &e) {
+                preloadlog("⚠️ No se pudo consultar el tamaño de " + base + ": " + e.what());
+            }
+        }
+        long freeMb = local ? available_memory_mb() - PRELOAD_HEADROOM_MB : 0;
+        long usedMb = usedBytes / (1024 * 1024);
+        if (sizeMb <= 0 || (local && sizeMb > freeMb) || (config.memory_mb > 0 && usedMb + sizeMb > config.memory_mb)) {
+            // Se registra una vez, no en cada pasada
+            if (skipped.insert(tagged).second) {
+                preloadlog("⏭️ " + base + " no se precarga: " + std::to_string(sizeMb) + " MB" +
+                           (local ? ", libres " + std::to_string(freeMb) + " MB" : "") + ", en uso " + std::to_string(usedMb) +
+                           (config.memory_mb > 0 ? " de " + std::to_string(config.memory_mb) : "") + " MB");
+            }
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = false;
+        std::string error;
+        try {
+            ok = client.load_model(base, options, config.keep_alive);
+        } catch (const std::exception &e) {
+            error = e.what();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> clientLock(clientMtx);
+            if (cancelled) {
+                preloadlog("⏹️ Precarga de " + base + " cancelada tras " + std::to_string(seconds) + " s");
+                break;
+            }
+        }
+        preloadlog((ok ? "✅ Precargado " : "❌ No se pudo precargar ") + base + " (" + candidate.reason + ") en " +
+                   std::to_string(seconds) + " s" + (error.empty() ? "" : ": " + error));
+        record_metric("model_preload", {
+            {"model", candidate.model},
+            {"loaded", base},
+            {"endpoint", endpoint},
+            {"score", candidate.score},
+            {"reason", candidate.reason},
+            {"size_mb", sizeMb},
+            {"load_s", seconds},
+            {"ok", ok},
+        });
+        if (ok) {
+            skipped.erase(tagged);
+            running[tagged] = sizeMb * 1024 * 1024;
+            usedBytes += sizeMb * 1024 * 1024;
+            loadedNow.push_back(base);
+        }
+    }
+    return loadedNow;
+}
+
+void ModelPreloader::start() {
+    std::lock_guard<std::mutex> lock(stateMtx);
+    if (thread.joinable()) return;
+    stopping = false;
+    {
+        std::lock_guard<std::mutex> clientLock(clientMtx);
+        cancelled = false;
+    }
+    thread = std::thread([this] {
+        std::unique_lock<std::mutex> lock(stateMtx);
+        while (!stopping) {
+            lock.unlock();
+            run_once();
+            lock.lock();
+            cv.wait_for(lock, std::chrono::seconds(config.interval_s), [this] { return stopping; });
+        }
+    });
+}
+
+void ModelPreloader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stateMtx);
+        stopping = true;
+    }
+    {
+        // A cold load can take minutes: abort it instead of waiting for it to finish
+        std::lock_guard<std::mutex> clientLock(clientMtx);
+        cancelled = true;
+        if (activeClient) activeClient->stop();
+    }
+    cv.notify_all();
+    if (thread.joinable()) thread.join();
+}
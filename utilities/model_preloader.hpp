@@ -0,0 +1,119 @@
+#ifndef MODEL_PRELOADER_HPP
+#define MODEL_PRELOADER_HPP
+
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ollama.hpp"
+
+#define USAGE_FILE_NAME         "model_usage.jsonl"  // En logs/, junto a la carpeta de los comandos
+#define PRELOAD_INTERVAL_S      60      // Cada cuánto se revisa qué modelos hacen falta
+#define PRELOAD_LOOKAHEAD_MIN   20      // Se carga lo que se espera usar en los próximos 20 min
+#define PRELOAD_HALF_LIFE_DAYS  14      // El peso de un uso se reduce a la mitad cada dos semanas
+#define PRELOAD_HISTORY_DAYS    42      // Usos más antiguos ya no cuentan
+#define PRELOAD_MIN_SCORE       1.5     // Unos dos días recientes a esa hora, o dos veces tras el mismo comando
+#define PRELOAD_TRANSITION_MIN  30      // Un comando menos de 30 min después de otro cuenta como cambio
+#define PRELOAD_MAX_MODELS      3       // OLLAMA_MAX_LOADED_MODELS por defecto sin GPU
+#define PRELOAD_HEADROOM_MB     1024    // Memoria libre que se deja siempre al sistema
+#define PRELOAD_KEEP_ALIVE      "30m"
+
+// Un uso de un modelo: quién, con qué comando (amfq, amfq_detail, chat, chat_detail) y cuándo.
+struct ModelUsage {
+    double ts = 0;
+    unsigned uid = 0;
+    std::string command;
+    std::string model;
+};
+
+// logs/model_usage.jsonl junto a la carpeta de los comandos, se arranque desde donde se arranque.
+std::string usage_file_path();
+
+// Añade el uso a usage_file_path(). Lo llaman amfq, chat y OVA en cada pregunta.
+void record_model_usage(const std::string &command, const std::string &model);
+
+// Modelo que conviene tener cargado ya, con su puntuación (aprox. días o veces que se usó
+// en esa situación, las recientes pesan más) y el motivo.
+struct PreloadCandidate {
+    std::string model;      // Nombre pedido (perfil o modelo)
+    double score = 0;
+    std::string reason;
+};
+
+// Clave "preload" de opcions.json (config().preload); sin ella OVA no arranca el hilo de precarga.
+struct PreloadConfig {
+    bool enabled = false;
+    long memory_mb = 0;     // 0: solo la memoria libre del sistema
+    int max_models = PRELOAD_MAX_MODELS;
+    int interval_s = PRELOAD_INTERVAL_S;
+    int lookahead_min = PRELOAD_LOOKAHEAD_MIN;
+    double min_score = PRELOAD_MIN_SCORE;
+    std::string keep_alive = PRELOAD_KEEP_ALIVE;
+};
+
+// Lo que un usuario suele usar según la hora del día y el comando anterior. Aprende de
+// usage_file_path(), leyendo en cada refresh() solo las líneas nuevas. Los perfiles se agrupan por
+// modelo base, que es lo que se carga.
+class UsageModel {
+public:
+    explicit UsageModel(unsigned uid, const std::string &path = usage_file_path());
+
+    void refresh();
+    void add(const ModelUsage &usage);
+    std::vector<PreloadCandidate> predict(double now, int lookaheadMin, double minScore) const;
+    size_t size() const { return events.size(); }
+
+private:
+    unsigned uid;
+    std::string path;
+    std::streamoff offset = 0;
+    std::vector<ModelUsage> events;     // Del usuario, en orden de llegada
+};
+
+// Carga en segundo plano los modelos que se van a usar antes de que llegue la pregunta.
+// Mira list_running_models() y solo carga lo que cabe en la memoria y en max_models sin
+// que Ollama tenga que descargar otro modelo; nunca descarga nada, así que no puede
+// quitar un modelo en uso. A los modelos ya cargados que se esperan les renueva keep_alive.
+// La memoria libre de esta máquina solo cuenta si el endpoint es local; con un servidor
+// remoto los límites son memory_mb y max_models.
+class ModelPreloader {
+public:
+    ModelPreloader(const std::string &endpoint, unsigned uid, const PreloadConfig &config);
+    ~ModelPreloader();
+
+    // Una pasada: predice, mira qué hay cargado y carga lo que quepa. Devuelve lo cargado.
+    std::vector<std::string> run_once();
+    std::vector<PreloadCandidate> predictions();
+
+    void start();
+    void stop();
+
+private:
+    std::string endpoint;
+    PreloadConfig config;
+    UsageModel usage;
+    std::map<std::string, long> knownSizes;     // Bytes en memoria vistos en /api/ps
+    std::set<std::string> skipped;              // Ya registrados como que no caben
+    std::mutex mtx;                             // usage y knownSizes; se mantiene durante una carga
+
+    std::mutex stateMtx;
+    std::thread thread;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    // stop() corta la carga en curso (puede tardar minutos) en lugar de esperarla
+    std::mutex clientMtx;
+    Ollama *activeClient = nullptr;
+    bool cancelled = false;
+};
+
+// Memoria disponible del sistema (MemAvailable de /proc/meminfo), en MB.
+long available_memory_mb();
+
+void preloadlog(const std::string &message);
+
+#endif // MODEL_PRELOADER_HPP
@@ -0,0 +1,125 @@
+#include "model_profiles.hpp"
+#include "logging.hpp"
+#include "call_the_model.hpp"
+#include "metrics.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+
+//Logging error and success messages from other functions
+void profilelog(const std::string &message) {
+    write_log("model_profiles.log", message);
+}
+
+// Opciones que se fijan al cargar el runner: si cambian entre peticiones, Ollama lo recarga
+static const std::set<std::string> loadTimeOptions = {
+    "num_ctx", "num_batch", "num_gpu", "main_gpu", "low_vram", "use_mmap", "use_mlock", "numa", "num_thread",
+};
+
+struct ProfileTable {
+    std::map<std::string, ModelProfile> profiles;
+    std::map<std::string, std::string> aliases;
+};
+
+static const ProfileTable &profile_table() {
+    static const ProfileTable table = [] {
+        ProfileTable loaded;
+        std::string path = get_commands_directory() + PROFILES_FILE;
+        std::ifstream file(path);
+        if (!file) {
+            profilelog("⚠️ No se encontró " + path + ": los modelos se piden por su nombre");
+            return loaded;
+        }
+        try {
+            nlohmann::json config = nlohmann::json::parse(file);
+            std::string base = config.at("base_model").get<std::string>();
+            for (const auto &[name, entry] : config.at("profiles").items()) {
+                ModelProfile profile;
+                profile.name = name;
+                profile.base_model = entry.value("base_model", base);
+                profile.system = entry.value("system", "");
+                nlohmann::json options = entry.value("options", nlohmann::json::object());
+                for (const auto &[key, value] : options.items()) {
+                    if (loadTimeOptions.count(key)) {
+                        profilelog("⚠️ Perfil " + name + ": " + key + " se ignora, obligaría a recargar el modelo en cada cambio de perfil");
+                        continue;
+                    }
+                    profile.options[key] = value;
+                }
+                // El mismo num_thread para todos: es lo que hacía recargar entre fast_response y chat_response
+                if (config.contains("num_thread")) profile.options["num_thread"] = config["num_thread"];
+                loaded.profiles[name] = profile;
+            }
+            nlohmann::json aliases = config.value("aliases", nlohmann::json::object());
+            for (const auto &[alias, name] : aliases.items()) {
+                if (loaded.profiles.count(name.get<std::string>())) loaded.aliases[alias] = name.get<std::string>();
+                else profilelog("⚠️ Alias " + alias + " apunta a un perfil que no existe: " + name.dump());
+            }
+        } catch (const std::exception &e) {
+            profilelog("❌ " + path + " no válido, los modelos se piden por su nombre: " + e.what());
+            return ProfileTable();
+        }
+        return loaded;
+    }();
+    return table;
+}
+
+const ModelProfile *model_profile(const std::string &model) {
+    const ProfileTable &table = profile_table();
+    auto alias = table.aliases.find(model);
+    auto profile = table.profiles.find(alias != table.aliases.end() ? alias->second : model);
+    return profile != table.profiles.end() ? &profile->second : nullptr;
+}
+
+std::string base_model(const std::string &model) {
+    const ModelProfile *profile = model_profile(model);
+    return profile ? profile->base_model : model;
+}
+
+nlohmann::json load_options(const std::string &model) {
+    nlohmann::json options = nlohmann::json::object();
+    const ModelProfile *profile = model_profile(model);
+    if (!profile) return options;
+    for (const auto &[key, value] : profile->options.items()) {
+        if (loadTimeOptions.count(key)) options[key] = value;
+    }
+    return options;
+}
+
+void apply_model_profile(ollama::request &request) {
+    if (!request.contains("model") || !request["model"].is_string()) return;
+    const ModelProfile *profile = model_profile(request["model"].get<std::string>());
+    if (!profile) return;
+
+    request["model"] = profile->base_model;
+    nlohmann::json options = profile->options;
+    if (request.contains("options")) {
+        for (const auto &[key, value] : request["options"].items()) options[key] = value;
+    }
+    request["options"] = options;
+
+    if (profile->system.empty()) return;
+    if (request.contains("messages")) {
+        nlohmann::json &messages = request["messages"];
+        if (messages.empty() || messages[0].value("role", "") != "system") {
+            nlohmann::json system = {{"role", "system"}, {"content", profile->system}};
+            messages.insert(messages.begin(), system);
+        }
+    } else if (!request.contains("system")) {
+        request["system"] = profile->system;
+    }
+}
+
+void record_model_load(const std::string &requested, const std::string &loaded, const std::string &endpoint, int64_t loadDurationNs) {
+    double seconds = loadDurationNs / 1e9;
+    if (seconds * 1000 < PROFILE_RELOAD_MS) return;
+    profilelog("⏳ " + endpoint + " cargó " + loaded + " para " + requested + ": " + std::to_string(seconds) + " s");
+    record_metric("ollama_model_load", {
+        {"model", requested},
+        {"loaded", loaded},
+        {"endpoint", endpoint},
+        {"load_s", seconds},
+    });
+}
@@ -0,0 +1,43 @@
+#ifndef MODEL_PROFILES_HPP
+#define MODEL_PROFILES_HPP
+
+#include <cstdint>
+#include <string>
+#include "ollama.hpp"
+
+#define PROFILES_FILE           "/../utilities/models/profiles.json"   // Relativo a la carpeta commands
+#define PROFILE_RELOAD_MS       500     // load_duration por encima: el servidor cargó el modelo para esa petición
+
+// Lo que antes era un MODELFILE (fast_response_assistant, ...): opciones y SYSTEM que se
+// aplican en cada petición sobre un único modelo base. Como todos los perfiles comparten
+// modelo y num_thread, pasar de amfq a chat -d no obliga al servidor a cargar otro runner.
+struct ModelProfile {
+    std::string name;
+    std::string base_model;
+    std::string system;
+    nlohmann::json options = nlohmann::json::object();
+};
+
+// Perfil de ese nombre, o del que le corresponde en "aliases" (los nombres antiguos de
+// opcions.json). nullptr si es un modelo real de Ollama, que se pide tal cual.
+const ModelProfile *model_profile(const std::string &model);
+
+// Modelo que el servidor carga de verdad para ese nombre.
+std::string base_model(const std::string &model);
+
+// Opciones de carga (num_thread) que enviarán las peticiones con ese nombre. Cargar el
+// modelo sin ellas deja un runner que la primera petición tendría que recargar.
+nlohmann::json load_options(const std::string &model);
+
+// Si request["model"] es un perfil: lo cambia por el modelo base, pone sus opciones por
+// debajo de las de la petición y su SYSTEM delante, como hace Ollama con el del Modelfile
+// (solo si los mensajes no empiezan ya por uno de sistema).
+void apply_model_profile(ollama::request &request);
+
+// Registra la carga en metrics.jsonl (ollama_model_load) si la respuesta trae un
+// load_duration de más de PROFILE_RELOAD_MS: esa petición esperó a que se cargara el modelo.
+void record_model_load(const std::string &requested, const std::string &loaded, const std::string &endpoint, int64_t loadDurationNs);
+
+void profilelog(const std::string &message);
+
+#endif // MODEL_PROFILES_HPP
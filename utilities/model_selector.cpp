@@ -0,0 +1,171 @@
+#include "model_selector.hpp"
+#include "logging.hpp"
+#include "transcriber.hpp"
+#include "json.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+//Logging error and success messages from other functions
+void selectorlog(const std::string& message) {
+    write_log("model_selector.log", message);
+}
+
+// CPU model + core count: a cache calibrated on another machine is ignored
+static std::string cpu_fingerprint() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line, model = "unknown";
+    while (std::getline(cpuinfo, line)) {
+        if (line.rfind("model name", 0) == 0) {
+            model = line.substr(line.find(':') + 2);
+            break;
+        }
+    }
+    return model + " x" + std::to_string(std::thread::hardware_concurrency());
+}
+
+static std::vector<std::string> normalized_words(const std::string &text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : text) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '\'') {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        } else if (!word.empty()) {
+            words.push_back(word);
+            word.clear();
+        }
+    }
+    if (!word.empty()) words.push_back(word);
+    return words;
+}
+
+double word_error_rate(const std::string &reference, const std::string &hypothesis) {
+    std::vector<std::string> ref = normalized_words(reference);
+    std::vector<std::string> hyp = normalized_words(hypothesis);
+    if (ref.empty()) return hyp.empty() ? 0.0 : 1.0;
+
+    // Levenshtein over words, one row at a time
+    std::vector<size_t> prev(hyp.size() + 1), curr(hyp.size() + 1);
+    for (size_t j = 0; j <= hyp.size(); ++j) prev[j] = j;
+    for (size_t i = 1; i <= ref.size(); ++i) {
+        curr[0] = i;
+        for (size_t j = 1; j <= hyp.size(); ++j) {
+            size_t substitution = prev[j - 1] + (ref[i - 1] == hyp[j - 1] ? 0 : 1);
+            curr[j] = std::min({prev[j] + 1, curr[j - 1] + 1, substitution});
+        }
+        std::swap(prev, curr);
+    }
+    return static_cast<double>(prev[hyp.size()]) / ref.size();
+}
+
+std::vector<ModelBenchmark> benchmark_whisper_models(const std::string &modelsDir, const std::string &clip,
+                                                     const std::string &reference) {
+    std::vector<ModelBenchmark> results;
+    if (!std::filesystem::exists(clip)) {
+        selectorlog("❌ Error: No se encontró el clip de referencia " + clip);
+        return results;
+    }
+
+    std::vector<std::string> models;
+    for (const auto &entry : std::filesystem::directory_iterator(modelsDir)) {
+        std::string name = entry.path().filename().string();
+        // ggml-tiny.bin, ggml-base.en-q5_1.bin, ... but not the test stubs shipped with whisper.cpp
+        if (entry.is_regular_file() && name.rfind("ggml-", 0) == 0 && entry.path().extension() == ".bin" &&
+            name.find("for-tests") == std::string::npos && entry.file_size() > 0) {
+            models.push_back(entry.path().string());
+        }
+    }
+    std::sort(models.begin(), models.end());
+
+    for (const std::string &model : models) {
+        ModelBenchmark bench;
+        bench.path = model;
+
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<Transcriber> transcriber = Transcriber::open(model, clip); // A corrupt model is skipped
+        bench.load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // First pass warms caches and allocators; keep the best of the timed passes
+        TranscriptionResult result;
+        if (transcriber) result = transcriber->transcribe_file(clip);
+        for (int pass = 0; pass < 2 && result.ok; ++pass) {
+            TranscriptionResult timed = transcriber->transcribe_file(clip);
+            if (timed.ok && timed.processing_seconds < result.processing_seconds) result = timed;
+        }
+
+        if (result.ok && result.audio_seconds > 0) {
+            bench.rtf = result.processing_seconds / result.audio_seconds;
+            bench.wer = word_error_rate(reference, result.text);
+            bench.ok = true;
+        }
+
+        std::ostringstream msg;
+        msg << "Modelo " << model << ": rtf=" << bench.rtf << " wer=" << bench.wer
+            << " carga=" << bench.load_seconds << "s" << (bench.ok ? "" : " (falló)");
+        selectorlog(msg.str());
+        results.push_back(bench);
+    }
+    return results;
+}
+
+std::string select_and_cache_model(const std::vector<ModelBenchmark> &results, double rtfBudget) {
+    const ModelBenchmark *best = nullptr;
+    const ModelBenchmark *fastest = nullptr;
+    for (const ModelBenchmark &bench : results) {
+        if (!bench.ok) continue;
+        if (!fastest || bench.rtf < fastest->rtf) fastest = &bench;
+        if (bench.rtf > rtfBudget) continue;
+        if (!best || bench.wer < best->wer || (bench.wer == best->wer && bench.rtf < best->rtf)) best = &bench;
+    }
+    if (!best) best = fastest; // nothing runs in budget: at least take the quickest one
+    if (!best) {
+        selectorlog("❌ Error: Ningún modelo pudo medirse, no se actualiza la caché.");
+        return "";
+    }
+
+    nlohmann::json cache;
+    cache["model"] = best->path;
+    cache["rtf_budget"] = rtfBudget;
+    cache["cpu"] = cpu_fingerprint();
+    cache["results"] = nlohmann::json::array();
+    for (const ModelBenchmark &bench : results) {
+        cache["results"].push_back({{"model", bench.path}, {"rtf", bench.rtf}, {"wer", bench.wer},
+                                    {"load_s", bench.load_seconds}, {"ok", bench.ok}});
+    }
+
+    std::ofstream out(MODEL_SELECTION_CACHE);
+    if (!out) {
+        selectorlog("❌ Error: No se pudo escribir " + std::string(MODEL_SELECTION_CACHE));
+        return best->path;
+    }
+    out << cache.dump(4) << std::endl;
+    selectorlog("✅ Modelo elegido: " + best->path);
+    return best->path;
+}
+
+std::string cached_whisper_model(const std::string &fallback) {
+    std::ifstream in(MODEL_SELECTION_CACHE);
+    if (!in) return fallback;
+
+    try {
+        nlohmann::json cache;
+        in >> cache;
+        std::string model = cache.value("model", "");
+        if (cache.value("cpu", "") != cpu_fingerprint()) {
+            selectorlog("⚠️ La calibración se hizo en otra CPU, usando " + fallback);
+            return fallback;
+        }
+        if (model.empty() || !std::filesystem::exists(model)) {
+            selectorlog("⚠️ El modelo en caché no existe, usando " + fallback);
+            return fallback;
+        }
+        return model;
+    } catch (const std::exception &e) {
+        selectorlog(std::string("❌ Caché de modelo inválida: ") + e.what());
+        return fallback;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef MODEL_SELECTOR_HPP
+#define MODEL_SELECTOR_HPP
+
+#include <string>
+#include <vector>
+
+// Rutas por defecto (relativas al directorio commands, donde corre ova.sh)
+#define WHISPER_MODELS_DIR      "../utilities/whisper.cpp/models"
+#define DEFAULT_WHISPER_MODEL   WHISPER_MODELS_DIR "/ggml-base.bin"
+#define MODEL_SELECTION_CACHE   WHISPER_MODELS_DIR "/model_selection.json"
+
+// Clip de referencia incluido en whisper.cpp y su transcripción conocida
+#define REFERENCE_CLIP          "../utilities/whisper.cpp/samples/jfk.wav"
+#define REFERENCE_TRANSCRIPT    "And so my fellow Americans, ask not what your country can do for you, ask what you can do for your country."
+
+#define DEFAULT_RTF_BUDGET      0.5     // Un comando de 4 s debe transcribirse en 2 s
+
+// Resultado de medir un modelo sobre el clip de referencia.
+struct ModelBenchmark {
+    std::string path;
+    double rtf = 0.0;          // tiempo de proceso / duración del audio
+    double wer = 1.0;          // word error rate contra REFERENCE_TRANSCRIPT
+    double load_seconds = 0.0;
+    bool ok = false;
+};
+
+// Word error rate (distancia de Levenshtein por palabras, ignorando mayúsculas y puntuación).
+double word_error_rate(const std::string &reference, const std::string &hypothesis);
+
+// Mide todos los modelos ggml-*.bin de modelsDir sobre el clip de referencia.
+std::vector<ModelBenchmark> benchmark_whisper_models(const std::string &modelsDir = WHISPER_MODELS_DIR,
+                                                     const std::string &clip = REFERENCE_CLIP,
+                                                     const std::string &reference = REFERENCE_TRANSCRIPT);
+
+// Elige el modelo con menor WER entre los que cumplen el presupuesto de RTF; si ninguno
+// lo cumple, el más rápido. Guarda la elección en MODEL_SELECTION_CACHE.
+std::string select_and_cache_model(const std::vector<ModelBenchmark> &results, double rtfBudget = DEFAULT_RTF_BUDGET);
+
+// Modelo elegido por la última calibración en esta máquina, o fallback si no hay
+// caché, si la caché es de otra CPU o si el archivo ya no existe.
+std::string cached_whisper_model(const std::string &fallback = DEFAULT_WHISPER_MODEL);
+
+#endif // MODEL_SELECTOR_HPP
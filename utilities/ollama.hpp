@@ -34859,6 +34859,16 @@ public:
 #include <functional>
 #include <exception>
 #include <initializer_list>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <list>
+#include <mutex>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define OLLAMA_COROUTINES 1
+#endif
 
 // Namespace types and classes
 namespace ollama
@@ -35153,6 +35163,145 @@ class response {
         bool valid = false;        
     };
 
+    class cancelled_exception : public ollama::exception { public: using exception::exception; };
+    class timeout_exception : public ollama::exception { public: using exception::exception; };
+
+    // Per-request settings for the asynchronous API.
+    struct async_options
+    {
+        std::chrono::milliseconds timeout{0};   // Deadline from submission, time spent queued included. 0 = none.
+    };
+
+    // Cancellation state shared by a request on the I/O pool and the handle returned to the caller.
+    class async_control
+    {
+        public:
+            virtual ~async_control() = default;
+
+            // Completes the request with cancelled_exception right away and aborts its connection.
+            void cancel()
+            {
+                cancelled = true;
+                fail_cancelled();
+                std::lock_guard<std::mutex> lock(client_mutex);
+                if (client) client->stop();
+            }
+
+            bool is_cancelled() const { return cancelled; }
+
+            // The client running the request, so cancel() can stop it. false if already cancelled.
+            bool attach(httplib::Client* running)
+            {
+                std::lock_guard<std::mutex> lock(client_mutex);
+                client = running;
+                return !cancelled;
+            }
+
+            void detach()
+            {
+                std::lock_guard<std::mutex> lock(client_mutex);
+                client = nullptr;
+            }
+
+            std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+        protected:
+            virtual void fail_cancelled() = 0;
+
+        private:
+            std::atomic<bool> cancelled{false};
+            std::mutex client_mutex;
+            httplib::Client* client = nullptr;
+    };
+
+    template<typename T>
+    class async_state : public async_control
+    {
+        public:
+            async_state(): future(promise.get_future().share()) {}
+
+            // Only the first result counts: a request cancelled or timed out may still finish later.
+            void set_value(T value) { complete([&]{ promise.set_value(std::move(value)); }); }
+            void set_exception(std::exception_ptr error) { complete([&]{ promise.set_exception(error); }); }
+
+            template<typename E> void fail(const std::string& message)
+            {
+                if (ollama::use_exceptions) set_exception(std::make_exception_ptr(E(message)));
+                else set_value(T());
+            }
+
+            // Runs next when the result is set. false if it is already set.
+            bool on_complete(std::function<void()> next)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (done) return false;
+                continuation = std::move(next);
+                return true;
+            }
+
+        private:
+            std::promise<T> promise;
+
+        public:
+            std::shared_future<T> future;
+
+        protected:
+            void fail_cancelled() override { fail<cancelled_exception>("Request cancelled"); }
+
+        private:
+            template<typename F> void complete(F&& set)
+            {
+                std::function<void()> next;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done) return;
+                    done = true;
+                    set();
+                    next.swap(continuation);
+                }
+                if (next) next();
+            }
+
+            std::mutex mutex;
+            bool done = false;
+            std::function<void()> continuation;
+    };
+
+    // Result of an asynchronous request. Wait on it like a future, co_await it from a C++20
+    // coroutine (which resumes on the thread that completes it: an I/O thread, or the one
+    // calling cancel()), or cancel() it.
+    template<typename T>
+    class async
+    {
+        public:
+            async() = default;
+            explicit async(std::shared_ptr<async_state<T>> state): state(std::move(state)) {}
+
+            bool valid() const { return state != nullptr; }
+            bool ready() const { return state->future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+            void wait() const { state->future.wait(); }
+
+            template<typename Rep, typename Period>
+            bool wait_for(const std::chrono::duration<Rep, Period>& duration) const
+            {
+                return state->future.wait_for(duration) == std::future_status::ready;
+            }
+
+            // Waits and returns the result, or rethrows the request's exception.
+            T get() const { return state->future.get(); }
+            std::shared_future<T> future() const { return state->future; }
+            void cancel() const { if (state) state->cancel(); }
+
+#ifdef OLLAMA_COROUTINES
+            bool await_ready() const { return ready(); }
+            bool await_suspend(std::coroutine_handle<> handle) const { return state->on_complete([handle]{ handle.resume(); }); }
+            T await_resume() const { return get(); }
+#endif
+
+        private:
+            std::shared_ptr<async_state<T>> state;
+    };
+
 }
 
 class Ollama
@@ -35169,7 +35318,7 @@ class Ollama
         }
 
         Ollama(): Ollama("http://localhost:11434") {}
-        ~Ollama() { delete this->cli; }
+        ~Ollama() { shutdown_async(); delete this->cli; }
 
     ollama::response generate(const std::string& model,const std::string& prompt, const ollama::response& context, const json& options=nullptr, const std::vector<std::string>& images=std::vector<std::string>())
     {
@@ -35400,6 +35549,31 @@ class Ollama
         return false;                
     }
 
+    // Load with the options fixed at load time (num_thread, num_ctx, ...) that later requests will send, so they reuse
+    // this runner instead of reloading the model, and keep it in memory for keep_alive_duration.
+    bool load_model(const std::string& model, const json& options, const std::string& keep_alive_duration="5m")
+    {
+        json request;
+        request["model"] = model;
+        if (options.is_object() && !options.empty()) request["options"] = options;
+        request["keep_alive"] = keep_alive_duration;
+        std::string request_string = request.dump();
+        if (ollama::log_requests) std::cout << request_string << std::endl;
+
+        if (auto res = this->cli->Post("/api/generate", request_string, "application/json"))
+        {
+            if (ollama::log_replies) std::cout << res->body << std::endl;
+            json response = json::parse(res->body);
+            if (response.contains("error") && ollama::use_exceptions) throw ollama::exception("Ollama response returned error: "+response["error"].get<std::string>() );
+            return response.value("done", false);
+        }
+        else
+        { 
+            if (ollama::use_exceptions) throw ollama::exception("No response returned from server when loading model: "+httplib::to_string( res.error() ) ); 
+        }
+        return false;
+    }
+
     bool is_running()
     {
         auto res = cli->Get("/");
@@ -35651,6 +35825,7 @@ class Ollama
 
     void setReadTimeout(const int seconds)
     {
+        this->read_timeout = seconds;
         this->cli->set_read_timeout(seconds);
     }
 
@@ -35659,8 +35834,187 @@ class Ollama
         this->cli->set_write_timeout(seconds);
     }
 
+    void setConnectionTimeout(const int seconds)
+    {
+        this->cli->set_connection_timeout(seconds);
+    }
+
+    // Abort the request running on this client. Safe to call from another thread.
+    void stop()
+    {
+        this->cli->stop();
+    }
+
+    // Streaming chat that hands over the raw NDJSON bytes as they arrive, without building
+    // an ollama::response per token. Returning false from on_data cancels the request.
+    bool chat_raw(ollama::request& request, std::function<bool(const char*, size_t)> on_data)
+    {
+        request["stream"] = true;
+        std::string request_string = request.dump();
+        if (ollama::log_requests) std::cout << request_string << std::endl;
+
+        if (auto res = this->cli->Post("/api/chat", request_string, "application/json", on_data)) { return true; }
+        else if (res.error() != httplib::Error::Canceled) { if (ollama::use_exceptions) throw ollama::exception( "No response from server returned at URL"+this->server_url+" Error: "+httplib::to_string( res.error() ) ); }
+
+        return false;
+    }
+
+    // Asynchronous API. Requests run on a small pool of I/O threads owned by this client, each on
+    // its own connection, so many can be in flight (or queued) without a thread per call.
+    ollama::async<ollama::response> chat_async(ollama::request request, const ollama::async_options& options={})
+    {
+        request["stream"] = false;
+        return submit_response("/api/chat", request, ollama::message_type::chat, options);
+    }
+
+    ollama::async<ollama::response> generate_async(ollama::request request, const ollama::async_options& options={})
+    {
+        request["stream"] = false;
+        return submit_response("/api/generate", request, ollama::message_type::generation, options);
+    }
+
+    ollama::async<ollama::response> generate_embeddings_async(const std::string& model, const std::string& input, const ollama::async_options& options={})
+    {
+        return generate_embeddings_async(ollama::request::from_embedding(model, input), options);
+    }
+
+    ollama::async<ollama::response> generate_embeddings_async(ollama::request request, const ollama::async_options& options={})
+    {
+        // Parsed like generate_embeddings(): the embedding type would read the array as a string
+        return submit_response("/api/embed", request, ollama::message_type::generation, options);
+    }
+
+    // Streaming chat whose raw NDJSON bytes go to on_data on an I/O thread. Completes with true
+    // when the reply ends, false if on_data returned false.
+    ollama::async<bool> chat_raw_async(ollama::request request, std::function<bool(const char*, size_t)> on_data, const ollama::async_options& options={})
+    {
+        request["stream"] = true;
+        auto state = std::make_shared<ollama::async_state<bool>>();
+        std::string request_string = request.dump();
+        if (ollama::log_requests) std::cout << request_string << std::endl;
+
+        submit(state, options, [this, state, request_string, on_data]() {
+            int status = perform(*state, "/api/chat", request_string, on_data);
+            if (status > 0 && status != httplib::StatusCode::OK_200) state->fail<ollama::exception>("Ollama returned HTTP "+std::to_string(status)+" for /api/chat");
+            else if (status >= 0) state->set_value(status > 0);
+        });
+        return ollama::async<bool>(state);
+    }
+
+    // Number of I/O threads for the asynchronous API. Only takes effect before the first async request.
+    void setIOThreads(size_t threads)
+    {
+        std::lock_guard<std::mutex> lock(this->async_mutex);
+        this->io_threads = threads ? threads : 1;
+    }
+
     private:
 
+    // Queues the request on the I/O pool, registered so the destructor can cancel it.
+    template<typename T>
+    void submit(const std::shared_ptr<ollama::async_state<T>>& state, const ollama::async_options& options, std::function<void()> job)
+    {
+        if (options.timeout.count() > 0) state->deadline = std::chrono::steady_clock::now() + options.timeout;
+
+        std::lock_guard<std::mutex> lock(this->async_mutex);
+        if (!this->io_pool) this->io_pool.reset(new httplib::ThreadPool(this->io_threads));
+        auto entry = this->in_flight.insert(this->in_flight.end(), state);
+        this->io_pool->enqueue([this, entry, job]() {
+            job();
+            std::lock_guard<std::mutex> lock(this->async_mutex);
+            this->in_flight.erase(entry);
+        });
+    }
+
+    ollama::async<ollama::response> submit_response(const std::string& path, const ollama::request& request, ollama::message_type type, const ollama::async_options& options)
+    {
+        auto state = std::make_shared<ollama::async_state<ollama::response>>();
+        std::string request_string = request.dump();
+        if (ollama::log_requests) std::cout << request_string << std::endl;
+
+        submit(state, options, [this, state, path, request_string, type]() {
+            std::string body;
+            int status = perform(*state, path, request_string, [&body](const char* data, size_t size) { body.append(data, size); return true; });
+            if (status < 0) return;
+            if (ollama::log_replies) std::cout << body << std::endl;
+            try
+            {
+                ollama::response response(body, type);
+                if (response.has_error()) state->fail<ollama::exception>("Ollama response returned error: "+response.get_error());
+                else if (status != httplib::StatusCode::OK_200) state->fail<ollama::exception>("Ollama returned HTTP "+std::to_string(status)+" for "+path);
+                else state->set_value(response);
+            }
+            catch (...) { state->set_exception(std::current_exception()); }
+        });
+        return ollama::async<ollama::response>(state);
+    }
+
+    // Runs one request on the calling I/O thread with a client of its own, feeding the body to
+    // on_data as it arrives. Returns the HTTP status, 0 if on_data stopped it, or -1 once the
+    // state has been completed (cancelled, deadline passed or connection error).
+    template<typename T>
+    int perform(ollama::async_state<T>& state, const std::string& path, const std::string& request_string, const std::function<bool(const char*, size_t)>& on_data)
+    {
+        using clock = std::chrono::steady_clock;
+        if (state.is_cancelled()) return -1;
+
+        bool has_deadline = state.deadline != clock::time_point::max();
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(state.deadline - clock::now());
+        if (has_deadline && remaining.count() <= 0) { state.template fail<ollama::timeout_exception>("Deadline passed before the request to "+path+" started"); return -1; }
+
+        httplib::Client client(this->server_url);
+        if (has_deadline)
+        {
+            client.set_connection_timeout(remaining);
+            client.set_read_timeout(remaining);
+            client.set_write_timeout(remaining);
+        }
+        else client.set_read_timeout(this->read_timeout);
+
+        // cancel() may call stop() before the socket exists; the flag is checked again once it does
+        socket_t sock = INVALID_SOCKET;
+        client.set_socket_options([&sock](socket_t s) { httplib::default_socket_options(s); sock = s; });
+        client.set_header_writer([&state, &sock](httplib::Stream& strm, httplib::Headers& headers) {
+            if (state.is_cancelled()) httplib::detail::shutdown_socket(sock);
+            return httplib::detail::write_headers(strm, headers);
+        });
+        if (!state.attach(&client)) return -1;
+
+        bool expired = false;
+        auto res = client.Post(path, request_string, "application/json", [&](const char* data, size_t size) {
+            if (state.is_cancelled()) return false;
+            if (has_deadline && clock::now() >= state.deadline) { expired = true; return false; }
+            return on_data(data, size);
+        });
+        state.detach();
+
+        if (state.is_cancelled()) return -1;
+        if (expired || (!res && has_deadline && clock::now() >= state.deadline))
+        {
+            state.template fail<ollama::timeout_exception>("Deadline passed waiting for "+path);
+            return -1;
+        }
+        if (res) return res->status;
+        if (res.error() == httplib::Error::Canceled) return 0;
+
+        state.template fail<ollama::exception>("No response returned from server "+this->server_url+". Error was: "+httplib::to_string(res.error()));
+        return -1;
+    }
+
+    // Cancels every queued and running async request and waits for the I/O threads.
+    void shutdown_async()
+    {
+        std::list<std::shared_ptr<ollama::async_control>> pending;
+        std::unique_ptr<httplib::ThreadPool> pool;
+        {
+            std::lock_guard<std::mutex> lock(this->async_mutex);
+            pending = this->in_flight;
+            pool.swap(this->io_pool);
+        }
+        for (auto& state : pending) state->cancel();
+        if (pool) pool->shutdown();
+    }
+
 /*
     bool send_request(const ollama::request& request, std::function<void(const ollama::response&)> on_receive_response=nullptr)
     {
@@ -35671,6 +36025,12 @@ class Ollama
 
     std::string server_url;
     httplib::Client *cli;
+    int read_timeout = 120;
+
+    std::mutex async_mutex;
+    std::unique_ptr<httplib::ThreadPool> io_pool;
+    size_t io_threads = 4;
+    std::list<std::shared_ptr<ollama::async_control>> in_flight;
 
 };
 
@@ -35750,6 +36110,11 @@ namespace ollama
         return ollama.load_model(model);
     }
 
+    inline bool load_model(const std::string& model, const json& options, const std::string& keep_alive_duration="5m")
+    {
+        return ollama.load_model(model, options, keep_alive_duration);
+    }
+
     inline std::string get_version()
     {
         return ollama.get_version();
@@ -35820,6 +36185,26 @@ namespace ollama
         return ollama.generate_embeddings(request);
     }
 
+    inline ollama::async<ollama::response> chat_async(const ollama::request& request, const ollama::async_options& options={})
+    {
+        return ollama.chat_async(request, options);
+    }
+
+    inline ollama::async<ollama::response> generate_async(const ollama::request& request, const ollama::async_options& options={})
+    {
+        return ollama.generate_async(request, options);
+    }
+
+    inline ollama::async<ollama::response> generate_embeddings_async(const std::string& model, const std::string& input, const ollama::async_options& options={})
+    {
+        return ollama.generate_embeddings_async(model, input, options);
+    }
+
+    inline ollama::async<bool> chat_raw_async(const ollama::request& request, std::function<bool(const char*, size_t)> on_data, const ollama::async_options& options={})
+    {
+        return ollama.chat_raw_async(request, on_data, options);
+    }
+
     inline void setReadTimeout(const int& seconds)
     {
         ollama.setReadTimeout(seconds);
@@ -35830,6 +36215,11 @@ namespace ollama
         ollama.setWriteTimeout(seconds);
     }
 
+    inline void setConnectionTimeout(const int& seconds)
+    {
+        ollama.setConnectionTimeout(seconds);
+    }
+
 }
 
 
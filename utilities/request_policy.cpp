@@ -0,0 +1,233 @@
+#include "request_policy.hpp"
+#include "logging.hpp"
+#include "call_the_model.hpp"
+#include "config.hpp"
+#include "model_profiles.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Logging error and success messages from other functions
+void policylog(const std::string &message) {
+    write_log("request_policy.log", message);
+}
+
+static bool contains(const std::string &text, const char *word) {
+    return text.find(word) != std::string::npos;
+}
+
+RequestFailure classify_failure(const std::string &message) {
+    std::string text = message;
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+
+    // Mensajes de httplib (to_string(Error)) y de las respuestas de Ollama
+    if (contains(text, "could not establish connection") || contains(text, "connection timed out")) return RequestFailure::unreachable;
+    if (contains(text, "http 404") || contains(text, "not found")) return RequestFailure::model_missing;
+    if (contains(text, "http 429") || contains(text, "http 503") || contains(text, "busy") || contains(text, "too many")) return RequestFailure::overloaded;
+    if (contains(text, "failed to read") || contains(text, "failed to write") || contains(text, "http 500") ||
+        contains(text, "http 502") || contains(text, "unexpected eof") || contains(text, "runner")) return RequestFailure::transient;
+    return RequestFailure::invalid;
+}
+
+bool failure_is_refused(const std::string &message) {
+    std::string text = message;
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return contains(text, "could not establish connection");
+}
+
+bool is_retryable(RequestFailure failure) {
+    return failure == RequestFailure::transient || failure == RequestFailure::overloaded || failure == RequestFailure::unreachable;
+}
+
+const char *failure_name(RequestFailure failure) {
+    switch (failure) {
+    case RequestFailure::none: return "none";
+    case RequestFailure::transient: return "transient";
+    case RequestFailure::overloaded: return "overloaded";
+    case RequestFailure::unreachable: return "unreachable";
+    case RequestFailure::model_missing: return "model_missing";
+    case RequestFailure::invalid: return "invalid";
+    }
+    return "unknown";
+}
+
+std::chrono::milliseconds backoff_delay(int retry) {
+    // Jitter completo: los procesos que fallaron a la vez no vuelven a la vez
+    static thread_local std::mt19937 rng(std::random_device{}());
+    long cap = std::min<long>(RETRY_MAX_MS, static_cast<long>(RETRY_BASE_MS) << std::min(retry, 16));
+    std::uniform_int_distribution<long> jitter(0, cap);
+    return std::chrono::milliseconds(jitter(rng));
+}
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, int openMs)
+    : failureThreshold(failureThreshold), openTime(openMs) {}
+
+bool CircuitBreaker::allow() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!open) return true;
+    if (probing || std::chrono::steady_clock::now() - openedAt < openTime) return false;
+    probing = true; // Medio abierto: una sola petición de prueba
+    return true;
+}
+
+void CircuitBreaker::success() {
+    std::lock_guard<std::mutex> lock(mtx);
+    consecutiveFailures = 0;
+    open = false;
+    probing = false;
+}
+
+void CircuitBreaker::failure() {
+    std::lock_guard<std::mutex> lock(mtx);
+    consecutiveFailures++;
+    if (probing || consecutiveFailures >= failureThreshold) {
+        open = true;
+        openedAt = std::chrono::steady_clock::now();
+    }
+    probing = false;
+}
+
+void CircuitBreaker::reset() {
+    success();
+}
+
+bool CircuitBreaker::is_open() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return open;
+}
+
+EndpointPool &request_pool() {
+    // Se crea con los endpoints de la primera configuración; un cambio se aplica al reiniciar
+    static EndpointPool pool(config().endpoints);
+    static std::once_flag started;
+    // Con un solo endpoint no hay a dónde mover las sesiones: no hace falta comprobarlo
+    if (pool.size() > 1) std::call_once(started, [] { pool.start_health_checks(); });
+
+    // "drain" sí se aplica en caliente: una vez por versión de opcions.json
+    static std::atomic<long> drainVersion{-1};
+    const Config &cfg = config();
+    if (drainVersion.exchange(cfg.version) != static_cast<long>(cfg.version)) {
+        for (const EndpointStatus &endpoint : pool.status()) {
+            if (std::find(cfg.drain.begin(), cfg.drain.end(), endpoint.url) != cfg.drain.end()) {
+                pool.drain(endpoint.url);
+            } else {
+                pool.restore(endpoint.url);
+            }
+        }
+    }
+    return pool;
+}
+
+static std::mutex sessionMtx;
+static std::string currentSession;
+
+void set_request_session(const std::string &session) {
+    std::lock_guard<std::mutex> lock(sessionMtx);
+    currentSession = session;
+}
+
+std::string request_session() {
+    std::lock_guard<std::mutex> lock(sessionMtx);
+    if (currentSession.empty()) {
+        // amfq, chat y OVA comparten historial_test.json: es la misma conversación
+        currentSession = std::to_string(getuid()) + ":" + get_commands_directory() + "/historial_test.json";
+    }
+    return currentSession;
+}
+
+std::vector<RequestTarget> request_targets(const std::string &model, const std::string &session) {
+    const Config &cfg = config();
+    bool fallback = !cfg.fallback_model.empty() && cfg.fallback_model != model;
+    std::vector<RequestTarget> targets;
+    std::vector<std::string> pooled = request_pool().route(session, base_model(model));
+    for (const std::string &endpoint : pooled) {
+        targets.push_back({endpoint, model});
+        if (fallback) targets.push_back({endpoint, cfg.fallback_model});
+    }
+    bool inPool = std::find(pooled.begin(), pooled.end(), cfg.fallback_endpoint) != pooled.end();
+    if (!cfg.fallback_endpoint.empty() && !inPool) {
+        targets.push_back({cfg.fallback_endpoint, model});
+        if (fallback) targets.push_back({cfg.fallback_endpoint, cfg.fallback_model});
+    }
+    return targets;
+}
+
+LatencyBudget latency_budget(const std::string &mode) {
+    const Config &cfg = config();
+    auto entry = cfg.latency_budgets.find(mode);
+    if (entry != cfg.latency_budgets.end()) return entry->second;
+    LatencyBudget none;
+    none.mode = mode;
+    none.downgrade_model = cfg.model_fast_response;
+    return none;
+}
+
+bool is_local_endpoint(const std::string &endpoint) {
+    return contains(endpoint, "://localhost") || contains(endpoint, "://127.0.0.1") || contains(endpoint, "://[::1]");
+}
+
+static std::mutex endpointsMtx;
+
+Ollama &client_for(const std::string &endpoint) {
+    static std::map<std::string, std::unique_ptr<Ollama>> clients;
+    std::lock_guard<std::mutex> lock(endpointsMtx);
+    std::unique_ptr<Ollama> &client = clients[endpoint];
+    if (!client) client = std::make_unique<Ollama>(endpoint);
+    return *client;
+}
+
+CircuitBreaker &breaker_for(const std::string &endpoint) {
+    static std::map<std::string, std::unique_ptr<CircuitBreaker>> breakers;
+    std::lock_guard<std::mutex> lock(endpointsMtx);
+    std::unique_ptr<CircuitBreaker> &breaker = breakers[endpoint];
+    if (!breaker) breaker = std::make_unique<CircuitBreaker>();
+    return *breaker;
+}
+
+bool restart_server_rate_limited(const std::function<void()> &restart) {
+    // El reinicio mata el servidor de todos los usuarios: la marca va en logs/ de la
+    // instalación, común a todos los procesos, y no en /tmp (fs.protected_regular)
+    std::string logDirectory = get_commands_directory() + "/../logs/";
+    std::error_code ignored;
+    std::filesystem::create_directories(logDirectory, ignored);
+    std::string stampPath = logDirectory + RESTART_STAMP_FILE;
+    int fd = open(stampPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_NOFOLLOW, 0666);
+    if (fd < 0) {
+        policylog("❌ No se pudo abrir " + stampPath + ", no se reinicia el servidor");
+        return false;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        // Otro proceso está reiniciando ahora mismo
+        close(fd);
+        policylog("⏭️ Otro proceso ya está reiniciando el servidor");
+        return false;
+    }
+
+    struct stat info {};
+    fstat(fd, &info);
+    time_t now = time(nullptr);
+    bool restarted = false;
+    if (info.st_size == 0 || now - info.st_mtime >= RESTART_MIN_INTERVAL_S) {
+        std::string stamp = std::to_string(now) + "\n";
+        if (ftruncate(fd, 0) == 0 && pwrite(fd, stamp.data(), stamp.size(), 0) == static_cast<ssize_t>(stamp.size())) {
+            policylog("🔄 Reiniciando el servidor de Ollama como último recurso");
+            restart();
+            restarted = true;
+        }
+    } else {
+        policylog("⏭️ Reinicio omitido: el último fue hace " + std::to_string(now - info.st_mtime) + " s");
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return restarted;
+}
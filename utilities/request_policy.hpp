@@ -0,0 +1,118 @@
+#ifndef REQUEST_POLICY_HPP
+#define REQUEST_POLICY_HPP
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "endpoint_pool.hpp"
+#include "ollama.hpp"
+
+#define RETRY_MAX_ATTEMPTS      3       // Intentos por destino (endpoint + modelo)
+#define RETRY_BASE_MS           100     // Espera antes del primer reintento; se duplica en cada uno
+#define RETRY_MAX_MS            2000    // Tope de la espera entre reintentos
+#define BREAKER_FAILURES        3       // Fallos seguidos que abren el circuito de un endpoint
+#define BREAKER_OPEN_MS         15000   // Tiempo con el circuito abierto antes de dejar pasar una prueba
+#define RESTART_MIN_INTERVAL_S  600     // Como mucho un reinicio del servidor cada 10 min, entre todos los procesos
+#define RESTART_STAMP_FILE      "ollama-restart.stamp"  // En logs/, junto a los comandos
+#define DEFAULT_ENDPOINT        "http://localhost:11434"
+#define BUDGET_FIRST_TOKEN_SHARE 0.5    // Sin first_token_s: media respuesta sin ningún token ya es demasiado
+#define BUDGET_RATE_MIN_TOKENS  8       // Tokens recibidos antes de juzgar el ritmo
+#define BUDGET_NUM_PREDICT      256     // num_predict de la respuesta con el modelo rápido
+
+// Por qué falló una petición al modelo; decide si se reintenta, se cambia de destino o se abandona.
+enum class RequestFailure {
+    none,
+    transient,      // Conexión cortada a mitad, error 500/502: reintentar
+    overloaded,     // 429/503, servidor ocupado: reintentar con espera
+    unreachable,    // No se pudo conectar: reintentar, y como último recurso reiniciar el servidor
+    model_missing,  // 404 / modelo no encontrado: pasar al modelo de respaldo sin reintentar
+    invalid         // Petición rechazada (400, ...): repetirla no sirve de nada
+};
+
+// Clasifica por el mensaje de la excepción o el campo "error" de la respuesta.
+RequestFailure classify_failure(const std::string &message);
+bool is_retryable(RequestFailure failure);
+// El servidor no aceptó la conexión ("could not establish connection"): el único fallo que
+// justifica reiniciarlo. Un timeout, un 503 o un 500 significan que sigue vivo.
+bool failure_is_refused(const std::string &message);
+const char *failure_name(RequestFailure failure);
+
+// Espera antes del reintento n (0, 1, ...): exponencial con jitter completo, hasta RETRY_MAX_MS.
+std::chrono::milliseconds backoff_delay(int retry);
+
+// Cortocircuito por endpoint: tras BREAKER_FAILURES fallos seguidos deja de enviarle peticiones
+// durante BREAKER_OPEN_MS; luego deja pasar una sola de prueba que lo cierra o lo vuelve a abrir.
+class CircuitBreaker {
+public:
+    CircuitBreaker(int failureThreshold = BREAKER_FAILURES, int openMs = BREAKER_OPEN_MS);
+
+    bool allow();
+    void success();
+    void failure();
+    void reset();   // Tras reiniciar el servidor: volver a probar sin esperar
+    bool is_open();
+
+private:
+    std::mutex mtx;
+    int failureThreshold;
+    std::chrono::milliseconds openTime;
+    int consecutiveFailures = 0;
+    bool open = false;
+    bool probing = false;
+    std::chrono::steady_clock::time_point openedAt;
+};
+
+// Sesión con la que se enrutan las peticiones de este proceso. Por defecto el usuario y el
+// historial compartido, para que amfq, chat y OVA caigan en el mismo servidor.
+void set_request_session(const std::string &session);
+std::string request_session();
+
+// Dónde enviar una petición. Los destinos se prueban en orden.
+struct RequestTarget {
+    std::string endpoint;
+    std::string model;
+};
+
+// Endpoints de "endpoints" (o el único de "endpoint") en el orden del pool para la sesión,
+// cada uno con el modelo pedido y luego "fallback_model"; al final "fallback_endpoint".
+// Todas son claves opcionales de opcions.json.
+std::vector<RequestTarget> request_targets(const std::string &model, const std::string &session = request_session());
+
+// Pool de los endpoints configurados; comprueba su estado en segundo plano si hay más de uno.
+// Los endpoints de "drain" se retiran del reparto en cuanto se recarga opcions.json.
+EndpointPool &request_pool();
+
+// Cliente y cortocircuito compartidos por todas las peticiones a un endpoint.
+Ollama &client_for(const std::string &endpoint);
+CircuitBreaker &breaker_for(const std::string &endpoint);
+
+// Presupuesto de latencia de un modo (0 = sin límite), de "latency_budgets" en opcions.json:
+// {"amfq_detail": {"first_token_s": 8, "total_s": 40, "min_tokens_per_s": 3}, ...}. Si el
+// primer token o el ritmo no llegan, la petición se repite con downgrade_model (por defecto
+// "model_fast_response") y downgrade_num_predict; total_s corta la respuesta en cualquier caso.
+struct LatencyBudget {
+    std::string mode;
+    double first_token_s = 0;
+    double total_s = 0;
+    double min_tokens_per_s = 0;
+    std::string downgrade_model;
+    int downgrade_num_predict = BUDGET_NUM_PREDICT;
+
+    bool active() const { return first_token_s > 0 || total_s > 0 || min_tokens_per_s > 0; }
+    double first_token_limit() const { return first_token_s > 0 ? first_token_s : total_s * BUDGET_FIRST_TOKEN_SHARE; }
+};
+
+// Modos: amfq, amfq_detail, chat, chat_detail. Un modo sin entrada no tiene presupuesto.
+LatencyBudget latency_budget(const std::string &mode);
+
+// Solo tiene sentido reiniciar el servidor de esta máquina.
+bool is_local_endpoint(const std::string &endpoint);
+
+// Reinicia el servidor solo si ningún proceso lo hizo en los últimos RESTART_MIN_INTERVAL_S.
+bool restart_server_rate_limited(const std::function<void()> &restart);
+
+void policylog(const std::string &message);
+
+#endif // REQUEST_POLICY_HPP
@@ -0,0 +1,45 @@
+#include "spectrum.hpp"
+#include <cmath>
+#include <utility>
+
+void fft_inplace(std::vector<std::complex<float>> &data) {
+    const size_t n = data.size();
+
+    // Bit-reversal permutation
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+
+    // Iterative butterflies
+    for (size_t len = 2; len <= n; len <<= 1) {
+        float angle = -2.0f * static_cast<float>(M_PI) / len;
+        std::complex<float> step(std::cos(angle), std::sin(angle));
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<float> w(1.0f, 0.0f);
+            for (size_t k = 0; k < len / 2; ++k) {
+                std::complex<float> even = data[i + k];
+                std::complex<float> odd = data[i + k + len / 2] * w;
+                data[i + k] = even + odd;
+                data[i + k + len / 2] = even - odd;
+                w *= step;
+            }
+        }
+    }
+}
+
+void power_spectrum(const float *frame, size_t n, size_t nfft, std::vector<float> &power) {
+    std::vector<std::complex<float>> buffer(nfft);
+    for (size_t i = 0; i < n && i < nfft; ++i) {
+        float hann = 0.5f - 0.5f * std::cos(2.0f * static_cast<float>(M_PI) * i / (n - 1));
+        buffer[i] = frame[i] * hann;
+    }
+    fft_inplace(buffer);
+
+    power.resize(nfft / 2 + 1);
+    for (size_t k = 0; k < power.size(); ++k) {
+        power[k] = std::norm(buffer[k]);
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef SPECTRUM_HPP
+#define SPECTRUM_HPP
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// FFT radix-2 en sitio; data.size() debe ser potencia de 2.
+void fft_inplace(std::vector<std::complex<float>> &data);
+
+// Espectro de potencia (nfft/2 + 1 bins) de un frame real con ventana de Hann.
+// El frame se rellena con ceros hasta nfft, que debe ser potencia de 2.
+void power_spectrum(const float *frame, size_t n, size_t nfft, std::vector<float> &power);
+
+#endif // SPECTRUM_HPP
@@ -0,0 +1,114 @@
+#include "speculative_prefill.hpp"
+#include "logging.hpp"
+#include "call_the_model.hpp"
+#include "model_profiles.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+//Logging error and success messages from other functions
+void speculativelog(const std::string& message) {
+    write_log("speculative_prefill.log", message);
+}
+
+static std::vector<std::string> split_words(const std::string& text) {
+    std::vector<std::string> words;
+    std::istringstream stream(text);
+    std::string word;
+    while (stream >> word) words.push_back(word);
+    return words;
+}
+
+std::string stable_prefix(const std::string& previous, const std::string& current) {
+    std::vector<std::string> a = split_words(previous);
+    std::vector<std::string> b = split_words(current);
+    if (b.empty()) return "";
+
+    size_t limit = std::min(a.size(), b.size() - 1);
+    size_t common = 0;
+    while (common < limit && a[common] == b[common]) ++common;
+
+    std::string prefix;
+    for (size_t i = 0; i < common; ++i) {
+        if (i) prefix += " ";
+        prefix += b[i];
+    }
+    return common >= SPECULATIVE_MIN_WORDS ? prefix : "";
+}
+
+SpeculativePrefill::SpeculativePrefill(const std::string& modelo, const ollama::options& opciones,
+                                       const ollama::messages& historial, const std::string& initial_instruction)
+    : modelo(modelo), opciones(opciones), historial(historial), initial_instruction(initial_instruction) {
+    // Solo queremos que el servidor evalúe el prompt, no que genere
+    this->opciones["num_predict"] = 1;
+}
+
+SpeculativePrefill::~SpeculativePrefill() {
+    cancel();
+}
+
+void SpeculativePrefill::on_partial(const std::string& partial) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::string prefix = stable_prefix(previousPartial, partial);
+    previousPartial = partial;
+    if (prefix.empty() || prefix == sentPrefix) return;
+
+    bool extends = !sentPrefix.empty() && prefix.rfind(sentPrefix, 0) == 0;
+    if (in_flight()) {
+        // Si solo crece, la petición en curso sigue siendo útil: el siguiente parcial la extenderá
+        if (extends) return;
+        stop_in_flight();
+        cancelledCount++;
+        speculativelog("↩️ Prefijo cambió, pre-carga cancelada: \"" + sentPrefix + "\" -> \"" + prefix + "\"");
+    }
+    launch(prefix);
+}
+
+void SpeculativePrefill::finish(const std::string& final_text) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!sentPrefix.empty() && final_text.rfind(sentPrefix, 0) == 0) {
+        // Útil: dejar que termine antes de enviar la petición real
+        try {
+            pending.get();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sentAt).count();
+            speculativelog("⏩ Pre-carga completada en " + std::to_string(static_cast<int>(ms)) + " ms");
+        } catch (const std::exception& e) {
+            speculativelog(std::string("⚠️ Pre-carga interrumpida: ") + e.what());
+        }
+        speculativelog("✅ Prefijo reutilizable: \"" + sentPrefix + "\" (" + std::to_string(sentCount) +
+                       " enviadas, " + std::to_string(cancelledCount) + " canceladas)");
+    } else if (in_flight()) {
+        stop_in_flight();
+        cancelledCount++;
+        speculativelog("↩️ Transcripción final no coincide con \"" + sentPrefix + "\", pre-carga cancelada");
+    }
+}
+
+void SpeculativePrefill::cancel() {
+    std::lock_guard<std::mutex> lock(mtx);
+    stop_in_flight();
+}
+
+// Requiere mtx
+void SpeculativePrefill::launch(const std::string& prefix) {
+    sentPrefix = prefix;
+    sentCount++;
+    sentAt = std::chrono::steady_clock::now();
+
+    ollama::messages mensajes = construir_mensajes(historial, initial_instruction, prefix, "user");
+    // Petición explícita: con un json como tercer argumento se elegiría la sobrecarga de streaming
+    ollama::request request(modelo, mensajes, opciones, false);
+    // Mismo perfil que la petición real, o su prefijo no coincidiría en la caché
+    apply_model_profile(request);
+    pending = ollama::chat_async(request);
+}
+
+// Requiere mtx
+void SpeculativePrefill::stop_in_flight() {
+    // Cancelar completa la petición al momento; el hilo de E/S cierra su conexión
+    if (pending.valid()) pending.cancel();
+}
@@ -0,0 +1,58 @@
+#ifndef SPECULATIVE_PREFILL_HPP
+#define SPECULATIVE_PREFILL_HPP
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include "ollama.hpp"
+
+#define SPECULATIVE_MIN_WORDS   2   // Palabras estables mínimas antes de pre-cargar
+
+// Pre-carga especulativa: mientras el usuario todavía habla, envía al modelo el prefijo
+// estable de la transcripción parcial (con la instrucción del sistema y el historial) y
+// pide un solo token. Así el servidor carga el modelo y evalúa el prefijo común; la
+// petición final solo paga por la cola. Si la transcripción cambia, la petición en curso
+// se cancela. Las peticiones van por la API asíncrona del cliente, sin un hilo propio.
+class SpeculativePrefill {
+public:
+    SpeculativePrefill(const std::string& modelo, const ollama::options& opciones,
+                       const ollama::messages& historial, const std::string& initial_instruction);
+    ~SpeculativePrefill();
+
+    // Nueva transcripción parcial (ya normalizada como la entrada final). Thread-safe.
+    void on_partial(const std::string& partial);
+
+    // Transcripción final: si coincide con el prefijo enviado espera a que termine la
+    // pre-carga (el servidor procesa las peticiones en orden); si no, la cancela.
+    void finish(const std::string& final_text);
+
+    void cancel();
+
+    // Número de pre-cargas enviadas y canceladas (para el log).
+    int sent() const { return sentCount; }
+    int cancelled() const { return cancelledCount; }
+
+private:
+    void launch(const std::string& prefix);
+    void stop_in_flight();
+    bool in_flight() const { return pending.valid() && !pending.ready(); }
+
+    std::string modelo;
+    ollama::options opciones;
+    ollama::messages historial;
+    std::string initial_instruction;
+
+    std::mutex mtx;
+    std::string previousPartial;
+    std::string sentPrefix;
+    ollama::async<ollama::response> pending;
+    std::chrono::steady_clock::time_point sentAt;
+    int sentCount = 0;
+    int cancelledCount = 0;
+};
+
+// Prefijo común por palabras de dos transcripciones, sin la última palabra de current
+// (puede estar incompleta).
+std::string stable_prefix(const std::string& previous, const std::string& current);
+
+#endif // SPECULATIVE_PREFILL_HPP
@@ -0,0 +1,255 @@
+#include "speech_cache.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+#define SPEECH_CACHE_MAGIC      "OVAS"
+#define SPEECH_CACHE_VERSION    1u
+#define SPEECH_CACHE_EXTENSION  ".pcm"
+#define SPEECH_CACHE_TMP        ".tmp"
+#define SPEECH_CACHE_TMP_MAX_AGE std::chrono::minutes(1)  // Un temporal más viejo es de un proceso caído
+#define SPEECH_CACHE_HEADER     (4 + 4 * sizeof(uint32_t))  // magic, versión, rate, longitud del texto, muestras
+
+//Logging error and success messages from other functions
+void speechcachelog(const std::string& message) {
+    write_log("speech_cache.log", message);
+}
+
+std::string normalize_sentence(const std::string &text) {
+    std::string out;
+    out.reserve(text.size());
+    bool space = false;
+    for (unsigned char c : text) {
+        if (std::isspace(c)) {
+            space = !out.empty();
+            continue;
+        }
+        if (space) out += ' ';
+        out += static_cast<char>(c);
+        space = false;
+    }
+    return out;
+}
+
+std::vector<std::string> split_sentences(const std::string &text) {
+    std::vector<std::string> sentences;
+    std::string current;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        bool boundary = c == '\n' ||
+                        ((c == '.' || c == '!' || c == '?' || c == ';') &&
+                         (i + 1 == text.size() || std::isspace(static_cast<unsigned char>(text[i + 1]))));
+        if (c != '\n') current += c;
+        if (boundary) {
+            std::string sentence = normalize_sentence(current);
+            if (!sentence.empty()) sentences.push_back(sentence);
+            current.clear();
+        }
+    }
+    std::string sentence = normalize_sentence(current);
+    if (!sentence.empty()) sentences.push_back(sentence);
+    return sentences;
+}
+
+// FNV-1a de 64 bits: suficiente para nombrar archivos; el texto completo se guarda
+// dentro y se compara al leer, así una colisión solo cuesta un fallo de caché.
+static std::string cache_key(const std::string &sentence, const std::string &voice, int rate) {
+    std::string material = sentence + '\x1f' + voice + '\x1f' + std::to_string(rate);
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : material) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+SpeechCache::SpeechCache(const std::string &directory, uint64_t maxBytes)
+    : directory(directory), maxBytes(maxBytes) {}
+
+std::filesystem::path SpeechCache::path_for(const std::string &key) const {
+    return directory / (key + SPEECH_CACHE_EXTENSION);
+}
+
+// Requiere mtx
+void SpeechCache::load_index() {
+    if (indexed) return;
+    indexed = true;
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    rescan();
+}
+
+// Requiere mtx
+void SpeechCache::rescan() {
+    entries.clear();
+    totalBytes = 0;
+    auto staleBefore = std::filesystem::file_time_type::clock::now() - SPEECH_CACHE_TMP_MAX_AGE;
+    size_t staleRemoved = 0;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(directory, ec)) {
+        std::error_code entryError;
+        if (!entry.is_regular_file(entryError)) continue;
+        uint64_t bytes = entry.file_size(entryError);
+        auto lastWrite = entry.last_write_time(entryError);
+        if (entryError) continue; // Borrado por otro proceso mientras se recorría
+        std::string name = entry.path().filename().string();
+
+        if (name.find(SPEECH_CACHE_EXTENSION SPEECH_CACHE_TMP) != std::string::npos) {
+            // Un put() en curso en otro proceso tiene su temporal reciente: ese cuenta y se deja
+            if (lastWrite < staleBefore && std::filesystem::remove(entry.path(), entryError)) {
+                staleRemoved++;
+                continue;
+            }
+            totalBytes += bytes;
+            continue;
+        }
+        if (entry.path().extension() != SPEECH_CACHE_EXTENSION) continue;
+        entries[entry.path().stem().string()] = {bytes, lastWrite};
+        totalBytes += bytes;
+    }
+    if (staleRemoved > 0) {
+        speechcachelog("🧹 Caché de voz: " + std::to_string(staleRemoved) + " temporales abandonados eliminados");
+    }
+}
+
+bool SpeechCache::get(const std::string &sentence, const std::string &voice, int rate,
+                      std::vector<int16_t> &pcm, int &sampleRate) {
+    std::string normalized = normalize_sentence(sentence);
+    std::string key = cache_key(normalized, voice, rate);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    load_index();
+
+    // El índice es de este proceso: la frase puede haberla guardado o borrado otro
+    std::error_code ec;
+    std::filesystem::path path = path_for(key);
+    uint64_t fileBytes = std::filesystem::file_size(path, ec);
+    auto it = entries.find(key);
+    if (ec) {
+        if (it != entries.end()) {
+            totalBytes -= it->second.bytes;
+            entries.erase(it);
+        }
+        return false;
+    }
+    if (it == entries.end()) {
+        it = entries.emplace(key, Entry{fileBytes, std::filesystem::file_time_type::clock::now()}).first;
+        totalBytes += fileBytes;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    uint32_t version = 0, fileRate = 0, textLength = 0, samples = 0;
+    file.read(magic, 4);
+    file.read(reinterpret_cast<char *>(&version), sizeof(version));
+    file.read(reinterpret_cast<char *>(&fileRate), sizeof(fileRate));
+    file.read(reinterpret_cast<char *>(&textLength), sizeof(textLength));
+    if (!file || textLength > fileBytes - std::min<uint64_t>(fileBytes, SPEECH_CACHE_HEADER)) return false;
+    std::string stored(textLength, '\0');
+    file.read(&stored[0], textLength);
+    file.read(reinterpret_cast<char *>(&samples), sizeof(samples));
+    if (!file || std::string(magic, 4) != SPEECH_CACHE_MAGIC || version != SPEECH_CACHE_VERSION ||
+        stored != normalized + '\x1f' + voice + '\x1f' + std::to_string(rate)) {
+        return false;
+    }
+    // Un archivo truncado o dañado no puede pedir más memoria de la que ocupa
+    if (static_cast<uint64_t>(samples) * sizeof(int16_t) > fileBytes - SPEECH_CACHE_HEADER - textLength) return false;
+    pcm.resize(samples);
+    file.read(reinterpret_cast<char *>(pcm.data()), samples * sizeof(int16_t));
+    if (!file) {
+        pcm.clear();
+        return false;
+    }
+    sampleRate = static_cast<int>(fileRate);
+
+    // Marcar el uso en disco para que el orden LRU persista
+    it->second.lastUse = std::filesystem::file_time_type::clock::now();
+    std::filesystem::last_write_time(path, it->second.lastUse, ec);
+    return true;
+}
+
+void SpeechCache::put(const std::string &sentence, const std::string &voice, int rate,
+                      const std::vector<int16_t> &pcm, int sampleRate) {
+    if (pcm.empty()) return;
+    std::string normalized = normalize_sentence(sentence);
+    std::string key = cache_key(normalized, voice, rate);
+    std::string stored = normalized + '\x1f' + voice + '\x1f' + std::to_string(rate);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    load_index();
+
+    // Escribir aparte y renombrar: otro proceso nunca lee un archivo a medias
+    std::filesystem::path target = path_for(key);
+    std::filesystem::path tmp = target;
+    tmp += SPEECH_CACHE_TMP + std::to_string(getpid()) + "-" +
+           std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmp, std::ios::binary);
+        uint32_t version = SPEECH_CACHE_VERSION, fileRate = static_cast<uint32_t>(sampleRate);
+        uint32_t textLength = static_cast<uint32_t>(stored.size()), samples = static_cast<uint32_t>(pcm.size());
+        file.write(SPEECH_CACHE_MAGIC, 4);
+        file.write(reinterpret_cast<const char *>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char *>(&fileRate), sizeof(fileRate));
+        file.write(reinterpret_cast<const char *>(&textLength), sizeof(textLength));
+        file.write(stored.data(), textLength);
+        file.write(reinterpret_cast<const char *>(&samples), sizeof(samples));
+        file.write(reinterpret_cast<const char *>(pcm.data()), pcm.size() * sizeof(int16_t));
+        if (!file) {
+            speechcachelog("❌ Error: No se pudo escribir " + tmp.string());
+            file.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, target, ec);
+    if (ec) {
+        speechcachelog("❌ Error: No se pudo guardar " + target.string() + ": " + ec.message());
+        std::filesystem::remove(tmp, ec);
+        return;
+    }
+
+    evict(); // Vuelve a medir la carpeta, ya con este archivo
+}
+
+// Requiere mtx
+void SpeechCache::evict() {
+    // El total de este proceso no ve lo que escribieron los demás
+    rescan();
+    if (totalBytes <= maxBytes) return;
+
+    std::vector<std::pair<std::filesystem::file_time_type, std::string>> byAge;
+    for (const auto &[key, entry] : entries) byAge.push_back({entry.lastUse, key});
+    std::sort(byAge.begin(), byAge.end());
+
+    size_t removed = 0;
+    for (const auto &[lastUse, key] : byAge) {
+        if (totalBytes <= maxBytes) break;
+        std::error_code ec;
+        std::filesystem::remove(path_for(key), ec);
+        totalBytes -= entries[key].bytes;
+        entries.erase(key);
+        removed++;
+    }
+    speechcachelog("🧹 Caché de voz: " + std::to_string(removed) + " frases eliminadas, " +
+                   std::to_string(totalBytes / 1024) + " KiB en uso");
+}
+
+uint64_t SpeechCache::size_bytes() {
+    std::lock_guard<std::mutex> lock(mtx);
+    load_index();
+    return totalBytes;
+}
+
+SpeechCache &speech_cache() {
+    static SpeechCache cache;
+    return cache;
+}
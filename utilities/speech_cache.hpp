@@ -0,0 +1,63 @@
+#ifndef SPEECH_CACHE_HPP
+#define SPEECH_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define SPEECH_CACHE_DIR        "../cache/speech"
+#define SPEECH_CACHE_MAX_BYTES  (64u * 1024u * 1024u)  // Tamaño máximo en disco
+
+// Caché en disco del PCM sintetizado, direccionada por contenido: la clave es el texto
+// normalizado de la frase + voz + velocidad. Al superar el tamaño máximo se borran las
+// entradas usadas hace más tiempo (la fecha de modificación del archivo guarda el último
+// uso, así el orden LRU sobrevive entre ejecuciones). Thread-safe, y varios procesos pueden
+// compartir la carpeta: una frase que no está en el índice se busca en disco, y cada
+// limpieza vuelve a medir la carpeta entera, incluidos los .tmp que dejó un proceso caído.
+class SpeechCache {
+public:
+    explicit SpeechCache(const std::string &directory = SPEECH_CACHE_DIR, uint64_t maxBytes = SPEECH_CACHE_MAX_BYTES);
+
+    // true y pcm/sampleRate llenos si la frase ya estaba sintetizada.
+    bool get(const std::string &sentence, const std::string &voice, int rate,
+             std::vector<int16_t> &pcm, int &sampleRate);
+    void put(const std::string &sentence, const std::string &voice, int rate,
+             const std::vector<int16_t> &pcm, int sampleRate);
+
+    uint64_t size_bytes();
+
+private:
+    struct Entry {
+        uint64_t bytes;
+        std::filesystem::file_time_type lastUse;
+    };
+
+    void load_index();
+    // Vuelve a leer tamaños y fechas de la carpeta (otros procesos también escriben en ella)
+    // y borra los temporales abandonados.
+    void rescan();
+    void evict();
+    std::filesystem::path path_for(const std::string &key) const;
+
+    std::filesystem::path directory;
+    uint64_t maxBytes;
+    uint64_t totalBytes = 0;      // Incluye los temporales que aún no se han borrado
+    bool indexed = false;
+    std::unordered_map<std::string, Entry> entries; // nombre de archivo -> tamaño y último uso
+    std::mutex mtx;
+};
+
+// Caché compartida por todo el proceso.
+SpeechCache &speech_cache();
+
+// Espacios colapsados y sin espacios al inicio ni al final. Mayúsculas intactas: espeak
+// pronuncia distinto "US" y "us".
+std::string normalize_sentence(const std::string &text);
+
+// Divide una respuesta en frases (., !, ? o ; seguidos de espacio, y saltos de línea).
+std::vector<std::string> split_sentences(const std::string &text);
+
+#endif // SPEECH_CACHE_HPP
@@ -0,0 +1,118 @@
+#include "speech_normalizer.hpp"
+
+// Primer carácter de cualquier marcador: fuera de ellos el texto se copia por tramos
+static bool may_start_marker(char c) {
+    return c == '`' || c == '\n' || c == '<';
+}
+
+SpeechNormalizer::SpeechNormalizer(Output mode, CodePolicy policy) : mode(mode), policy(policy) {}
+
+void SpeechNormalizer::reset() {
+    carry.clear();
+    inLongCode = inShortCode = skipFenceInfo = false;
+}
+
+void SpeechNormalizer::feed(std::string_view chunk, std::string &out) {
+    if (carry.empty()) {
+        scan(chunk, out, false);
+        return;
+    }
+    // Solo cuando un marcador quedó partido: unir lo pendiente con el trozo nuevo
+    std::string joined = std::move(carry);
+    carry.clear();
+    joined.append(chunk);
+    scan(joined, out, false);
+}
+
+void SpeechNormalizer::finish(std::string &out) {
+    std::string pending = std::move(carry);
+    carry.clear();
+    scan(pending, out, true);
+}
+
+void SpeechNormalizer::scan(std::string_view text, std::string &out, bool final) {
+    size_t spanStart = 0, i = 0;
+    while (i < text.size()) {
+        if (!may_start_marker(text[i])) {
+            ++i;
+            continue;
+        }
+
+        // Longest marker that matches here; a partial one at the end waits for more input
+        std::string_view rest = text.substr(i);
+        const SpeechMarker *match = nullptr;
+        bool partial = false;
+        for (const SpeechMarker &marker : SPEECH_MARKERS) {
+            if (rest.substr(0, marker.text.size()) == marker.text) {
+                if (!match || marker.text.size() > match->text.size()) match = &marker;
+            } else if (!final && rest.size() < marker.text.size() && marker.text.substr(0, rest.size()) == rest) {
+                partial = true;
+            }
+        }
+        if (partial) {
+            emit_text(text.substr(spanStart, i - spanStart), out);
+            carry.assign(rest);
+            return;
+        }
+        if (!match) {
+            ++i;
+            continue;
+        }
+
+        emit_text(text.substr(spanStart, i - spanStart), out);
+        apply(match->event, out);
+        i += match->text.size();
+        spanStart = i;
+    }
+    emit_text(text.substr(spanStart), out);
+}
+
+void SpeechNormalizer::emit_text(std::string_view text, std::string &out) {
+    if (text.empty()) return;
+    if (mode == Output::TAGGED) {
+        out.append(text);
+        return;
+    }
+    if (inLongCode && (skipFenceInfo || policy != CodePolicy::SPEAK)) return;
+    if (inShortCode && policy == CodePolicy::DROP) return;
+    out.append(text);
+}
+
+void SpeechNormalizer::apply(SpeechEvent event, std::string &out) {
+    if (mode == Output::TAGGED) {
+        out.append(SPEECH_TAGS[static_cast<size_t>(event)]);
+        return;
+    }
+
+    switch (event) {
+    case SpeechEvent::LINE:
+        if (inLongCode) {
+            if (skipFenceInfo) {
+                skipFenceInfo = false;
+                return;
+            }
+            if (policy != CodePolicy::SPEAK) return;
+        }
+        // Un salto por línea: split_sentences lo toma como fin de frase
+        if (!out.empty() && out.back() != '\n') out += '\n';
+        break;
+    case SpeechEvent::LONG_CODE:
+        inLongCode = !inLongCode;
+        skipFenceInfo = inLongCode;
+        inShortCode = false;
+        break;
+    case SpeechEvent::SHORT_CODE:
+        // Una comilla suelta dentro de un bloque es parte del código
+        if (!inLongCode) inShortCode = !inShortCode;
+        break;
+    }
+}
+
+std::string normalize_for_speech(std::string_view text, CodePolicy policy) {
+    std::string out;
+    out.reserve(text.size());
+    SpeechNormalizer normalizer(SpeechNormalizer::Output::SPEAKABLE, policy);
+    normalizer.feed(text, out);
+    normalizer.finish(out);
+    return out;
+}
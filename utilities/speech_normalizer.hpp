@@ -0,0 +1,82 @@
+#ifndef SPEECH_NORMALIZER_HPP
+#define SPEECH_NORMALIZER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Eventos que cortan el texto de una respuesta antes de hablarla
+enum class SpeechEvent { LINE, LONG_CODE, SHORT_CODE };
+
+struct SpeechMarker {
+    std::string_view text;
+    SpeechEvent event;
+};
+
+// Tabla única de marcadores: el markdown que escribe el modelo y las etiquetas que produce
+// format_response_for_audio. Las dos grafías "comand" antiguas se siguen aceptando.
+inline constexpr SpeechMarker SPEECH_MARKERS[] = {
+    {"```", SpeechEvent::LONG_CODE},
+    {"`", SpeechEvent::SHORT_CODE},
+    {"\n", SpeechEvent::LINE},
+    {"<|jump_line|>", SpeechEvent::LINE},
+    {"<|long_command|>", SpeechEvent::LONG_CODE},
+    {"<|short_command|>", SpeechEvent::SHORT_CODE},
+    {"<|long_comand|>", SpeechEvent::LONG_CODE},
+    {"<|short_comand|>", SpeechEvent::SHORT_CODE},
+};
+
+// Etiqueta canónica de cada evento (indexada por SpeechEvent)
+inline constexpr std::string_view SPEECH_TAGS[] = {"<|jump_line|>", "<|long_command|>", "<|short_command|>"};
+
+constexpr bool speech_tags_are_markers() {
+    for (size_t e = 0; e < sizeof(SPEECH_TAGS) / sizeof(SPEECH_TAGS[0]); ++e) {
+        bool found = false;
+        for (const SpeechMarker &marker : SPEECH_MARKERS) {
+            if (marker.text == SPEECH_TAGS[e] && static_cast<size_t>(marker.event) == e) found = true;
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+static_assert(speech_tags_are_markers(), "every emitted tag must be parsed back to the same event");
+
+// Qué hacer con el código al hablar
+enum class CodePolicy {
+    DROP,           // ni bloques ni código en línea
+    DROP_BLOCKS,    // se lee el código en línea, se saltan los bloques ```
+    SPEAK,          // se lee todo, sin los marcadores
+};
+
+// Normalizador incremental: recibe la respuesta por trozos (p. ej. tokens en streaming)
+// y añade a out el texto a sintetizar (SPEAKABLE) o la versión con etiquetas (TAGGED).
+// Los trozos de texto se copian directamente desde el string_view de entrada; solo un
+// marcador partido entre dos trozos se guarda aparte hasta completarse.
+class SpeechNormalizer {
+public:
+    enum class Output { SPEAKABLE, TAGGED };
+
+    explicit SpeechNormalizer(Output mode = Output::SPEAKABLE, CodePolicy policy = CodePolicy::DROP_BLOCKS);
+
+    void feed(std::string_view chunk, std::string &out);
+    // Cierra el flujo: resuelve un marcador pendiente como texto o marcador.
+    void finish(std::string &out);
+    void reset();
+
+private:
+    void scan(std::string_view text, std::string &out, bool final);
+    void emit_text(std::string_view text, std::string &out);
+    void apply(SpeechEvent event, std::string &out);
+
+    Output mode;
+    CodePolicy policy;
+    std::string carry;          // posible marcador incompleto al final del último trozo
+    bool inLongCode = false;
+    bool inShortCode = false;
+    bool skipFenceInfo = false; // "python" en ```python no se lee
+};
+
+// Atajo para un texto completo.
+std::string normalize_for_speech(std::string_view text, CodePolicy policy = CodePolicy::DROP_BLOCKS);
+
+#endif // SPEECH_NORMALIZER_HPP
@@ -0,0 +1,303 @@
+#include "stream_decoder.hpp"
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#define STREAM_MAX_DEPTH 64 // Anidamiento máximo de valores que se saltan
+
+void StreamReply::reset() {
+    *this = StreamReply();
+}
+
+namespace {
+
+struct Cursor {
+    const char *p;
+    const char *end;
+};
+
+void skip_ws(Cursor &c) {
+    while (c.p < c.end && (*c.p == ' ' || *c.p == '\t' || *c.p == '\n' || *c.p == '\r')) ++c.p;
+}
+
+bool expect(Cursor &c, char ch) {
+    skip_ws(c);
+    if (c.p >= c.end || *c.p != ch) return false;
+    ++c.p;
+    return true;
+}
+
+void append_utf8(uint32_t cp, std::string &out) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+bool read_hex4(Cursor &c, uint32_t &value) {
+    if (c.end - c.p < 4) return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        char h = *c.p++;
+        value <<= 4;
+        if (h >= '0' && h <= '9') value |= h - '0';
+        else if (h >= 'a' && h <= 'f') value |= h - 'a' + 10;
+        else if (h >= 'A' && h <= 'F') value |= h - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+// String starting at '"'. With out, the unescaped text is appended to it; raw always
+// gets the text as it is in the line (what keys are compared against).
+bool parse_string(Cursor &c, std::string *out, std::string_view *raw = nullptr) {
+    if (!expect(c, '"')) return false;
+    const char *start = c.p;
+    const char *run = c.p;
+    while (c.p < c.end) {
+        char ch = *c.p;
+        if (ch == '"') {
+            if (out) out->append(run, c.p);
+            if (raw) *raw = std::string_view(start, static_cast<size_t>(c.p - start));
+            ++c.p;
+            return true;
+        }
+        if (static_cast<unsigned char>(ch) < 0x20) return false;
+        if (ch != '\\') {
+            ++c.p;
+            continue;
+        }
+
+        // Escape: flush the plain run before it
+        if (out) out->append(run, c.p);
+        if (++c.p >= c.end) return false;
+        char esc = *c.p++;
+        char plain = 0;
+        switch (esc) {
+            case '"': plain = '"'; break;
+            case '\\': plain = '\\'; break;
+            case '/': plain = '/'; break;
+            case 'b': plain = '\b'; break;
+            case 'f': plain = '\f'; break;
+            case 'n': plain = '\n'; break;
+            case 'r': plain = '\r'; break;
+            case 't': plain = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!read_hex4(c, cp)) return false;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    // Emoji and the like come as a surrogate pair
+                    uint32_t low;
+                    if (c.end - c.p < 6 || c.p[0] != '\\' || c.p[1] != 'u') return false;
+                    c.p += 2;
+                    if (!read_hex4(c, low) || low < 0xDC00 || low > 0xDFFF) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                if (out) append_utf8(cp, *out);
+                break;
+            }
+            default: return false;
+        }
+        if (plain && out) *out += plain;
+        run = c.p;
+    }
+    return false;
+}
+
+bool skip_literal(Cursor &c, const char *word) {
+    size_t n = std::strlen(word);
+    if (static_cast<size_t>(c.end - c.p) < n || std::memcmp(c.p, word, n) != 0) return false;
+    c.p += n;
+    return true;
+}
+
+bool is_number_char(char ch) {
+    return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+}
+
+bool skip_value(Cursor &c, int depth) {
+    skip_ws(c);
+    if (c.p >= c.end || depth > STREAM_MAX_DEPTH) return false;
+    switch (*c.p) {
+        case '"':
+            return parse_string(c, nullptr);
+        case '{': {
+            ++c.p;
+            skip_ws(c);
+            if (c.p < c.end && *c.p == '}') {
+                ++c.p;
+                return true;
+            }
+            do {
+                if (!parse_string(c, nullptr) || !expect(c, ':') || !skip_value(c, depth + 1)) return false;
+                skip_ws(c);
+            } while (c.p < c.end && *c.p == ',' && ++c.p);
+            return expect(c, '}');
+        }
+        case '[': {
+            ++c.p;
+            skip_ws(c);
+            if (c.p < c.end && *c.p == ']') {
+                ++c.p;
+                return true;
+            }
+            do {
+                if (!skip_value(c, depth + 1)) return false;
+                skip_ws(c);
+            } while (c.p < c.end && *c.p == ',' && ++c.p);
+            return expect(c, ']');
+        }
+        case 't': return skip_literal(c, "true");
+        case 'f': return skip_literal(c, "false");
+        case 'n': return skip_literal(c, "null");
+        default: {
+            const char *start = c.p;
+            while (c.p < c.end && is_number_char(*c.p)) ++c.p;
+            return c.p > start;
+        }
+    }
+}
+
+bool parse_bool(Cursor &c, bool &value) {
+    skip_ws(c);
+    if (skip_literal(c, "true")) {
+        value = true;
+        return true;
+    }
+    if (skip_literal(c, "false")) {
+        value = false;
+        return true;
+    }
+    return skip_value(c, 0); // null or something unexpected: keep the old value
+}
+
+bool parse_int(Cursor &c, int64_t &value) {
+    skip_ws(c);
+    const char *start = c.p;
+    std::from_chars_result result = std::from_chars(c.p, c.end, value);
+    if (result.ec == std::errc() && (result.ptr >= c.end || !is_number_char(*result.ptr))) {
+        c.p = result.ptr;
+        return true;
+    }
+    c.p = start;
+    return skip_value(c, 0); // not an integer (float, null): ignored
+}
+
+} // namespace
+
+bool StreamDecoder::decode_line(const char *begin, const char *end, std::string &out) {
+    Cursor c{begin, end};
+    skip_ws(c);
+    if (c.p >= c.end) return true; // blank keep-alive line
+
+    // A broken line must not leave half of its text in the caller's buffer
+    const size_t rollback = out.size();
+    auto fail = [&]() {
+        out.resize(rollback);
+        return false;
+    };
+
+    if (!expect(c, '{')) return fail();
+    skip_ws(c);
+    if (c.p < c.end && *c.p == '}') {
+        ++c.p;
+    } else {
+        do {
+            std::string_view key;
+            if (!parse_string(c, nullptr, &key) || !expect(c, ':')) return fail();
+            bool ok;
+            if (key == "message") {
+                // {"role": ..., "content": ...}: only content is kept
+                ok = expect(c, '{');
+                skip_ws(c);
+                if (ok && c.p < c.end && *c.p != '}') {
+                    do {
+                        std::string_view inner;
+                        if (!parse_string(c, nullptr, &inner) || !expect(c, ':')) return fail();
+                        skip_ws(c);
+                        bool text = inner == "content" && c.p < c.end && *c.p == '"';
+                        if (!(text ? parse_string(c, &out) : skip_value(c, 1))) return fail();
+                        skip_ws(c);
+                    } while (c.p < c.end && *c.p == ',' && ++c.p);
+                }
+                ok = ok && expect(c, '}');
+            } else if (key == "response") {
+                skip_ws(c);
+                ok = c.p < c.end && *c.p == '"' ? parse_string(c, &out) : skip_value(c, 0);
+            } else if (key == "done") {
+                ok = parse_bool(c, current.done);
+            } else if (key == "error") {
+                skip_ws(c);
+                current.error.clear();
+                ok = c.p < c.end && *c.p == '"' ? parse_string(c, &current.error) : skip_value(c, 0);
+            } else if (key == "prompt_eval_count") {
+                ok = parse_int(c, current.prompt_eval_count);
+            } else if (key == "eval_count") {
+                ok = parse_int(c, current.eval_count);
+            } else if (key == "total_duration") {
+                ok = parse_int(c, current.total_duration);
+            } else if (key == "load_duration") {
+                ok = parse_int(c, current.load_duration);
+            } else if (key == "prompt_eval_duration") {
+                ok = parse_int(c, current.prompt_eval_duration);
+            } else if (key == "eval_duration") {
+                ok = parse_int(c, current.eval_duration);
+            } else {
+                ok = skip_value(c, 0);
+            }
+            if (!ok) return fail();
+            skip_ws(c);
+        } while (c.p < c.end && *c.p == ',' && ++c.p);
+        if (!expect(c, '}')) return fail();
+    }
+
+    skip_ws(c);
+    if (c.p != c.end) return fail();
+    decodedLines++;
+    return true;
+}
+
+bool StreamDecoder::feed(const char *data, size_t size, std::string &out) {
+    bool ok = true;
+    const char *p = data, *end = data + size;
+    while (p < end) {
+        const char *newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!newline) {
+            pending.append(p, end);
+            break;
+        }
+        if (pending.empty()) {
+            ok = decode_line(p, newline, out) && ok;
+        } else {
+            pending.append(p, newline);
+            ok = decode_line(pending.data(), pending.data() + pending.size(), out) && ok;
+            pending.clear(); // keeps its capacity
+        }
+        p = newline + 1;
+    }
+    return ok;
+}
+
+bool StreamDecoder::finish(std::string &out) {
+    if (pending.empty()) return true;
+    bool ok = decode_line(pending.data(), pending.data() + pending.size(), out);
+    pending.clear();
+    return ok;
+}
+
+void StreamDecoder::reset() {
+    pending.clear();
+    current.reset();
+    decodedLines = 0;
+}
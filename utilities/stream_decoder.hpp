@@ -0,0 +1,49 @@
+#ifndef STREAM_DECODER_HPP
+#define STREAM_DECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Campos que interesan de cada línea de /api/chat o /api/generate en streaming.
+// Las duraciones vienen del servidor en nanosegundos y solo llegan en la línea final.
+struct StreamReply {
+    bool done = false;
+    int64_t prompt_eval_count = 0;
+    int64_t eval_count = 0;
+    int64_t total_duration = 0;
+    int64_t load_duration = 0;
+    int64_t prompt_eval_duration = 0;
+    int64_t eval_duration = 0;
+    std::string error;
+
+    void reset();
+};
+
+// Decodificador de la respuesta en streaming (una línea JSON por token) sin construir
+// un DOM: recorre cada línea como un parser SAX y solo se queda con message.content
+// (o "response"), done, error y los contadores. El texto se añade directamente al
+// buffer del llamante y las líneas partidas entre trozos HTTP se guardan en un buffer
+// propio que se reutiliza, así que tras la primera línea no reserva memoria por token.
+class StreamDecoder {
+public:
+    // Procesa un trozo tal como llega de HTTP; añade a out el texto de cada línea completa.
+    // Devuelve false si alguna línea no era JSON válido (el resto se sigue procesando).
+    bool feed(const char *data, size_t size, std::string &out);
+    // Al terminar la respuesta: decodifica una última línea que no acabara en '\n'.
+    bool finish(std::string &out);
+    // Procesa una línea completa (sin el '\n').
+    bool decode_line(const char *begin, const char *end, std::string &out);
+
+    const StreamReply &reply() const { return current; }
+    size_t lines() const { return decodedLines; }
+    // Para reutilizar el decodificador en otra petición (conserva la memoria reservada).
+    void reset();
+
+private:
+    std::string pending;
+    StreamReply current;
+    size_t decodedLines = 0;
+};
+
+#endif // STREAM_DECODER_HPP
@@ -1,4 +1,5 @@
 #include "../utilities/transcriber.hpp"
+#include "logging.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -11,7 +12,21 @@
 #include <filesystem>
 #include <poll.h>
 #include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <set>
 #include "transcriber.hpp"
+#include "wav_reader.hpp"
+#include "json.hpp"
+#include "model_selector.hpp"
+#include "audio_capture.hpp"
+#include "metrics.hpp"
 
 // Global log file stream
 std::ofstream whisperLogFile("../logs/whisper.log", std::ios::app);
@@ -20,12 +35,121 @@ std::ofstream whisperLogFile("../logs/whisper.log", std::ios::app);
 void customWhisperLogCallback(ggml_log_level level, const char * text, void * user_data) {
     if (whisperLogFile.is_open()) {
         whisperLogFile << text;
-        whisperLogFile.flush();
+        // Whisper logs a line per tensor while loading: only problems are flushed right away
+        if (level >= GGML_LOG_LEVEL_WARN) whisperLogFile.flush();
     }
 }
 
+// Whisper does not report its temperature fallbacks through the API. Encoder passes are
+// counted only in encoder_begin, one per 30 s window. Every decode attempt starts by
+// filtering the logits of an empty sequence (once, then copied to the other decoders), so
+// each attempt after the first one of a window is a fallback. Counting per window keeps a
+// window that was encoded but never decoded from hiding another window's fallbacks.
+// The time from the encoder start to that first filter is the encode time.
+struct DecodeCounter {
+    int encoderPasses = 0;
+    int windowAttempts = 0;     // Attempts since the last encoder pass
+    int pastFallbacks = 0;      // Fallbacks of the windows already finished
+    double encodeSeconds = 0.0;
+    bool encoding = false;
+    std::chrono::steady_clock::time_point encodeStart;
+    int fallbacks() const { return pastFallbacks + std::max(0, windowAttempts - 1); }
+};
+
+static bool count_encoder_pass(struct whisper_context*, struct whisper_state*, void *user_data) {
+    DecodeCounter *counter = static_cast<DecodeCounter*>(user_data);
+    counter->pastFallbacks += std::max(0, counter->windowAttempts - 1);
+    counter->windowAttempts = 0;
+    counter->encoderPasses++;
+    counter->encoding = true;
+    counter->encodeStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+static void count_attempt(struct whisper_context*, struct whisper_state*, const whisper_token_data*,
+                          int n_tokens, float*, void *user_data) {
+    if (n_tokens != 0) return;
+    DecodeCounter *counter = static_cast<DecodeCounter*>(user_data);
+    counter->windowAttempts++;
+    if (counter->encoding) {
+        counter->encodeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - counter->encodeStart).count();
+        counter->encoding = false;
+    }
+}
+
+static void attach_counter(WhisperConfig &params, DecodeCounter &counter) {
+    params.encoder_begin_callback = count_encoder_pass;
+    params.encoder_begin_callback_user_data = &counter;
+    params.logits_filter_callback = count_attempt;
+    params.logits_filter_callback_user_data = &counter;
+}
+
+// Mean probability of the text tokens of a segment; timestamps and special tokens
+// (ids from EOT up) are left out. Returns the number of tokens counted.
+static int segment_confidence(struct whisper_context* ctx, int segment, SegmentConfidence &confidence) {
+    const whisper_token eot = whisper_token_eot(ctx);
+    int counted = 0;
+    double sum = 0.0;
+    for (int t = 0; t < whisper_full_n_tokens(ctx, segment); ++t) {
+        whisper_token_data token = whisper_full_get_token_data(ctx, segment, t);
+        if (token.id >= eot) continue;
+        sum += token.p;
+        counted++;
+    }
+    confidence.text = whisper_obtener_texto_segmento(ctx, segment);
+    confidence.avg_token_p = counted ? static_cast<float>(sum / counted) : 0.0f;
+    confidence.no_speech_p = whisper_full_get_segment_no_speech_prob(ctx, segment);
+    return counted;
+}
+
+// One "transcription" line in metrics.jsonl per voice turn
+static void record_transcription(const TranscriptionMetrics &metrics) {
+    nlohmann::json segments = nlohmann::json::array();
+    for (const SegmentConfidence &segment : metrics.segments) {
+        segments.push_back({{"text", segment.text}, {"avg_token_p", segment.avg_token_p}, {"no_speech_p", segment.no_speech_p}});
+    }
+    record_metric("transcription", {
+        {"audio_s", metrics.audio_seconds},
+        {"encode_s", metrics.encode_seconds},
+        {"decode_s", metrics.decode_seconds},
+        {"rtf", metrics.rtf},
+        {"fallbacks", metrics.fallbacks},
+        {"text_tokens", metrics.text_tokens},
+        {"avg_token_p", metrics.avg_token_p},
+        {"max_no_speech_p", metrics.max_no_speech_p},
+        {"low_confidence", metrics.low_confidence},
+        {"remote", metrics.remote},
+        {"segments", segments},
+    });
+}
+
 // Constructor
-Transcriber::Transcriber(const std::string &modelPath, const std::string &audioPath) {
+Transcriber::Transcriber(const std::string &modelPath, const std::string &audioPath)
+    : Transcriber(modelPath, audioPath, true) {}
+
+std::unique_ptr<Transcriber> Transcriber::open(const std::string &modelPath, const std::string &audioPath) {
+    std::unique_ptr<Transcriber> transcriber(new Transcriber(modelPath, audioPath, false));
+    if (!transcriber->ctx) return nullptr;
+    return transcriber;
+}
+
+std::unique_ptr<Transcriber> Transcriber::remote(RemoteTranscribe remote, const std::string &audioPath) {
+    return std::unique_ptr<Transcriber>(new Transcriber(std::move(remote), audioPath));
+}
+
+Transcriber::Transcriber(const std::string &modelPath, const std::string &audioPath, bool exitOnError)
+    : Transcriber(RemoteTranscribe(), audioPath) {
+    load_model(modelPath, exitOnError);
+}
+
+Transcriber::Transcriber(RemoteTranscribe remote, const std::string &audioPath)
+    : ctx(nullptr), remoteTranscribe(std::move(remote)) {
+    audioFile = audioPath;     
+    recordCommand = "arecord -f S16_LE -r 16000 -c 1 audio.wav > /dev/null 2>&1 & echo $! > /tmp/arecord_pid";
+    stopCommand = "if [ -f /tmp/arecord_pid ]; then kill $(cat /tmp/arecord_pid) && rm -f /tmp/arecord_pid; fi";
+}
+
+bool Transcriber::load_model(const std::string &modelPath, bool exitOnError) {
     const std::string logDirectory = "../logs";
     const std::string logFilePath = logDirectory + "/whisper.log";
 
@@ -33,7 +157,8 @@ Transcriber::Transcriber(const std::string &modelPath, const std::string &audioP
     std::ofstream logFile(logFilePath, std::ios::app);
     if (!logFile) {
         std::cerr << "Error opening log file!" << std::endl;
-        exit(1);
+        if (exitOnError) exit(1);
+        return false;
     }
 
     std::streambuf *coutBuffer = std::cout.rdbuf();
@@ -41,42 +166,49 @@ Transcriber::Transcriber(const std::string &modelPath, const std::string &audioP
     std::streambuf *cerrBuffer = std::cerr.rdbuf();
     std::cerr.rdbuf(logFile.rdbuf());  
 
+    std::string selectedModel = modelPath.empty() ? cached_whisper_model() : modelPath;
+
+    ResidentMemory before = resident_memory();
+    auto loadStart = std::chrono::steady_clock::now();
+
     whisper_log_set(customWhisperLogCallback, nullptr);
     ParametrosWhisper wparams = whisper_context_default_params();
-    ctx = whisper_init_from_file_with_params(modelPath.c_str(), wparams);
+    ctx = whisper_init_from_file_with_params(selectedModel.c_str(), wparams);
 
     std::cout.rdbuf(coutBuffer);
     std::cerr.rdbuf(cerrBuffer);  
 
     if (!ctx) {
-        std::cerr << "❌ Error: No se pudo cargar el modelo Whisper." << std::endl;
-        exit(1);
+        std::cerr << "❌ Error: No se pudo cargar el modelo Whisper " << selectedModel << "." << std::endl;
+        if (exitOnError) exit(1);
+        return false;
     }
 
-    audioFile = audioPath;     
-    recordCommand = "arecord -f S16_LE -r 16000 -c 1 audio.wav > /dev/null 2>&1 & echo $! > /tmp/arecord_pid";
-    stopCommand = "if [ -f /tmp/arecord_pid ]; then kill $(cat /tmp/arecord_pid) && rm -f /tmp/arecord_pid; fi";
+    // What this process pays for the model: whisper.cpp copies the weights into its own
+    // buffers, so every process holds a private copy (rss_anon_kb)
+    ResidentMemory after = resident_memory();
+    record_metric("model_load", {
+        {"model", selectedModel},
+        {"load_s", std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count()},
+        {"rss_kb", after.total_kb},
+        {"rss_anon_kb", after.anon_kb},
+        {"rss_file_kb", after.file_kb},
+        {"rss_delta_kb", after.total_kb - before.total_kb},
+    });
+    return true;
 }
 
 // Destructor
 Transcriber::~Transcriber() {
+    for (struct whisper_state* state : states) {
+        whisper_free_state(state);
+    }
     whisper_free(ctx);
 }
 
 //Logging error and success messages from other functions
 void logMsg(const std::string& message) {
-    
-    std::string logDirectory = "../logs/"; 
-    std::filesystem::create_directories(logDirectory);
-    std::string logFilePath = logDirectory + "transcriber.log";
-
-    std::ofstream logFile(logFilePath, std::ios::app); // Open in append mode
-    if (logFile) {
-        logFile << message << std::endl;
-        logFile.close();
-    } else {
-        std::cerr << "❌ Error: No se pudo abrir el archivo de registro en " << logFilePath << std::endl;
-    }
+    write_log("transcriber.log", message);
 }
 
 // Función para obtener la configuración de la terminal
@@ -209,6 +341,107 @@ void Transcriber::stop_microphone() {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
+// Hands-free recording: VAD endpointing on the live capture stream
+Transcriber::RecordResult Transcriber::record_until_silence(const VadConfig &config,
+                                       std::function<void(const std::string&)> on_partial,
+                                       const PlaybackMonitor *playback) {
+    if (std::filesystem::exists(audioFile)) {
+        std::filesystem::remove(audioFile);
+    }
+
+    AudioCapture capture(config.sample_rate);
+    if (!capture.start()) {
+        logMsg("❌ Error al iniciar la captura del micrófono");
+        return RecordResult::capture_failed;
+    }
+
+    std::cout << "🎤 Listening... just speak." << std::endl;
+    Endpointer endpointer(config);
+    std::vector<float> frame(config.frame_samples());
+    bool announced = false;
+
+    // Parciales: un solo hilo a la vez sobre un estado propio; si sigue ocupado se salta el turno
+    if (on_partial && !remoteTranscribe) ensure_states(1);
+    std::thread partialWorker;
+    std::atomic<bool> partialBusy{false};
+    const size_t partialStep = static_cast<size_t>(config.sample_rate) * PARTIAL_INTERVAL_MS / 1000;
+    size_t lastPartialSize = 0;
+
+    bool ducked = false;
+    Endpointer::State state = Endpointer::WAITING;
+    while (capture.read(frame.data(), frame.size())) {
+        bool duringPlayback = playback && playback->active && playback->active();
+        state = endpointer.feed(frame.data(), frame.size(), duringPlayback);
+
+        // Barge-in: lower the assistant at the first voiced frame, cut it once the turn starts
+        if (playback && (duringPlayback || ducked)) {
+            if (state == Endpointer::SPEAKING) {
+                if (playback->stop) playback->stop();
+                if (playback->restore) playback->restore();
+                if (endpointer.barged_in()) logMsg("🔇 Barge-in: respuesta cortada por el usuario.");
+                ducked = false;
+            } else if (endpointer.onset_run() > 0 && !ducked) {
+                if (playback->duck) playback->duck();
+                ducked = true;
+            } else if (endpointer.onset_run() == 0 && ducked) {
+                if (playback->restore) playback->restore();
+                ducked = false;
+            }
+        }
+
+        if (state == Endpointer::SPEAKING && !announced) {
+            std::cout << "🎙️ Recording..." << std::endl;
+            announced = true;
+        }
+        if (state == Endpointer::DONE) break;
+
+        const std::vector<float> &soFar = endpointer.audio_so_far();
+        if (on_partial && (remoteTranscribe || !states.empty()) && state == Endpointer::SPEAKING && !partialBusy &&
+            soFar.size() >= lastPartialSize + partialStep) {
+            if (partialWorker.joinable()) partialWorker.join();
+            lastPartialSize = soFar.size();
+            partialBusy = true;
+            partialWorker = std::thread([this, &partialBusy, &on_partial, samples = soFar]() {
+                int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+                std::string text = "You:";
+                TranscriptionResult result;
+                if (remoteTranscribe) {
+                    if (remoteTranscribe(samples, result)) text += result.text + " ";
+                } else {
+                    for (const TranscriptSegment &segment : transcribe_with_state(states[0], samples, 0, threads)) {
+                        text += segment.text + " ";
+                    }
+                }
+                on_partial(text);
+                partialBusy = false;
+            });
+        }
+    }
+    capture.stop();
+    if (ducked && playback->restore) playback->restore();
+    if (partialWorker.joinable()) partialWorker.join();
+
+    // start() no ve si arecord falta o el dispositivo no existe: el hijo sale y el primer read falla
+    if (state != Endpointer::DONE) {
+        logMsg("❌ Error: la captura del micrófono se cortó (¿arecord o el dispositivo no están disponibles?)");
+        return RecordResult::capture_failed;
+    }
+    std::vector<float> utterance = endpointer.utterance();
+    if (utterance.empty()) {
+        logMsg("❌ No se detectó voz antes del tiempo límite.");
+        return RecordResult::no_speech;
+    }
+    std::cout << "🛑 Stopping..." << std::endl;
+
+    if (!write_wav(audioFile, utterance, config.sample_rate)) {
+        logMsg("❌ Error: No se pudo escribir " + audioFile);
+        return RecordResult::capture_failed;
+    }
+    logMsg("✅ Turno grabado por VAD: " + audioFile + " (" +
+           std::to_string(utterance.size() * 1000 / config.sample_rate) + " ms)");
+    return RecordResult::recorded;
+}
+
 // Load WAV file and convert it to a normalized float vector
 std::vector<float> Transcriber::load_audio(const std::string &filename) {
     std::ifstream file(filename, std::ios::binary);
@@ -279,23 +512,475 @@ std::string Transcriber::transcribe_audio() {
         return "";
     }
 
+    // Forgotten 'S' presses leave seconds of silence; whisper does not need them
+    audioData = trim_silence(audioData);
+    if (frontendEnabled) preprocess_audio(audioData, frontend, WHISPER_SAMPLE_RATE);
+
+    lastMetrics = TranscriptionMetrics();
+    lastMetrics.audio_seconds = static_cast<double>(audioData.size()) / WHISPER_SAMPLE_RATE;
+    if (remoteTranscribe) {
+        TranscriptionResult result;
+        if (remoteTranscribe(audioData, result)) {
+            // El servicio no devuelve la confianza: solo se sabe si entendió algo
+            std::istringstream words(result.text);
+            std::string word;
+            while (words >> word) lastMetrics.text_tokens++;
+            lastMetrics.rtf = lastMetrics.audio_seconds > 0 ? result.processing_seconds / lastMetrics.audio_seconds : 0.0;
+            lastMetrics.fallbacks = result.fallbacks;
+            lastMetrics.remote = true;
+            record_transcription(lastMetrics);
+            return "You:" + result.text + " ";
+        }
+        // Servicio parado o saturado: a partir de aquí, el modelo propio
+        logMsg("⚠️ El servicio de transcripción no respondió; se carga el modelo local.");
+        remoteTranscribe = nullptr;
+    }
+    if (!ctx && !load_model("", false)) return "";
+
     WhisperConfig params = whisper_crear_parametros(WHISPER_SAMPLING_GREEDY);
     params.language = "en";
     params.print_progress = false;
+    DecodeCounter counter;
+    attach_counter(params, counter);
 
+    auto start = std::chrono::steady_clock::now();
     if (whisper_full(ctx, params, audioData.data(), audioData.size()) != 0) {
         std::string errMsg = "❌ Error al transcribir el audio.";
         //std::cerr << errMsg << std::endl;
         logMsg(errMsg);
         return "";
     }
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    lastMetrics.encode_seconds = counter.encodeSeconds;
+    lastMetrics.decode_seconds = std::max(0.0, total - counter.encodeSeconds);
+    lastMetrics.rtf = lastMetrics.audio_seconds > 0 ? total / lastMetrics.audio_seconds : 0.0;
+    lastMetrics.fallbacks = counter.fallbacks();
 
     int num_segments = whisper_num_segmentos(ctx);
     std::string transcript = "You:";
+    double weighted = 0.0;
+    int tokens = 0;
     for (int i = 0; i < num_segments; ++i) {
         transcript += whisper_obtener_texto_segmento(ctx, i);
         transcript += " ";
+
+        SegmentConfidence confidence;
+        int counted = segment_confidence(ctx, i, confidence);
+        weighted += confidence.avg_token_p * counted;
+        tokens += counted;
+        lastMetrics.max_no_speech_p = std::max(lastMetrics.max_no_speech_p, confidence.no_speech_p);
+        lastMetrics.segments.push_back(confidence);
+    }
+    lastMetrics.text_tokens = tokens;
+    lastMetrics.avg_token_p = tokens ? static_cast<float>(weighted / tokens) : 0.0f;
+    // One or two tokens make a poor average: a short "Yes." would always be flagged
+    lastMetrics.low_confidence = tokens >= WHISPER_MIN_CONFIDENCE_TOKENS &&
+                                 (lastMetrics.avg_token_p < WHISPER_LOW_CONFIDENCE_P ||
+                                  lastMetrics.max_no_speech_p > WHISPER_HIGH_NO_SPEECH_P);
+
+    if (lastMetrics.low_confidence) {
+        logMsg("⚠️ Transcripción dudosa (p media " + std::to_string(lastMetrics.avg_token_p) + ", sin voz " +
+               std::to_string(lastMetrics.max_no_speech_p) + ", " + std::to_string(lastMetrics.fallbacks) +
+               " reintentos): " + transcript);
     }
+    record_transcription(lastMetrics);
 
     return transcript;
-}
\ No newline at end of file
+}
+
+void Transcriber::set_frontend(const FrontEndConfig &config) {
+    frontend = config;
+    frontendEnabled = true;
+}
+
+void Transcriber::disable_frontend() {
+    frontendEnabled = false;
+}
+
+// Grow the state pool; every state shares the model weights held by ctx
+void Transcriber::ensure_states(size_t n) {
+    if (!ctx) return; // Transcriber remoto cuyo modelo local tampoco se pudo cargar
+    while (states.size() < n) {
+        struct whisper_state* state = whisper_init_state(ctx);
+        if (!state) {
+            logMsg("❌ Error: No se pudo crear un estado de Whisper (pool de " + std::to_string(states.size()) + ").");
+            return;
+        }
+        states.push_back(state);
+    }
+}
+
+// Transcribe one chunk on a pooled state, shifting timestamps by offset_ms
+std::vector<TranscriptSegment> Transcriber::transcribe_with_state(struct whisper_state* state, const std::vector<float> &samples,
+                                                                  int64_t offset_ms, int n_threads, int *fallbacks) {
+    std::vector<TranscriptSegment> segments;
+
+    WhisperConfig params = whisper_crear_parametros(WHISPER_SAMPLING_GREEDY);
+    params.language = "en";
+    params.print_progress = false;
+    params.no_context = true; // chunks run out of order, so no prompt carry-over
+    params.n_threads = n_threads;
+    DecodeCounter counter;
+    if (fallbacks) attach_counter(params, counter);
+
+    if (whisper_full_with_state(ctx, state, params, samples.data(), samples.size()) != 0) {
+        logMsg("❌ Error al transcribir el trozo que inicia en " + std::to_string(offset_ms) + " ms.");
+        return segments;
+    }
+    if (fallbacks) *fallbacks += counter.fallbacks();
+
+    int num_segments = whisper_full_n_segments_from_state(state);
+    for (int i = 0; i < num_segments; ++i) {
+        // Whisper timestamps are in 10 ms units
+        segments.push_back({offset_ms + whisper_full_get_segment_t0_from_state(state, i) * 10,
+                            offset_ms + whisper_full_get_segment_t1_from_state(state, i) * 10,
+                            whisper_full_get_segment_text_from_state(state, i)});
+    }
+    return segments;
+}
+
+static float frame_rms(const float *samples, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) sum += samples[i] * samples[i];
+    return n ? std::sqrt(sum / n) : 0.0f;
+}
+
+// Long recordings: stream the WAV, cut at silences and decode the chunks in parallel
+std::string Transcriber::transcribe_long_audio(const std::string &filename, int n_states,
+                                               std::vector<TranscriptSegment>* segments) {
+    WavReader reader;
+    if (!reader.open(filename)) {
+        logMsg(reader.error());
+        return "";
+    }
+
+    int hw = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (n_states <= 0) {
+        n_states = std::max(1, hw / LONG_AUDIO_THREADS_PER_STATE);
+    }
+    ensure_states(n_states);
+    n_states = std::min<int>(n_states, states.size());
+    if (n_states == 0) {
+        logMsg("❌ No hay estados de Whisper disponibles para el modo de audio largo.");
+        return "";
+    }
+    int threads_per_state = std::max(1, hw / n_states);
+
+    struct Chunk {
+        size_t index;
+        int64_t offset_ms;
+        std::vector<float> samples;
+    };
+
+    // At most n_states chunks wait in the queue, so memory stays bounded
+    std::mutex mtx;
+    std::condition_variable queue_not_empty, queue_not_full;
+    std::deque<Chunk> queue;
+    bool finished = false;
+    std::map<size_t, std::vector<TranscriptSegment>> results;
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < n_states; ++w) {
+        workers.emplace_back([&, state = states[w]]() {
+            while (true) {
+                Chunk chunk;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    queue_not_empty.wait(lock, [&] { return !queue.empty() || finished; });
+                    if (queue.empty()) return;
+                    chunk = std::move(queue.front());
+                    queue.pop_front();
+                }
+                queue_not_full.notify_one();
+
+                auto chunk_segments = transcribe_with_state(state, chunk.samples, chunk.offset_ms, threads_per_state);
+
+                std::lock_guard<std::mutex> lock(mtx);
+                results[chunk.index] = std::move(chunk_segments);
+            }
+        });
+    }
+
+    const size_t frame = WHISPER_SAMPLE_RATE * SILENCE_FRAME_MS / 1000;
+    const size_t min_len = static_cast<size_t>(LONG_AUDIO_MIN_CHUNK_S) * WHISPER_SAMPLE_RATE;
+    const size_t max_len = static_cast<size_t>(LONG_AUDIO_MAX_CHUNK_S) * WHISPER_SAMPLE_RATE;
+
+    std::vector<float> current;
+    current.reserve(max_len + frame);
+    std::vector<float> block(frame);
+    size_t quietest_pos = 0;
+    float quietest_rms = std::numeric_limits<float>::max();
+    int64_t emitted = 0; // samples already handed to the workers
+    size_t index = 0;
+
+    auto emit = [&](size_t cut) {
+        Chunk chunk{index++, emitted * 1000 / WHISPER_SAMPLE_RATE,
+                    std::vector<float>(current.begin(), current.begin() + cut)};
+        current.erase(current.begin(), current.begin() + cut);
+        emitted += cut;
+        quietest_rms = std::numeric_limits<float>::max();
+
+        std::unique_lock<std::mutex> lock(mtx);
+        queue_not_full.wait(lock, [&] { return queue.size() < static_cast<size_t>(n_states); });
+        queue.push_back(std::move(chunk));
+        lock.unlock();
+        queue_not_empty.notify_one();
+    };
+
+    size_t n;
+    while ((n = reader.read(block.data(), frame)) > 0) {
+        current.insert(current.end(), block.begin(), block.begin() + n);
+        if (current.size() < min_len) continue;
+
+        float rms = frame_rms(block.data(), n);
+        if (rms < quietest_rms) {
+            quietest_rms = rms;
+            quietest_pos = current.size();
+        }
+        if (rms < SILENCE_RMS_THRESHOLD) {
+            emit(current.size());
+        } else if (current.size() >= max_len) {
+            // No real silence in the window: cut at the quietest frame, carry the rest over
+            emit(quietest_pos);
+        }
+    }
+    if (!current.empty()) {
+        emit(current.size());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        finished = true;
+    }
+    queue_not_empty.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    // Stitch the chunks back in order
+    std::string transcript;
+    for (auto &[chunk_index, chunk_segments] : results) {
+        for (TranscriptSegment &segment : chunk_segments) {
+            transcript += segment.text;
+            if (segments) segments->push_back(std::move(segment));
+        }
+    }
+
+    logMsg("✅ Audio largo transcrito: " + filename + " (" + std::to_string(index) + " trozos, " +
+           std::to_string(n_states) + " estados)");
+    return transcript;
+}
+
+// Decode one whole file on a pooled state and time it
+TranscriptionResult Transcriber::transcribe_file_with_state(struct whisper_state* state, const std::string &path, int n_threads) {
+    WavReader reader;
+    if (!reader.open(path)) {
+        logMsg(reader.error());
+        TranscriptionResult result;
+        result.file = path;
+        return result;
+    }
+    TranscriptionResult result = transcribe_samples_with_state(state, reader.read_all(), n_threads);
+    result.file = path;
+    if (!result.ok) logMsg("❌ No hay datos de audio: " + path);
+    return result;
+}
+
+// Decode samples already in memory on a pooled state and time it
+TranscriptionResult Transcriber::transcribe_samples_with_state(struct whisper_state* state, std::vector<float> samples, int n_threads) {
+    TranscriptionResult result;
+    result.audio_seconds = static_cast<double>(samples.size()) / WHISPER_SAMPLE_RATE;
+    if (samples.empty()) return result;
+
+    if (frontendEnabled) {
+        auto frontStart = std::chrono::steady_clock::now();
+        preprocess_audio(samples, frontend, WHISPER_SAMPLE_RATE);
+        result.frontend_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frontStart).count();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    result.segments = transcribe_with_state(state, samples, 0, n_threads, &result.fallbacks);
+    result.processing_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    for (const TranscriptSegment &segment : result.segments) {
+        result.text += segment.text;
+    }
+    result.ok = true;
+    return result;
+}
+
+size_t Transcriber::prepare_pool(size_t n) {
+    ensure_states(n);
+    return states.size();
+}
+
+TranscriptionResult Transcriber::transcribe_on(size_t slot, const std::vector<float> &samples, int n_threads) {
+    if (slot >= states.size()) return TranscriptionResult();
+    return transcribe_samples_with_state(states[slot], samples, n_threads);
+}
+
+TranscriptionResult Transcriber::transcribe_file_on(size_t slot, const std::string &path, int n_threads) {
+    if (slot >= states.size()) {
+        TranscriptionResult result;
+        result.file = path;
+        return result;
+    }
+    return transcribe_file_with_state(states[slot], path, n_threads);
+}
+
+// Single file with the first pooled state and whisper's default thread count
+TranscriptionResult Transcriber::transcribe_file(const std::string &path) {
+    ensure_states(1);
+    if (states.empty()) {
+        TranscriptionResult result;
+        result.file = path;
+        return result;
+    }
+    return transcribe_file_with_state(states[0], path, whisper_crear_parametros(WHISPER_SAMPLING_GREEDY).n_threads);
+}
+
+// Files already transcribed successfully in a previous JSONL output; failed ones are retried
+static std::set<std::string> completed_files(const std::string &outputPath) {
+    std::set<std::string> done;
+    std::ifstream in(outputPath);
+    if (!in) return done;
+
+    std::string line;
+    std::streamoff validBytes = 0;
+    size_t skipped = 0;
+    while (std::getline(in, line)) {
+        if (in.eof()) break; // last line without '\n' was cut mid-write
+        validBytes = in.tellg();
+        try {
+            nlohmann::json entry = nlohmann::json::parse(line);
+            if (entry.value("ok", false) && entry.contains("file")) done.insert(entry["file"].get<std::string>());
+        } catch (...) {
+            skipped++; // A corrupt line does not invalidate the results after it
+        }
+    }
+    in.close();
+
+    if (skipped > 0) {
+        logMsg("⚠️ " + std::to_string(skipped) + " líneas no válidas ignoradas en " + outputPath);
+    }
+    // Drop a partially written trailing line so appended results stay one per line
+    if (static_cast<std::uintmax_t>(validBytes) < std::filesystem::file_size(outputPath)) {
+        std::filesystem::resize_file(outputPath, validBytes);
+        logMsg("⚠️ Se descartó una línea incompleta al final de " + outputPath);
+    }
+    return done;
+}
+
+// Remove the {"ok": false} lines of the files about to be retried, so each file keeps one line.
+// Rewritten to a temporary file and renamed: an interruption leaves the old output intact.
+static bool drop_failed_entries(const std::string &outputPath, const std::set<std::string> &retrying) {
+    std::ifstream in(outputPath);
+    if (!in) return true;
+
+    std::vector<std::string> kept;
+    size_t dropped = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        nlohmann::json entry = nlohmann::json::parse(line, nullptr, false);
+        if (entry.is_object() && !entry.value("ok", false) && entry.contains("file") && entry["file"].is_string() &&
+            retrying.count(entry["file"].get<std::string>())) {
+            dropped++;
+            continue;
+        }
+        kept.push_back(line);
+    }
+    in.close();
+    if (dropped == 0) return true;
+
+    std::string tmpPath = outputPath + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::trunc);
+        for (const std::string &entry : kept) out << entry << '\n';
+        out.flush();
+        if (!out) {
+            logMsg("❌ Error: No se pudo reescribir " + outputPath);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, outputPath, ec);
+    if (ec) {
+        logMsg("❌ Error: No se pudo reemplazar " + outputPath + ": " + ec.message());
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    logMsg("Reintentando " + std::to_string(dropped) + " archivos que fallaron en " + outputPath);
+    return true;
+}
+
+// Batch mode: one model load, files spread over the state pool, JSONL output
+int Transcriber::transcribe_batch(const std::vector<std::string> &files, const std::string &outputPath, int n_states) {
+    std::set<std::string> done = completed_files(outputPath);
+    std::vector<std::string> pending;
+    for (const std::string &file : files) {
+        if (!done.count(file)) pending.push_back(file);
+    }
+    if (!done.empty()) {
+        logMsg("Reanudando lote: " + std::to_string(done.size()) + " archivos ya estaban en " + outputPath);
+    }
+    if (pending.empty()) return 0;
+    if (!drop_failed_entries(outputPath, std::set<std::string>(pending.begin(), pending.end()))) return 0;
+
+    std::ofstream out(outputPath, std::ios::app);
+    if (!out) {
+        logMsg("❌ Error: No se pudo abrir el archivo de salida " + outputPath);
+        return 0;
+    }
+
+    int hw = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (n_states <= 0) {
+        n_states = std::max(1, hw / LONG_AUDIO_THREADS_PER_STATE);
+    }
+    n_states = std::min<int>(n_states, pending.size());
+    ensure_states(n_states);
+    n_states = std::min<int>(n_states, states.size());
+    if (n_states == 0) {
+        logMsg("❌ No hay estados de Whisper disponibles para el modo por lotes.");
+        return 0;
+    }
+    int threads_per_state = std::max(1, hw / n_states);
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> processed{0};
+    std::mutex out_mutex;
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < n_states; ++w) {
+        workers.emplace_back([&, state = states[w]]() {
+            for (size_t i = next++; i < pending.size(); i = next++) {
+                TranscriptionResult result = transcribe_file_with_state(state, pending[i], threads_per_state);
+
+                nlohmann::json entry;
+                entry["file"] = result.file;
+                entry["ok"] = result.ok;
+                entry["text"] = result.text;
+                entry["segments"] = nlohmann::json::array();
+                for (const TranscriptSegment &segment : result.segments) {
+                    entry["segments"].push_back({{"t0", segment.t0_ms / 1000.0}, {"t1", segment.t1_ms / 1000.0}, {"text", segment.text}});
+                }
+                entry["duration_s"] = result.audio_seconds;
+                entry["processing_s"] = result.processing_seconds;
+                entry["rtf"] = result.audio_seconds > 0 ? result.processing_seconds / result.audio_seconds : 0.0;
+                entry["fallbacks"] = result.fallbacks;
+
+                // One flushed line per file: an interruption loses at most the line being written
+                std::lock_guard<std::mutex> lock(out_mutex);
+                out << entry.dump() << '\n';
+                out.flush();
+                processed++;
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    logMsg("✅ Lote terminado: " + std::to_string(processed.load()) + " archivos en " + outputPath);
+    return processed;
+}
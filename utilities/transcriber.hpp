@@ -11,6 +11,11 @@
 #include <chrono>
 #include <thread>
 #include <fstream>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include "vad.hpp"
+#include "audio_frontend.hpp"
 
 // Macros para hacer la API de Whisper más intuitiva.
 #define ModeloWhisper struct whisper_context
@@ -44,6 +49,16 @@
 // Macro para normalizar la muestra
 #define NORMALIZE_SAMPLE(sample)  (sample / MAX_SAMPLE_VALUE)
 
+// Macros para el modo de audio largo (cortes en silencios, trozos de máximo 30 s)
+#define LONG_AUDIO_MIN_CHUNK_S      20      // Desde aquí se busca un silencio para cortar
+#define LONG_AUDIO_MAX_CHUNK_S      30      // Ventana máxima de Whisper
+#define SILENCE_FRAME_MS            20      // Tamaño del frame para medir energía
+#define SILENCE_RMS_THRESHOLD       0.01f   // ~ -40 dBFS
+#define LONG_AUDIO_THREADS_PER_STATE 4      // Hilos de Whisper por cada estado del pool
+
+// Transcripciones parciales durante la grabación por VAD
+#define PARTIAL_INTERVAL_MS         700     // Audio nuevo necesario para lanzar otra parcial
+
 // Función para obtener la configuración de la terminal
 void set_terminal_attributes(struct termios& oldt, struct termios& newt);
 
@@ -56,27 +71,150 @@ int get_key();
 // Declaración de la función keyboardhit.
 bool keyboardhit();
 
+// Segmento transcrito con marcas de tiempo absolutas en milisegundos.
+struct TranscriptSegment {
+    int64_t t0_ms;
+    int64_t t1_ms;
+    std::string text;
+};
+
+// Umbrales para marcar una transcripción como dudosa en lugar de mandarla al modelo
+#define WHISPER_LOW_CONFIDENCE_P    0.45f   // Probabilidad media de los tokens de texto
+#define WHISPER_HIGH_NO_SPEECH_P    0.6f    // Probabilidad de que el audio no tenga voz
+#define WHISPER_MIN_CONFIDENCE_TOKENS 3     // Con menos tokens de texto ("Yes.") la media no dice nada
+
+// Confianza de un segmento: media de la probabilidad de sus tokens de texto y la
+// probabilidad de "no hay voz" que Whisper estima para su ventana.
+struct SegmentConfidence {
+    std::string text;
+    float avg_token_p = 0.0f;
+    float no_speech_p = 0.0f;
+};
+
+// Métricas de un turno de voz (transcribe_audio), exportadas a ../logs/metrics.jsonl.
+struct TranscriptionMetrics {
+    double audio_seconds = 0.0;
+    double encode_seconds = 0.0;    // Encoder (incluye la primera pasada del prompt)
+    double decode_seconds = 0.0;    // Resto: decodificación de tokens y reintentos
+    double rtf = 0.0;
+    int fallbacks = 0;              // Reintentos a mayor temperatura
+    std::vector<SegmentConfidence> segments;
+    int text_tokens = 0;            // Tokens de texto de todo el turno (0: no se entendió nada)
+    float avg_token_p = 0.0f;       // Media de todo el turno, ponderada por tokens
+    float max_no_speech_p = 0.0f;
+    bool low_confidence = false;    // Solo se juzga desde WHISPER_MIN_CONFIDENCE_TOKENS tokens
+    bool remote = false;            // Transcrito por el servicio: sin confianza, text_tokens cuenta palabras
+};
+
+// Resultado de transcribir un archivo completo (modo por lotes).
+struct TranscriptionResult {
+    std::string file;
+    std::string text;
+    std::vector<TranscriptSegment> segments;
+    double audio_seconds = 0.0;
+    double processing_seconds = 0.0;
+    double frontend_seconds = 0.0; // Preprocesado (fuera de processing_seconds)
+    int fallbacks = 0;             // Reintentos de Whisper a mayor temperatura
+    bool ok = false;
+};
+
 class Transcriber {
+public:
+    // Transcribe un turno en otro sitio (transcribe_remote_pcm, ver transcription_service.hpp).
+    using RemoteTranscribe = std::function<bool(const std::vector<float> &, TranscriptionResult &)>;
+
 private:
     ModeloWhisper* ctx;
+    std::vector<struct whisper_state*> states; // Pool de estados que comparten los pesos de ctx
     std::string audioFile;
     const char* recordCommand;
     const char* stopCommand;
+    bool frontendEnabled = false;
+    FrontEndConfig frontend;
+    TranscriptionMetrics lastMetrics;
+    RemoteTranscribe remoteTranscribe;
+
+    Transcriber(const std::string &modelPath, const std::string &audioPath, bool exitOnError);
+    Transcriber(RemoteTranscribe remote, const std::string &audioPath);
+    // Carga el modelo en ctx; false si no se pudo (o exit(1) con exitOnError).
+    bool load_model(const std::string &modelPath, bool exitOnError);
 
 public:
     // Constructor: recibe la ruta del modelo y, opcionalmente, la ruta del archivo de audio.
-    Transcriber(const std::string &modelPath, const std::string &audioPath = "audio.wav");
+    // Con modelPath vacío se usa el modelo elegido por la calibración (ver model_selector.hpp).
+    // Cada carga deja una línea "model_load" con la memoria residente en ../logs/metrics.jsonl.
+    // Si el modelo no se puede cargar termina el proceso; para probar modelos usar open().
+    Transcriber(const std::string &modelPath = "", const std::string &audioPath = "audio.wav");
+    // Como el constructor, pero devuelve nullptr si el modelo no se puede cargar.
+    static std::unique_ptr<Transcriber> open(const std::string &modelPath, const std::string &audioPath = "audio.wav");
+    // Sin modelo propio: graba aquí y cada turno (y los parciales) los transcribe remote, p. ej.
+    // el servicio que ya tiene el modelo cargado. Si remote falla se carga el modelo calibrado y
+    // se sigue en local. Solo para turnos de voz: grabación, transcribe_audio y last_metrics.
+    static std::unique_ptr<Transcriber> remote(RemoteTranscribe remote, const std::string &audioPath = "audio.wav");
     // Destructor: libera la memoria de Whisper.
     ~Transcriber();
 
     // Métodos públicos para controlar la grabación y transcribir el audio.
     void start_microphone();
     void stop_microphone();
+    // Alternativa a R/S: escucha el micrófono, empieza con la voz y se detiene sola tras
+    // config.hangover_ms de silencio. Guarda el turno ya recortado en audioFile.
+    // Si se pasa on_partial, mientras el usuario habla se transcribe lo grabado hasta el
+    // momento en segundo plano y se entrega el texto (mismo formato que transcribe_audio).
+    // Con playback, se puede hablar encima de la respuesta del asistente (barge-in): la
+    // escucha empieza mientras suena y la voz del usuario la baja y luego la corta.
+    // no_speech: pasó config.max_wait_ms sin voz, se puede volver a escuchar.
+    // capture_failed: arecord no arrancó o el micrófono dejó de dar audio; reintentar no sirve.
+    enum class RecordResult { recorded, no_speech, capture_failed };
+    RecordResult record_until_silence(const VadConfig &config = VadConfig(),
+                              std::function<void(const std::string&)> on_partial = nullptr,
+                              const PlaybackMonitor *playback = nullptr);
     std::string transcribe_audio();
+    // Métricas del último transcribe_audio; low_confidence indica que el texto es dudoso.
+    const TranscriptionMetrics &last_metrics() const { return lastMetrics; }
+
+    // Preprocesado opcional (paso alto, reducción de ruido, AGC) antes de decodificar
+    // en transcribe_audio y transcribe_file. Desactivado por defecto.
+    void set_frontend(const FrontEndConfig &config);
+    void disable_frontend();
+
+    // Transcribe un archivo WAV (sin el prefijo "You:") midiendo su factor de tiempo real.
+    TranscriptionResult transcribe_file(const std::string &path);
+
+    // Modo para grabaciones largas: lee el WAV por bloques, lo corta en silencios y
+    // transcribe los trozos en paralelo sobre n_states estados de Whisper (0 = automático).
+    // Devuelve el texto unido en orden; si segments no es nulo se llenan las marcas de tiempo.
+    std::string transcribe_long_audio(const std::string &filename, int n_states = 0,
+                                      std::vector<TranscriptSegment>* segments = nullptr);
+
+    // Modo por lotes: carga el modelo una sola vez y reparte los archivos entre n_states
+    // estados de Whisper. Escribe una línea JSON por archivo en outputPath; los archivos
+    // que ya aparecen en outputPath se saltan, así que se puede reanudar tras una interrupción.
+    // Los que fallaron se vuelven a intentar y su línea {"ok": false} se quita antes, así que
+    // cada archivo tiene como mucho una línea.
+    // Devuelve cuántos archivos se transcribieron en esta ejecución.
+    int transcribe_batch(const std::vector<std::string> &files, const std::string &outputPath, int n_states = 0);
+
+    // Para el servicio (ver transcription_service.hpp): prepara n estados y transcribe
+    // sobre uno concreto, así varios hilos decodifican a la vez con estados distintos.
+    // prepare_pool devuelve cuántos estados hay; no es thread-safe, llamarlo antes.
+    size_t prepare_pool(size_t n);
+    TranscriptionResult transcribe_on(size_t slot, const std::vector<float> &samples, int n_threads);
+    TranscriptionResult transcribe_file_on(size_t slot, const std::string &path, int n_threads);
     
 private:
     // Método para cargar el archivo WAV y convertirlo a un vector de float.
     std::vector<float> load_audio(const std::string &filename);
+
+    // Crea estados de Whisper hasta tener n en el pool.
+    void ensure_states(size_t n);
+    // Transcribe un trozo con un estado del pool; offset_ms desplaza las marcas de tiempo.
+    // Si fallbacks no es nulo se suman los reintentos por temperatura.
+    std::vector<TranscriptSegment> transcribe_with_state(struct whisper_state* state, const std::vector<float> &samples,
+                                                         int64_t offset_ms, int n_threads, int *fallbacks = nullptr);
+    // Transcribe un archivo completo con un estado del pool y mide su factor de tiempo real.
+    TranscriptionResult transcribe_file_with_state(struct whisper_state* state, const std::string &path, int n_threads);
+    TranscriptionResult transcribe_samples_with_state(struct whisper_state* state, std::vector<float> samples, int n_threads);
 };
 
 #endif // TRANSCRIBER_HPP
\ No newline at end of file
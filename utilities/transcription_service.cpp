@@ -0,0 +1,506 @@
+#include "transcription_service.hpp"
+#include "logging.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVICE_ACCEPT_POLL_MS  200                 // Cada cuánto mira el acceptor si hay que parar
+#define SERVICE_PCM_CHUNK       32000               // Bytes por bloque al enviar PCM (1 s)
+#define SERVICE_MAX_REPLY       (16 * 1024 * 1024)  // Respuesta más larga que acepta el cliente
+
+//Logging error and success messages from other functions
+void servicelog(const std::string& message) {
+    write_log("transcription_service.log", message);
+}
+
+static bool send_all(int fd, const void *data, size_t size) {
+    const char *p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool recv_all(int fd, void *data, size_t size) {
+    char *p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Byte by byte: binary PCM may follow the line and must stay in the socket
+static bool recv_line(int fd, std::string &line, size_t maxBytes) {
+    line.clear();
+    char c;
+    while (recv_all(fd, &c, 1)) {
+        if (c == '\n') return true;
+        if (line.size() >= maxBytes) return false;
+        line += c;
+    }
+    return false;
+}
+
+static bool send_json(int fd, const nlohmann::json &message) {
+    std::string line = message.dump() + "\n";
+    return send_all(fd, line.data(), line.size());
+}
+
+static nlohmann::json result_to_json(const TranscriptionResult &result) {
+    nlohmann::json reply;
+    reply["ok"] = result.ok;
+    if (!result.ok) {
+        reply["error"] = "could not read the audio";
+        return reply;
+    }
+    reply["text"] = result.text;
+    reply["segments"] = nlohmann::json::array();
+    for (const TranscriptSegment &segment : result.segments) {
+        reply["segments"].push_back({{"t0", segment.t0_ms / 1000.0}, {"t1", segment.t1_ms / 1000.0}, {"text", segment.text}});
+    }
+    reply["audio_s"] = result.audio_seconds;
+    reply["processing_s"] = result.processing_seconds;
+    reply["fallbacks"] = result.fallbacks;
+    return reply;
+}
+
+TranscriptionService::TranscriptionService(Transcriber &transcriber, const std::string &socketPath, int nStates,
+                                           size_t maxQueued, size_t maxPerClient)
+    : transcriber(transcriber), socketPath(socketPath), nStates(nStates),
+      maxQueued(std::max<size_t>(1, maxQueued)), maxPerClient(std::max<size_t>(1, maxPerClient)) {}
+
+TranscriptionService::~TranscriptionService() {
+    stop();
+}
+
+bool TranscriptionService::start() {
+    if (running) return true;
+
+    int hw = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    if (nStates <= 0) nStates = std::max(1, hw / LONG_AUDIO_THREADS_PER_STATE);
+    size_t pool = transcriber.prepare_pool(static_cast<size_t>(nStates));
+    if (pool == 0) {
+        lastError = "❌ Error: No se pudo crear ningún estado de Whisper.";
+        return false;
+    }
+    pool = std::min(pool, static_cast<size_t>(nStates));
+    threadsPerState = std::max(1, hw / static_cast<int>(pool));
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.empty()) {
+        lastError = "❌ Error: No hay un directorio seguro para el socket (ver logs/transcription_service.log)";
+        return false;
+    }
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        lastError = "❌ Error: Ruta de socket demasiado larga: " + socketPath;
+        return false;
+    }
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        lastError = std::string("❌ Error: socket() falló: ") + std::strerror(errno);
+        return false;
+    }
+    // A leftover socket file from a crashed server is removed; a live one is left alone
+    if (connect(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+        lastError = "❌ Error: Ya hay un servicio escuchando en " + socketPath;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    close(listenFd);
+    unlink(socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listenFd, 16) != 0) {
+        lastError = "❌ Error: No se pudo escuchar en " + socketPath + ": " + std::strerror(errno);
+        if (listenFd >= 0) close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    // Only this user: the directory is 0700 already, the socket too in case --socket points elsewhere
+    chmod(socketPath.c_str(), 0600);
+
+    running = true;
+    for (size_t slot = 0; slot < pool; ++slot) workers.emplace_back(&TranscriptionService::work, this, slot);
+    acceptor = std::thread(&TranscriptionService::accept_loop, this);
+    servicelog("✅ Servicio escuchando en " + socketPath + " con " + std::to_string(pool) + " estados de " +
+               std::to_string(threadsPerState) + " hilos");
+    return true;
+}
+
+void TranscriptionService::stop() {
+    if (!running.exchange(false)) return;
+
+    if (acceptor.joinable()) acceptor.join();
+    close(listenFd);
+    listenFd = -1;
+
+    cv.notify_all();
+    for (std::thread &worker : workers) worker.join();
+    workers.clear();
+
+    // Whatever was still waiting gets an answer so its connection can finish
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &entry : queues) {
+            for (auto &job : entry.second) job->reply.set_value({{"ok", false}, {"error", "shutting down"}});
+        }
+        queues.clear();
+        turn.clear();
+        queued = 0;
+    }
+
+    // done is set under the lock before the fd is closed, so only open fds are shut down
+    std::list<std::unique_ptr<Connection>> open;
+    {
+        std::lock_guard<std::mutex> lock(connectionsMtx);
+        for (auto &connection : connections) {
+            if (!connection->done) shutdown(connection->fd, SHUT_RDWR);
+        }
+        open.swap(connections);
+    }
+    for (auto &connection : open) connection->thread.join();
+
+    unlink(socketPath.c_str());
+    servicelog("🛑 Servicio detenido");
+}
+
+void TranscriptionService::accept_loop() {
+    while (running) {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (poll(&pfd, 1, SERVICE_ACCEPT_POLL_MS) <= 0) continue;
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) continue;
+        // An idle or stalled client gives up its thread instead of keeping it forever
+        timeval timeout{SERVICE_RECV_TIMEOUT_S, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::lock_guard<std::mutex> lock(connectionsMtx);
+        // Reap finished connections so a long-running service does not pile up threads
+        for (auto it = connections.begin(); it != connections.end();) {
+            if ((*it)->done) {
+                (*it)->thread.join();
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (connections.size() >= SERVICE_MAX_CONNECTIONS) {
+            double retrySeconds;
+            {
+                std::lock_guard<std::mutex> queueLock(mtx); // work() updates the average under mtx
+                retrySeconds = avgProcessingSeconds;
+            }
+            send_json(fd, {{"ok", false}, {"error", "busy"}, {"retry_after_ms", static_cast<int>(retrySeconds * 1000)}});
+            close(fd);
+            servicelog("⏳ Conexión rechazada: ya hay " + std::to_string(connections.size()) + " abiertas");
+            continue;
+        }
+        connections.push_back(std::make_unique<Connection>());
+        Connection *connection = connections.back().get();
+        connection->fd = fd;
+        connection->thread = std::thread(&TranscriptionService::serve, this, connection);
+    }
+}
+
+void TranscriptionService::serve(Connection *connection) {
+    const int fd = connection->fd;
+    ucred peer{};
+    socklen_t peerSize = sizeof(peer);
+    // Without credentials the client would pass for root (uid 0) in the limits and the logs
+    bool identified = getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &peerSize) == 0;
+    if (!identified) {
+        servicelog(std::string("❌ Conexión rechazada: SO_PEERCRED falló: ") + std::strerror(errno));
+        send_json(fd, {{"ok", false}, {"error", "could not identify the client"}});
+    }
+
+    std::string line;
+    while (identified && running && recv_line(fd, line, SERVICE_MAX_HEADER)) {
+        nlohmann::json request = nlohmann::json::parse(line, nullptr, false);
+        auto job = std::make_unique<Job>();
+        job->client = peer.pid;
+
+        bool isWav = request.is_object() && request.contains("wav") && request["wav"].is_string();
+        bool isPcm = !isWav && request.is_object() && request.value("pcm", false);
+        if (!isWav && !isPcm) {
+            send_json(fd, {{"ok", false}, {"error", "expected {\"wav\": PATH} or {\"pcm\": true}"}});
+            continue;
+        }
+        if (isWav && peer.uid != getuid()) {
+            // The service could read files the client cannot: other users send PCM
+            send_json(fd, {{"ok", false}, {"error", "wav paths are only accepted from the same user, send pcm"}});
+            continue;
+        }
+
+        // Admission before the body: a rejected upload is never buffered
+        nlohmann::json rejection;
+        if (!admit(peer.pid, rejection)) {
+            if (!send_json(fd, rejection) || isPcm) break; // The PCM that follows is not read
+            continue;
+        }
+
+        if (isWav) {
+            job->path = request["wav"].get<std::string>();
+        } else {
+            const size_t maxBytes = static_cast<size_t>(SERVICE_MAX_AUDIO_S) * WHISPER_SAMPLE_RATE * sizeof(int16_t);
+            std::vector<int16_t> pcm;
+            bool complete = false, tooLong = false;
+            uint32_t bytes = 0;
+            while (recv_all(fd, &bytes, sizeof(bytes))) {
+                if (bytes == 0) {
+                    complete = true;
+                    break;
+                }
+                size_t have = pcm.size();
+                if (have * sizeof(int16_t) + bytes > maxBytes || bytes % sizeof(int16_t) != 0) {
+                    tooLong = true;
+                    break;
+                }
+                pcm.resize(have + bytes / sizeof(int16_t));
+                if (!recv_all(fd, pcm.data() + have, bytes)) break;
+            }
+            if (tooLong) {
+                // The rest of the stream cannot be skipped reliably: answer and drop the connection
+                release(peer.pid);
+                send_json(fd, {{"ok", false}, {"error", "pcm stream too long or misaligned"}});
+                break;
+            }
+            if (!complete) {
+                release(peer.pid);
+                break;
+            }
+            job->samples.resize(pcm.size());
+            for (size_t i = 0; i < pcm.size(); ++i) job->samples[i] = pcm[i] / 32768.0f;
+        }
+
+        std::future<nlohmann::json> reply = submit(std::move(job));
+        if (!send_json(fd, reply.get())) break;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(connectionsMtx);
+        connection->done = true;
+    }
+    close(fd);
+}
+
+bool TranscriptionService::admit(pid_t client, nlohmann::json &rejection) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = queues.find(client);
+    auto mineReserved = reservedBy.find(client);
+    size_t mine = (it == queues.end() ? 0 : it->second.size()) + (mineReserved == reservedBy.end() ? 0 : mineReserved->second);
+    if (!running || queued + reserved >= maxQueued || mine >= maxPerClient) {
+        // Rough wait: the queue ahead split over the pool, times the recent decode time
+        double waitSeconds = avgProcessingSeconds * (static_cast<double>(queued + reserved) / std::max<size_t>(1, workers.size()) + 1.0);
+        rejection = {{"ok", false}, {"error", running ? "busy" : "shutting down"},
+                     {"retry_after_ms", static_cast<int>(waitSeconds * 1000)}};
+        servicelog("⏳ Petición rechazada del proceso " + std::to_string(client) + " (" +
+                   std::to_string(queued + reserved) + " en cola, " + std::to_string(mine) + " suyas)");
+        return false;
+    }
+    reserved++;
+    reservedBy[client]++;
+    return true;
+}
+
+// Requiere mtx
+static void unreserve(std::map<pid_t, size_t> &reservedBy, size_t &reserved, pid_t client) {
+    auto it = reservedBy.find(client);
+    if (it == reservedBy.end()) return;
+    if (--it->second == 0) reservedBy.erase(it);
+    reserved--;
+}
+
+void TranscriptionService::release(pid_t client) {
+    std::lock_guard<std::mutex> lock(mtx);
+    unreserve(reservedBy, reserved, client);
+}
+
+std::future<nlohmann::json> TranscriptionService::submit(std::unique_ptr<Job> job) {
+    std::lock_guard<std::mutex> lock(mtx);
+    unreserve(reservedBy, reserved, job->client);
+    std::future<nlohmann::json> reply = job->reply.get_future();
+    if (!running) {
+        // stop() already answered the queue: this one gets the same answer
+        job->reply.set_value({{"ok", false}, {"error", "shutting down"}});
+        return reply;
+    }
+    job->queued = std::chrono::steady_clock::now();
+    auto it = queues.find(job->client);
+    if (it == queues.end() || it->second.empty()) turn.push_back(job->client);
+    queues[job->client].push_back(std::move(job));
+    queued++;
+    cv.notify_one();
+    return reply;
+}
+
+// Requiere mtx. Round robin: one job from the client whose turn it is, which then goes last
+std::unique_ptr<TranscriptionService::Job> TranscriptionService::next_job() {
+    pid_t client = turn.front();
+    turn.pop_front();
+    std::deque<std::unique_ptr<Job>> &queue = queues[client];
+    std::unique_ptr<Job> job = std::move(queue.front());
+    queue.pop_front();
+    if (queue.empty()) {
+        queues.erase(client);
+    } else {
+        turn.push_back(client);
+    }
+    queued--;
+    return job;
+}
+
+void TranscriptionService::work(size_t slot) {
+    while (true) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this]() { return !running || queued > 0; });
+            if (!running) return;
+            job = next_job();
+        }
+
+        double queueSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job->queued).count();
+        TranscriptionResult result = job->path.empty() ? transcriber.transcribe_on(slot, job->samples, threadsPerState)
+                                                       : transcriber.transcribe_file_on(slot, job->path, threadsPerState);
+        nlohmann::json reply = result_to_json(result);
+        reply["queue_s"] = queueSeconds;
+
+        if (result.ok) {
+            std::lock_guard<std::mutex> lock(mtx);
+            avgProcessingSeconds += 0.2 * (result.processing_seconds - avgProcessingSeconds);
+        }
+        job->reply.set_value(reply);
+    }
+}
+
+std::string transcription_socket_path() {
+    const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) return std::string(runtime) + "/" TRANSCRIPTION_SOCKET_NAME;
+
+    // A directory of our own: in /tmp anyone could create (squat) a fixed socket name first
+    std::string directory = "/tmp/ova-" + std::to_string(getuid());
+    if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        servicelog("❌ No se pudo crear " + directory + ": " + std::strerror(errno));
+        return "";
+    }
+    struct stat info {};
+    if (lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid() || (info.st_mode & 077) != 0) {
+        servicelog("❌ " + directory + " no es un directorio 0700 de este usuario; no se usa para el socket");
+        return "";
+    }
+    return directory + "/" TRANSCRIPTION_SOCKET_NAME;
+}
+
+static int connect_service(const std::string &socketPath) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) return -1;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool read_reply(int fd, TranscriptionResult &result) {
+    std::string line;
+    if (!recv_line(fd, line, SERVICE_MAX_REPLY)) {
+        servicelog("❌ El servicio cerró la conexión sin responder.");
+        return false;
+    }
+    nlohmann::json reply = nlohmann::json::parse(line, nullptr, false);
+    if (!reply.is_object() || !reply.value("ok", false)) {
+        servicelog("❌ El servicio rechazó la petición: " + line);
+        return false;
+    }
+
+    result.text = reply.value("text", "");
+    result.audio_seconds = reply.value("audio_s", 0.0);
+    result.processing_seconds = reply.value("processing_s", 0.0);
+    result.fallbacks = reply.value("fallbacks", 0);
+    result.segments.clear();
+    for (const auto &segment : reply.value("segments", nlohmann::json::array())) {
+        result.segments.push_back({static_cast<int64_t>(segment.value("t0", 0.0) * 1000),
+                                   static_cast<int64_t>(segment.value("t1", 0.0) * 1000),
+                                   segment.value("text", "")});
+    }
+    result.ok = true;
+    return true;
+}
+
+bool transcription_service_available(const std::string &socketPath) {
+    int fd = connect_service(socketPath);
+    if (fd < 0) return false;
+    close(fd);
+    return true;
+}
+
+bool transcribe_remote(const std::string &wavPath, TranscriptionResult &result, const std::string &socketPath) {
+    result = TranscriptionResult();
+    result.file = wavPath;
+    int fd = connect_service(socketPath);
+    if (fd < 0) {
+        servicelog("❌ No hay servicio de transcripción en " + socketPath);
+        return false;
+    }
+    // The service runs elsewhere: relative paths are resolved here
+    std::error_code ec;
+    std::string absolute = std::filesystem::absolute(wavPath, ec).string();
+    bool ok = send_json(fd, {{"wav", ec ? wavPath : absolute}}) && read_reply(fd, result);
+    close(fd);
+    return ok;
+}
+
+bool transcribe_remote_pcm(const std::vector<float> &samples, TranscriptionResult &result, const std::string &socketPath) {
+    result = TranscriptionResult();
+    int fd = connect_service(socketPath);
+    if (fd < 0) {
+        servicelog("❌ No hay servicio de transcripción en " + socketPath);
+        return false;
+    }
+
+    bool ok = send_json(fd, {{"pcm", true}});
+    std::vector<int16_t> chunk;
+    const size_t perChunk = SERVICE_PCM_CHUNK / sizeof(int16_t);
+    for (size_t pos = 0; ok && pos < samples.size(); pos += perChunk) {
+        size_t n = std::min(perChunk, samples.size() - pos);
+        chunk.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            chunk[i] = static_cast<int16_t>(std::max(-1.0f, std::min(1.0f, samples[pos + i])) * 32767.0f);
+        }
+        uint32_t bytes = static_cast<uint32_t>(n * sizeof(int16_t));
+        ok = send_all(fd, &bytes, sizeof(bytes)) && send_all(fd, chunk.data(), bytes);
+    }
+    uint32_t end = 0;
+    ok = ok && send_all(fd, &end, sizeof(end));
+    // A busy service answers right after the header and closes: its reply is still readable
+    ok = read_reply(fd, result) && ok;
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,121 @@
+#ifndef TRANSCRIPTION_SERVICE_HPP
+#define TRANSCRIPTION_SERVICE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "transcriber.hpp"
+#include "json.hpp"
+
+#define TRANSCRIPTION_SOCKET_NAME   "ova-transcriber.sock"  // En $XDG_RUNTIME_DIR o en /tmp/ova-<uid>/
+#define SERVICE_MAX_QUEUED          32      // Peticiones esperando en total
+#define SERVICE_MAX_PER_CLIENT      4       // Peticiones esperando de un mismo proceso
+#define SERVICE_MAX_AUDIO_S         600     // Audio máximo por petición PCM
+#define SERVICE_MAX_HEADER          4096    // Bytes de la línea JSON de cada petición
+#define SERVICE_MAX_CONNECTIONS     64      // Conexiones abiertas a la vez (un hilo cada una)
+#define SERVICE_RECV_TIMEOUT_S      30      // Un cliente que no envía nada en este tiempo se desconecta
+
+// $XDG_RUNTIME_DIR/ova-transcriber.sock, o /tmp/ova-<uid>/ova-transcriber.sock (directorio 0700
+// que se crea si falta). Vacío si el directorio existe pero no es solo de este usuario.
+std::string transcription_socket_path();
+
+// Servicio local de transcripción: un solo modelo de Whisper atiende a todos los
+// terminales y scripts del usuario por un socket Unix en un directorio solo suyo.
+//
+// Protocolo (una petición tras otra en la misma conexión):
+//   -> {"wav": "/ruta/absoluta.wav"}\n
+//   -> {"pcm": true}\n  y luego bloques [uint32 LE bytes][int16 LE, 16 kHz mono], fin = bloque de 0 bytes
+//   <- {"ok": true, "text": ..., "segments": [...], "audio_s": ..., "queue_s": ..., "processing_s": ...}\n
+//   <- {"ok": false, "error": "busy"|..., "retry_after_ms": ...}\n
+//
+// Las peticiones entran en una cola por cliente (proceso que se conecta, según
+// SO_PEERCRED) y los estados libres las toman por turnos, así un script con muchas
+// peticiones no deja sin servicio a los demás. Si la cola global o la del cliente están
+// llenas la petición se rechaza al momento con "busy" en lugar de acumular memoria: con
+// PCM el rechazo llega tras la cabecera, sin leer el audio, y se cierra la conexión.
+class TranscriptionService {
+public:
+    TranscriptionService(Transcriber &transcriber, const std::string &socketPath = transcription_socket_path(),
+                         int nStates = 0, size_t maxQueued = SERVICE_MAX_QUEUED,
+                         size_t maxPerClient = SERVICE_MAX_PER_CLIENT);
+    ~TranscriptionService();
+
+    // Crea el socket y arranca los hilos. false y error() si no se pudo.
+    bool start();
+    // Deja de aceptar, corta las conexiones abiertas y espera a los hilos.
+    void stop();
+
+    const std::string &error() const { return lastError; }
+    size_t states() const { return workers.size(); }
+
+private:
+    struct Job {
+        pid_t client = 0;
+        std::string path;             // petición "wav"
+        std::vector<float> samples;   // petición "pcm"
+        std::chrono::steady_clock::time_point queued;
+        std::promise<nlohmann::json> reply;
+    };
+
+    struct Connection {
+        int fd = -1;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    void accept_loop();
+    void serve(Connection *connection);
+    void work(size_t slot);
+    // Reserva un hueco en la cola antes de leer el cuerpo, o rechaza (backpressure).
+    bool admit(pid_t client, nlohmann::json &rejection);
+    // Encola en el hueco reservado con admit(); release() lo devuelve si la petición no llega entera.
+    std::future<nlohmann::json> submit(std::unique_ptr<Job> job);
+    void release(pid_t client);
+    std::unique_ptr<Job> next_job(); // Requiere mtx
+
+    Transcriber &transcriber;
+    std::string socketPath;
+    int nStates;
+    size_t maxQueued;
+    size_t maxPerClient;
+    int threadsPerState = 1;
+    std::string lastError;
+
+    int listenFd = -1;
+    std::atomic<bool> running{false};
+    std::thread acceptor;
+    std::vector<std::thread> workers;
+    std::mutex connectionsMtx;
+    std::list<std::unique_ptr<Connection>> connections;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::map<pid_t, std::deque<std::unique_ptr<Job>>> queues;
+    std::deque<pid_t> turn;           // Clientes con trabajo pendiente, en orden de turno
+    size_t queued = 0;
+    size_t reserved = 0;              // Admitidas cuyo audio aún se está recibiendo
+    std::map<pid_t, size_t> reservedBy;
+    double avgProcessingSeconds = 1.0;  // Requiere mtx
+};
+
+// Cliente: transcribe un WAV (ruta que el servicio pueda leer) o PCM en memoria con el
+// servicio que escucha en socketPath. false si no hay servicio o rechazó la petición.
+bool transcribe_remote(const std::string &wavPath, TranscriptionResult &result,
+                       const std::string &socketPath = transcription_socket_path());
+bool transcribe_remote_pcm(const std::vector<float> &samples, TranscriptionResult &result,
+                           const std::string &socketPath = transcription_socket_path());
+// true si hay un servicio escuchando en socketPath (solo conecta, no envía nada).
+bool transcription_service_available(const std::string &socketPath = transcription_socket_path());
+
+void servicelog(const std::string &message);
+
+#endif // TRANSCRIPTION_SERVICE_HPP
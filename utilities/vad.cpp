@@ -0,0 +1,176 @@
+#include "vad.hpp"
+#include "spectrum.hpp"
+#include <algorithm>
+#include <cmath>
+
+#define VAD_NFFT                512
+#define VAD_ABSOLUTE_FLOOR_DB   -60.0f  // Nada por debajo de esto es voz
+#define VAD_MIN_BAND_RATIO      0.6f    // Fracción mínima de energía en 80-4000 Hz
+#define VAD_MAX_FLATNESS        0.35f   // Ruido blanco ~0.56 por frame, voz sonora < 0.2
+#define VAD_FLOOR_ADAPT         0.05f   // Velocidad con que sube el piso de ruido
+#define VAD_ECHO_ADAPT          0.1f    // Velocidad con que se sigue el nivel del eco
+
+float frame_energy_db(const float *frame, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) sum += frame[i] * frame[i];
+    return 10.0f * std::log10(static_cast<float>(n ? sum / n : 0.0) + 1e-10f);
+}
+
+VoiceActivityDetector::VoiceActivityDetector(const VadConfig &config) : config(config) {}
+
+bool VoiceActivityDetector::is_speech(const float *frame, size_t n) {
+    float energy = frame_energy_db(frame, n);
+    if (!floorInitialized) {
+        // The capture starts before the user speaks: the first frame seeds the floor
+        noiseFloorDb = energy;
+        floorInitialized = true;
+        return false;
+    }
+
+    bool speech = false;
+    if (energy > noiseFloorDb + config.threshold_db && energy > VAD_ABSOLUTE_FLOOR_DB) {
+        power_spectrum(frame, n, VAD_NFFT, power);
+
+        const float binHz = static_cast<float>(config.sample_rate) / VAD_NFFT;
+        auto bin = [&](float hz) { return std::min(power.size() - 1, static_cast<size_t>(hz / binHz)); };
+        size_t hum = bin(60) + 1; // ignore DC and mains hum
+
+        // Share of the energy where speech lives (pitch included)
+        double total = 0.0, voiceBand = 0.0;
+        for (size_t k = hum; k < power.size(); ++k) total += power[k];
+        for (size_t k = bin(80); k <= bin(4000); ++k) voiceBand += power[k];
+        double ratio = total > 0 ? voiceBand / total : 0.0;
+
+        // Spectral flatness over the formant band: harmonic speech is peaky, noise is flat
+        double band = 0.0, logSum = 0.0;
+        size_t low = bin(300), high = bin(3400);
+        for (size_t k = low; k <= high; ++k) {
+            band += power[k];
+            logSum += std::log(power[k] + 1e-12);
+        }
+        size_t bandBins = high - low + 1;
+        double arithmetic = band / bandBins;
+        double geometric = std::exp(logSum / bandBins);
+        double flatness = arithmetic > 0 ? geometric / arithmetic : 1.0;
+
+        speech = ratio > VAD_MIN_BAND_RATIO && flatness < VAD_MAX_FLATNESS;
+    }
+
+    if (!speech) {
+        // Drop straight to quieter levels, rise slowly towards louder ones
+        noiseFloorDb = energy < noiseFloorDb ? energy : noiseFloorDb + VAD_FLOOR_ADAPT * (energy - noiseFloorDb);
+    }
+    return speech;
+}
+
+Endpointer::Endpointer(const VadConfig &config) : config(config), vad(config) {}
+
+Endpointer::State Endpointer::feed(const float *frame, size_t n, bool during_playback) {
+    if (current == DONE) return current;
+    bool speech = vad.is_speech(frame, n);
+
+    if (during_playback) {
+        // The assistant's own voice reaches the mic and looks like speech: only what
+        // stands clearly above the echo level counts, the rest keeps tracking it
+        float energy = frame_energy_db(frame, n);
+        if (!echoInitialized) {
+            echoDb = energy;
+            echoInitialized = true;
+        }
+        bool aboveEcho = energy > echoDb + config.barge_in_margin_db;
+        if (!(speech && aboveEcho)) echoDb += VAD_ECHO_ADAPT * (energy - echoDb);
+        speech = speech && aboveEcho;
+    } else {
+        echoInitialized = false;
+    }
+
+    if (current == WAITING) {
+        // Keep a sliding pre-roll so the first syllable is not clipped
+        preroll.insert(preroll.end(), frame, frame + n);
+        prerollPlayback.push_back(during_playback);
+        size_t keep = static_cast<size_t>(config.sample_rate) * config.preroll_ms / 1000 +
+                      config.onset_frames * config.frame_samples();
+        if (preroll.size() > keep) {
+            size_t drop = preroll.size() - keep;
+            preroll.erase(preroll.begin(), preroll.begin() + drop);
+            size_t dropFrames = std::min(prerollPlayback.size(), (drop + n - 1) / n);
+            prerollPlayback.erase(prerollPlayback.begin(), prerollPlayback.begin() + dropFrames);
+        }
+
+        consecutiveSpeech = speech ? consecutiveSpeech + 1 : 0;
+        waitedMs += config.frame_ms;
+        if (consecutiveSpeech >= config.onset_frames) {
+            current = SPEAKING;
+            bargedIn = during_playback;
+            // Leading frames that only hold the assistant's voice are left out, the
+            // onset frames themselves are kept even if playback was still on
+            size_t frames = prerollPlayback.size(), skip = 0;
+            while (skip + consecutiveSpeech < frames && prerollPlayback[skip]) ++skip;
+            size_t skipSamples = std::min(preroll.size(), skip * n);
+            preroll.erase(preroll.begin(), preroll.begin() + skipSamples);
+            prerollPlayback.clear();
+            audio = std::move(preroll);
+            lastSpeechEnd = audio.size();
+            speechFrames += consecutiveSpeech;
+            silenceMs = 0;
+        } else if (waitedMs >= config.max_wait_ms) {
+            current = DONE;
+        }
+        return current;
+    }
+
+    audio.insert(audio.end(), frame, frame + n);
+    if (speech) {
+        lastSpeechEnd = audio.size();
+        speechFrames++;
+        silenceMs = 0;
+    } else {
+        silenceMs += config.frame_ms;
+    }
+
+    size_t maxSamples = static_cast<size_t>(config.sample_rate) * config.max_utterance_ms / 1000;
+    if (silenceMs >= config.hangover_ms || audio.size() >= maxSamples) {
+        current = DONE;
+    }
+    return current;
+}
+
+std::vector<float> Endpointer::utterance() const {
+    if (speechFrames == 0) return {};
+    size_t tail = static_cast<size_t>(config.sample_rate) * config.tail_ms / 1000;
+    size_t end = std::min(audio.size(), lastSpeechEnd + tail);
+    return std::vector<float>(audio.begin(), audio.begin() + end);
+}
+
+std::vector<float> trim_silence(const std::vector<float> &samples, const VadConfig &config) {
+    const size_t frame = config.frame_samples();
+    const size_t frames = samples.size() / frame;
+    if (frames == 0) return samples;
+
+    // Seed the floor with the 10th percentile of frame energies
+    std::vector<float> energies(frames);
+    for (size_t f = 0; f < frames; ++f) energies[f] = frame_energy_db(samples.data() + f * frame, frame);
+    std::vector<float> sorted = energies;
+    std::nth_element(sorted.begin(), sorted.begin() + frames / 10, sorted.end());
+
+    VoiceActivityDetector vad(config);
+    vad.set_noise_floor_db(sorted[frames / 10]);
+
+    size_t first = frames, last = 0;
+    int run = 0;
+    for (size_t f = 0; f < frames; ++f) {
+        if (vad.is_speech(samples.data() + f * frame, frame)) {
+            if (++run >= config.onset_frames && first == frames) first = f + 1 - run;
+            last = f;
+        } else {
+            run = 0;
+        }
+    }
+    if (first == frames) return samples;
+
+    size_t preroll = static_cast<size_t>(config.sample_rate) * config.preroll_ms / 1000;
+    size_t tail = static_cast<size_t>(config.sample_rate) * config.tail_ms / 1000;
+    size_t begin = first * frame > preroll ? first * frame - preroll : 0;
+    size_t end = std::min(samples.size(), (last + 1) * frame + tail);
+    return std::vector<float>(samples.begin() + begin, samples.begin() + end);
+}
@@ -0,0 +1,113 @@
+#ifndef VAD_HPP
+#define VAD_HPP
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Valores por defecto del detector de voz (VAD)
+#define VAD_FRAME_MS            20      // Frame de análisis
+#define VAD_THRESHOLD_DB        9.0f    // Energía mínima sobre el piso de ruido
+#define VAD_ONSET_FRAMES        3       // Frames de voz seguidos para empezar (60 ms)
+#define VAD_HANGOVER_MS         800     // Silencio que termina el turno
+#define VAD_PREROLL_MS          200     // Audio que se conserva antes del inicio
+#define VAD_TAIL_MS             150     // Audio que se conserva después de la última voz
+#define VAD_MAX_WAIT_MS         10000   // Tiempo máximo esperando a que empiece a hablar
+#define VAD_MAX_UTTERANCE_MS    30000   // Duración máxima de un turno
+#define VAD_BARGE_IN_MARGIN_DB  10.0f   // Durante la reproducción: voz sobre el nivel del eco
+
+struct VadConfig {
+    int sample_rate = 16000;
+    int frame_ms = VAD_FRAME_MS;
+    float threshold_db = VAD_THRESHOLD_DB;
+    int onset_frames = VAD_ONSET_FRAMES;
+    int hangover_ms = VAD_HANGOVER_MS;
+    int preroll_ms = VAD_PREROLL_MS;
+    int tail_ms = VAD_TAIL_MS;
+    int max_wait_ms = VAD_MAX_WAIT_MS;
+    int max_utterance_ms = VAD_MAX_UTTERANCE_MS;
+    float barge_in_margin_db = VAD_BARGE_IN_MARGIN_DB;
+
+    size_t frame_samples() const { return static_cast<size_t>(sample_rate) * frame_ms / 1000; }
+};
+
+// Clasificador de frames por energía (sobre un piso de ruido adaptativo) y espectro
+// (proporción de energía en la banda de voz 300-3400 Hz y planitud espectral).
+class VoiceActivityDetector {
+public:
+    explicit VoiceActivityDetector(const VadConfig &config = VadConfig());
+
+    // true si el frame parece voz. Los frames sin voz actualizan el piso de ruido.
+    bool is_speech(const float *frame, size_t n);
+
+    float noise_floor_db() const { return noiseFloorDb; }
+    void set_noise_floor_db(float db) { noiseFloorDb = db; floorInitialized = true; }
+
+private:
+    VadConfig config;
+    float noiseFloorDb = 0.0f;
+    bool floorInitialized = false;
+    std::vector<float> power;
+};
+
+// Energía media de un frame en dBFS.
+float frame_energy_db(const float *frame, size_t n);
+
+// Detección de fin de turno sobre un flujo de frames: empieza con la voz, termina tras
+// hangover_ms de silencio y guarda solo el audio útil (pre-roll + voz + cola).
+class Endpointer {
+public:
+    enum State { WAITING, SPEAKING, DONE };
+
+    explicit Endpointer(const VadConfig &config = VadConfig());
+
+    // Procesa un frame de config.frame_samples() muestras y devuelve el estado.
+    // during_playback marca los frames grabados mientras suena el asistente: en ellos
+    // solo cuenta como voz lo que supera el nivel del eco en barge_in_margin_db, y si el
+    // turno no empieza sobre la reproducción esos frames no entran en el audio.
+    State feed(const float *frame, size_t n, bool during_playback = false);
+
+    State state() const { return current; }
+    bool heard_speech() const { return speechFrames > 0; }
+    // Frames de voz seguidos mientras se espera (>0: posible inicio de turno).
+    int onset_run() const { return current == WAITING ? consecutiveSpeech : 0; }
+    // El turno empezó hablando encima de la reproducción.
+    bool barged_in() const { return bargedIn; }
+
+    // Audio del turno sin el silencio inicial ni final (vacío si nunca hubo voz).
+    std::vector<float> utterance() const;
+    // Audio acumulado desde el pre-roll mientras el turno sigue abierto.
+    const std::vector<float> &audio_so_far() const { return audio; }
+
+private:
+    VadConfig config;
+    VoiceActivityDetector vad;
+    State current = WAITING;
+    std::vector<float> preroll;     // ventana deslizante mientras se espera la voz
+    std::vector<bool> prerollPlayback; // por frame del pre-roll: ¿grabado durante la reproducción?
+    float echoDb = 0.0f;            // nivel del eco del altavoz en el micrófono
+    bool echoInitialized = false;
+    bool bargedIn = false;
+    std::vector<float> audio;       // desde pre-roll hasta el último frame recibido
+    size_t lastSpeechEnd = 0;       // posición en audio tras el último frame con voz
+    int consecutiveSpeech = 0;
+    int silenceMs = 0;
+    int waitedMs = 0;
+    size_t speechFrames = 0;
+};
+
+// Conexión entre la grabación y la reproducción para el barge-in: mientras active()
+// sea true los frames se marcan como during_playback. Con el primer frame de voz se
+// llama a duck(), al confirmarse el turno a stop() y si era una falsa alarma a restore().
+struct PlaybackMonitor {
+    std::function<bool()> active;
+    std::function<void()> duck;
+    std::function<void()> stop;
+    std::function<void()> restore;
+};
+
+// Recorta el silencio inicial y final de una grabación ya completa (modo R/S).
+// Si no se detecta voz devuelve el audio sin cambios.
+std::vector<float> trim_silence(const std::vector<float> &samples, const VadConfig &config = VadConfig());
+
+#endif // VAD_HPP
@@ -1,113 +1,261 @@
 #include "../utilities/voicer.hpp"
+#include "logging.hpp"
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <vector>
 #include <cstdio> 
 #include <filesystem>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "audio_output.hpp"
+#include "wav_reader.hpp"
+#include "speech_cache.hpp"
+#include "speech_normalizer.hpp"
 
-Voicer::Voicer(std::string archivo, std::string audio)
-    : archivoTexto(std::move(archivo)), archivoAudio(std::move(audio)) {}
+#ifdef OVA_WITH_ESPEAK_LIB
+#include <espeak-ng/speak_lib.h>
+#endif
 
-// Function to capture text based on a mapping maded in the prompt.
+Voicer::Voicer(std::string archivo, std::string audio, std::string voz, int velocidad)
+    : archivoTexto(std::move(archivo)), archivoAudio(std::move(audio)), voz(std::move(voz)), velocidad(velocidad) {}
+
+// Reads a response (markdown or the tagged output of format_response_for_audio) from
+// stdin and speaks it. Fenced code blocks are skipped, inline code is read.
 void Voicer::capturarTexto() {
-    std::ostringstream output;
-    std::string line;
-    CaptureState state = WAITING;
-
-    while (std::getline(std::cin, line)) {
-        if (line == "<|jump_line|>") {
-            if (state == WAITING) {
-                state = CAPTURING; // Start capturing
-            } else if (state == CAPTURING) {
-                output << "<|jump_line|>"; // Append the tag
-                if (!std::getline(std::cin, line) || line.empty()) {
-                    state = WAITING;
-                    break;
-                }
-                output << line; // Append the next valid line
-            }
-            continue;
-        }
+    SpeechNormalizer normalizer(SpeechNormalizer::Output::SPEAKABLE, CodePolicy::DROP_BLOCKS);
+    std::string textoCapturado;
+    char buffer[4096];
+    while (std::cin.read(buffer, sizeof(buffer)) || std::cin.gcount() > 0) {
+        normalizer.feed(std::string_view(buffer, static_cast<size_t>(std::cin.gcount())), textoCapturado);
+    }
+    normalizer.finish(textoCapturado);
+    generarAudio(textoCapturado);
+}
 
-        if (line == "<|short_command|>") {
-            continue; // Ignore this tag
-        }
+//Logging error and success messages from other functions
+void voicerlog(const std::string& message) {
+    write_log("voicer.log", message);
+}
+
+// Detecta el motor una vez: primero la biblioteca enlazada, luego los binarios del PATH
+static bool en_path(const std::string &programa) {
+    const char *path = std::getenv("PATH");
+    if (!path) return false;
+    std::istringstream dirs(path);
+    std::string dir;
+    while (std::getline(dirs, dir, ':')) {
+        if (!dir.empty() && access((dir + "/" + programa).c_str(), X_OK) == 0) return true;
+    }
+    return false;
+}
+
+#ifdef OVA_WITH_ESPEAK_LIB
+static int espeakSampleRate = 0;
+static std::mutex espeakMutex; // la biblioteca no es reentrante: una síntesis a la vez
+
+// espeak-ng entrega el audio por bloques; user_data apunta al vector de la llamada en curso
+static int espeak_callback(short *wav, int numsamples, espeak_EVENT *events) {
+    if (wav && numsamples > 0 && events && events->user_data) {
+        auto *pcm = static_cast<std::vector<int16_t> *>(events->user_data);
+        pcm->insert(pcm->end(), wav, wav + numsamples);
+    }
+    return 0; // continue
+}
+#endif
 
-        if (line == "<|long_command|>") {
-            state = (state == CAPTURING) ? PAUSED : CAPTURING;
-            continue;
+SynthEngine motor_de_sintesis() {
+    static std::once_flag detected;
+    static SynthEngine engine = SynthEngine::NONE;
+    std::call_once(detected, []() {
+#ifdef OVA_WITH_ESPEAK_LIB
+        int rate = espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, 0, nullptr, 0);
+        if (rate > 0) {
+            espeakSampleRate = rate;
+            espeak_SetSynthCallback(espeak_callback);
+            engine = SynthEngine::LIBESPEAK_NG;
+            voicerlog("✅ Síntesis con la biblioteca espeak-ng (" + std::to_string(rate) + " Hz).");
+            return;
         }
+        voicerlog("⚠️ Warning: espeak_Initialize failed, falling back to the espeak binaries.");
+#endif
+        if (en_path("espeak")) {
+            engine = SynthEngine::ESPEAK;
+        } else if (en_path("espeak-ng")) {
+            engine = SynthEngine::ESPEAK_NG;
+            voicerlog("⚠️ Warning: 'espeak' not found, switching to 'espeak-ng'.");
+        } else {
+            voicerlog("❌ Error: Neither espeak nor espeak-ng is installed.");
+        }
+    });
+    return engine;
+}
 
-        if (state == CAPTURING) {
-            output << line;
+// Cabecera RIFF que escribe espeak con --stdout: busca "fmt " y "data"
+static bool parse_wav_bytes(const std::string &bytes, std::vector<int16_t> &pcm, int &sampleRate) {
+    if (bytes.size() < 12 || bytes.compare(0, 4, "RIFF") != 0 || bytes.compare(8, 4, "WAVE") != 0) return false;
+    size_t pos = 12;
+    while (pos + 8 <= bytes.size()) {
+        uint32_t size;
+        std::memcpy(&size, bytes.data() + pos + 4, 4);
+        std::string id = bytes.substr(pos, 4);
+        pos += 8;
+        if (id == "fmt " && pos + 8 <= bytes.size()) {
+            uint32_t rate;
+            std::memcpy(&rate, bytes.data() + pos + 4, 4);
+            sampleRate = static_cast<int>(rate);
+        } else if (id == "data") {
+            // espeak no conoce el tamaño final al escribir en una tubería: usar lo que haya
+            size_t n = (bytes.size() - pos) / sizeof(int16_t);
+            pcm.resize(n);
+            std::memcpy(pcm.data(), bytes.data() + pos, n * sizeof(int16_t));
+            return sampleRate > 0;
         }
+        pos += size + (size & 1);
     }
+    return false;
+}
 
-    std::string textoCapturado = output.str();  // Capture the output text
-    generarAudio(textoCapturado);
+// Respaldo sin biblioteca: el texto va como argumento (sin shell ni archivo temporal) y el
+// WAV se lee de la salida estándar del proceso.
+static std::vector<int16_t> sintetizar_con_proceso(const std::string &engine, const std::string &texto,
+                                                   const std::string &voz, int velocidad, int &sampleRate) {
+    std::vector<int16_t> pcm;
+    int pipefd[2];
+    if (pipe(pipefd) != 0) return pcm;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return pcm;
+    }
+    if (pid == 0) {
+        dup2(pipefd[1], STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (devnull >= 0) dup2(devnull, STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        std::string rate = std::to_string(velocidad);
+        execlp(engine.c_str(), engine.c_str(), "--stdout", "-v", voz.c_str(), "-s", rate.c_str(), "--", texto.c_str(), (char *)nullptr);
+        _exit(127);
+    }
+
+    close(pipefd[1]);
+    std::string bytes;
+    char buffer[8192];
+    ssize_t r;
+    while ((r = read(pipefd[0], buffer, sizeof(buffer))) != 0) {
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        bytes.append(buffer, static_cast<size_t>(r));
+    }
+    close(pipefd[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
 
+    if (!parse_wav_bytes(bytes, pcm, sampleRate)) {
+        voicerlog("❌ Error: " + engine + " did not produce a WAV stream (status " + std::to_string(status) + ").");
+        pcm.clear();
+    }
+    return pcm;
 }
 
-//Logging error and success messages from other functions
-void voicerlog(const std::string& message) {
-    
-    std::string logDirectory = "../logs/"; 
-    std::filesystem::create_directories(logDirectory);
-    std::string logFilePath = logDirectory + "voicer.log";
-
-    std::ofstream logFile(logFilePath, std::ios::app); // Open in append mode
-    if (logFile) {
-        logFile << message << std::endl;
-        logFile.close();
-    } else {
-        std::cerr << "❌ Error: No se pudo abrir el archivo de registro en " << logFilePath << std::endl;
+std::vector<int16_t> Voicer::sintetizar(const std::string &texto, int &sampleRate) {
+    switch (motor_de_sintesis()) {
+#ifdef OVA_WITH_ESPEAK_LIB
+    case SynthEngine::LIBESPEAK_NG: {
+        std::vector<int16_t> pcm;
+        std::lock_guard<std::mutex> lock(espeakMutex);
+        espeak_SetVoiceByName(voz.c_str());
+        espeak_SetParameter(espeakRATE, velocidad, 0);
+        espeak_ERROR err = espeak_Synth(texto.c_str(), texto.size() + 1, 0, POS_CHARACTER, 0,
+                                        espeakCHARS_UTF8, nullptr, &pcm);
+        if (err != EE_OK) {
+            voicerlog("❌ Error: espeak_Synth failed (" + std::to_string(err) + ").");
+            return {};
+        }
+        sampleRate = espeakSampleRate;
+        return pcm;
+    }
+#endif
+    case SynthEngine::ESPEAK:
+        return sintetizar_con_proceso("espeak", texto, voz, velocidad, sampleRate);
+    case SynthEngine::ESPEAK_NG:
+        return sintetizar_con_proceso("espeak-ng", texto, voz, velocidad, sampleRate);
+    default:
+        return {};
     }
 }
 
-//Function that creates a temporary file with the mapped prompt text and generates audio with eSpeak NG.
-void Voicer::generarAudio(const std::string &texto) {
+// Synthesizes the text sentence by sentence (cached ones come from disk) and queues each
+// one on the shared audio output as soon as it is ready.
+void Voicer::generarAudio(const std::string &texto, bool esperar) {
     if (texto.empty()) {
         std::string errMsg = "Warning: No text provided for audio generation.";
         voicerlog(errMsg);
         return;
     }
 
-    // Create a temporary file to store the text
-    std::string tempFile = "/tmp/voicer_text.txt";
-    std::ofstream outFile(tempFile);
-    if (!outFile) {
-        std::string errMsg = "❌ Error: Could not create temporary file for text input.";
-        voicerlog(errMsg);
-        return;
-    }
-    outFile << texto;
-    outFile.close();
-
-    // Check if espeak is available
-    bool espeakAvailable = (system("espeak --version > /dev/null 2>&1") == 0);
-    
-    std::string selectedEngine = espeakAvailable ? "espeak" : "espeak-ng";
-    
-    if (!espeakAvailable) {
-        std::string warnMsg = "⚠️ Warning: 'espeak' not found, switching to 'espeak-ng'.";
-        voicerlog(warnMsg);
-    }
+    SpeechCache &cache = speech_cache();
+    AudioOutput &salida = audio_output();
+    const uint64_t generation = salida.generation();
+    std::vector<int16_t> todo;   // respuesta completa, para archivoAudio
+    int rateTodo = 0;
+    uint64_t ultimo = 0;
+    size_t hits = 0, sentences = 0;
 
-    // Construct the espeak command using the temp file
-    std::ostringstream comando;
-    comando << selectedEngine << " -w " << archivoAudio
-            << " --stdout -f " << tempFile << " | aplay > /dev/null 2>&1";
+    for (const std::string &frase : split_sentences(texto)) {
+        sentences++;
+        int sampleRate = 0;
+        std::vector<int16_t> pcm;
+        if (cache.get(frase, voz, velocidad, pcm, sampleRate)) {
+            hits++;
+        } else {
+            pcm = sintetizar(frase, sampleRate);
+            if (pcm.empty()) {
+                voicerlog("❌ Error: Failed to synthesize \"" + frase + "\".");
+                continue;
+            }
+            cache.put(frase, voz, velocidad, pcm, sampleRate);
+        }
 
-    // Execute the command safely
-    FILE* pipe = popen(comando.str().c_str(), "r");
-    if (!pipe) {
-        std::string errMsg = "❌ Error: Failed to execute audio command.";
+        if (!archivoAudio.empty() && (rateTodo == 0 || rateTodo == sampleRate)) {
+            todo.insert(todo.end(), pcm.begin(), pcm.end());
+            rateTodo = sampleRate;
+        }
+        uint64_t id = salida.enqueue(std::move(pcm), sampleRate, generation);
+        if (id == 0) {
+            // stop() since we started (barge-in, new answer): the rest is not wanted
+            voicerlog("⏹️ Reproducción cortada tras " + std::to_string(sentences - 1) + " frases.");
+            return;
+        }
+        ultimo = id;
+    }
+    voicerlog("🔊 " + std::to_string(sentences) + " frases, " + std::to_string(hits) + " desde la caché.");
+
+    if (ultimo == 0) {
+        std::string errMsg = "❌ Error: Failed to synthesize audio.";
         voicerlog(errMsg);
         return;
     }
-    pclose(pipe);
 
-    // Remove the temporary file
-    std::remove(tempFile.c_str());
+    // Copia del último audio: se escribe aparte y se renombra para que dos hilos no se pisen
+    if (!todo.empty()) {
+        static std::atomic<unsigned> contador{0};
+        std::string tmp = archivoAudio + "." + std::to_string(getpid()) + "." + std::to_string(contador++);
+        std::vector<float> samples(todo.size());
+        for (size_t i = 0; i < todo.size(); ++i) samples[i] = todo[i] / 32768.0f;
+        if (write_wav(tmp, samples, rateTodo)) std::rename(tmp.c_str(), archivoAudio.c_str());
+    }
+
+    if (esperar) salida.wait_until_played(ultimo);
 }
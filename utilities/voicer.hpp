@@ -5,24 +5,40 @@
 #include <fstream>
 #include <string>
 #include <fstream>
+#include <cstdint>
+#include <vector>
 
-class Voicer {
-public:
-    // Enumeración para los estados de captura
-    enum CaptureState { WAITING, CAPTURING, PAUSED };
+#define VOICER_DEFAULT_VOICE    "en"    // Voz de espeak
+#define VOICER_DEFAULT_RATE     175     // Palabras por minuto (valor por defecto de espeak)
 
+class Voicer {
 private:
     std::string archivoTexto;
     std::string archivoAudio;
+    std::string voz;
+    int velocidad;
 
 public:
     // Constructor
-    Voicer(std::string archivo = "transcripcion.txt", std::string audio = "audiogene.wav");
+    Voicer(std::string archivo = "transcripcion.txt", std::string audio = "audiogene.wav",
+           std::string voz = VOICER_DEFAULT_VOICE, int velocidad = VOICER_DEFAULT_RATE);
 
     // Métodos
+    // Lee una respuesta de stdin, la normaliza (speech_normalizer.hpp) y la reproduce.
     void capturarTexto();
-    void generarAudio(const std::string &texto);
+    // Reproduce el texto frase por frase; las frases ya sintetizadas salen de la caché
+    // en disco (speech_cache.hpp) y empiezan a sonar sin esperar al motor. El audio va a
+    // la cola de audio_output(); con esperar=false vuelve en cuanto termina de sintetizar.
+    // Un audio_output().stop() durante la síntesis descarta el resto del texto.
+    void generarAudio(const std::string &texto, bool esperar = true);
+    // Sintetiza el texto a PCM mono de 16 bits sin reproducirlo; sampleRate recibe la
+    // frecuencia del motor. Devuelve un vector vacío si no hay motor o falla la síntesis.
+    std::vector<int16_t> sintetizar(const std::string &texto, int &sampleRate);
 };
 
+// Motor de síntesis detectado una sola vez por proceso
+enum class SynthEngine { NONE, LIBESPEAK_NG, ESPEAK, ESPEAK_NG };
+SynthEngine motor_de_sintesis();
+
 #endif // VOICER_HPP
 
@@ -0,0 +1,217 @@
+#include "wake_listener.hpp"
+#include "logging.hpp"
+#include "audio_capture.hpp"
+#include "metrics.hpp"
+#include "model_selector.hpp"
+#include "../utilities/whisper.cpp/include/whisper.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+//Logging error and success messages from other functions
+void wakelog(const std::string& message) {
+    write_log("wake_listener.log", message);
+}
+
+static double wall_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string find_wake_model() {
+    for (const char *name : {"ggml-tiny.en.bin", "ggml-tiny.bin", "ggml-tiny.en-q5_1.bin", "ggml-tiny-q5_1.bin"}) {
+        std::string path = std::string(WHISPER_MODELS_DIR) + "/" + name;
+        if (std::filesystem::exists(path)) return path;
+    }
+    return "";
+}
+
+// Letras y espacios en minúscula, palabras separadas por un solo espacio
+static std::vector<std::string> wake_words(const std::string &text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : text) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        } else if (!word.empty()) {
+            words.push_back(word);
+            word.clear();
+        }
+    }
+    if (!word.empty()) words.push_back(word);
+    return words;
+}
+
+static size_t edit_distance(const std::string &a, const std::string &b) {
+    std::vector<size_t> prev(b.size() + 1), curr(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) prev[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+        curr[0] = i;
+        for (size_t j = 1; j <= b.size(); ++j) {
+            curr[j] = std::min({prev[j] + 1, curr[j - 1] + 1, prev[j - 1] + (a[i - 1] == b[j - 1] ? 0 : 1)});
+        }
+        std::swap(prev, curr);
+    }
+    return prev[b.size()];
+}
+
+bool matches_wake_phrase(const std::string &phrase, const std::string &text, double maxError) {
+    std::vector<std::string> target = wake_words(phrase);
+    std::vector<std::string> heard = wake_words(text);
+    if (target.empty() || heard.empty()) return false;
+
+    // Compare letters only, so "hey over" / "heyova" still line up with "hey ova"
+    std::string wanted;
+    for (const std::string &w : target) wanted += w;
+
+    // Every run of words about as long as the phrase (one word more or less)
+    for (size_t len = std::max<size_t>(1, target.size() - 1); len <= target.size() + 1; ++len) {
+        for (size_t start = 0; start + len <= heard.size(); ++start) {
+            std::string candidate;
+            for (size_t k = start; k < start + len; ++k) candidate += heard[k];
+            if (edit_distance(wanted, candidate) <= maxError * wanted.size()) return true;
+        }
+    }
+    return false;
+}
+
+WakeListener::WakeListener(const std::string &phrase, const std::string &modelPath, const VadConfig &config)
+    : wakePhrase(phrase), config(config) {
+    std::string model = modelPath.empty() ? find_wake_model() : modelPath;
+    if (model.empty()) {
+        model = cached_whisper_model();
+        wakelog("⚠️ No tiny whisper model in " + std::string(WHISPER_MODELS_DIR) + ", using " + model +
+                " (more CPU per window).");
+    }
+    ctx = whisper_init_from_file_with_params(model.c_str(), whisper_context_default_params());
+    if (!ctx) {
+        wakelog("❌ Error: No se pudo cargar el modelo " + model);
+        return;
+    }
+    wakelog("✅ Wake listener \"" + wakePhrase + "\" con " + model);
+}
+
+WakeListener::~WakeListener() {
+    if (ctx) whisper_free(ctx);
+}
+
+std::string WakeListener::decode(const std::vector<float> &samples) {
+    whisper_full_params params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    params.n_threads = WAKE_THREADS;
+    params.language = "en";
+    params.no_context = true;
+    params.single_segment = true;
+    params.no_timestamps = true;
+    params.max_tokens = WAKE_MAX_TOKENS;
+    params.print_progress = false;
+    params.print_realtime = false;
+    params.print_timestamps = false;
+    params.print_special = false;
+    // Encoder context sized to the window (50 positions per second) instead of 30 s
+    params.audio_ctx = std::min(1500, static_cast<int>(samples.size() * 50 / WHISPER_SAMPLE_RATE) + 64);
+
+    // Whisper wants at least one second of audio
+    std::vector<float> padded = samples;
+    if (padded.size() < WHISPER_SAMPLE_RATE) padded.resize(WHISPER_SAMPLE_RATE, 0.0f);
+
+    if (whisper_full(ctx, params, padded.data(), padded.size()) != 0) return "";
+    std::string text;
+    for (int i = 0; i < whisper_full_n_segments(ctx); ++i) text += whisper_full_get_segment_text(ctx, i);
+    return text;
+}
+
+void WakeListener::report(bool final) {
+    double wall = wall_seconds() - wallStart;
+    if (wall <= 0.0) return;
+    double cpu = thread_cpu_seconds() - cpuStart;
+    record_metric("wake_listener", {
+        {"phrase", wakePhrase},
+        {"wall_s", wall},
+        {"speech_s", speechSeconds},
+        {"decode_s", decodeSeconds},
+        {"duty_cycle", decodeSeconds / wall},   // fraction of the time whisper was running
+        {"cpu_cores", cpu / wall},              // listener thread, VAD included
+        {"windows", windows},
+        {"detections", detections},
+        {"final", final},
+    });
+    wallStart = wall_seconds();
+    cpuStart = thread_cpu_seconds();
+    decodeSeconds = speechSeconds = 0.0;
+    windows = detections = 0;
+}
+
+bool WakeListener::wait_for_wake(const std::atomic<bool> *cancel) {
+    if (!ctx) return false;
+
+    AudioCapture capture(config.sample_rate);
+    if (!capture.start()) {
+        wakelog("❌ Error al iniciar la captura del micrófono");
+        return false;
+    }
+
+    const size_t frameSamples = config.frame_samples();
+    const size_t capacity = static_cast<size_t>(config.sample_rate) * WAKE_WINDOW_MS / 1000;
+    const size_t preroll = static_cast<size_t>(config.sample_rate) * config.preroll_ms / 1000;
+    std::vector<float> ring(capacity);
+    std::vector<float> frame(frameSamples);
+    size_t written = 0;             // muestras totales escritas en el anillo
+
+    VoiceActivityDetector vad(config);
+    int run = 0, silenceMs = 0;
+    bool inSpeech = false;
+    size_t windowStart = 0;
+
+    wallStart = wall_seconds();
+    cpuStart = thread_cpu_seconds();
+    double nextReport = wallStart + WAKE_REPORT_S;
+    bool woke = false;
+
+    while (!(cancel && *cancel) && capture.read(frame.data(), frame.size())) {
+        for (size_t i = 0; i < frameSamples; ++i) ring[(written + i) % capacity] = frame[i];
+        written += frameSamples;
+
+        bool speech = vad.is_speech(frame.data(), frame.size());
+        run = speech ? run + 1 : 0;
+        if (speech) speechSeconds += config.frame_ms / 1000.0;
+
+        if (!inSpeech && run >= config.onset_frames) {
+            inSpeech = true;
+            silenceMs = 0;
+            size_t back = run * frameSamples + preroll;
+            windowStart = written > back ? written - back : 0;
+        } else if (inSpeech) {
+            silenceMs = speech ? 0 : silenceMs + config.frame_ms;
+        }
+
+        // Close the window at the end of the phrase or when the ring is full
+        if (inSpeech && (silenceMs >= WAKE_END_SILENCE_MS || written - windowStart >= capacity)) {
+            inSpeech = false;
+            size_t start = std::max(windowStart, written > capacity ? written - capacity : 0);
+            std::vector<float> window(written - start);
+            for (size_t i = 0; i < window.size(); ++i) window[i] = ring[(start + i) % capacity];
+
+            double t0 = wall_seconds();
+            std::string text = decode(window);
+            decodeSeconds += wall_seconds() - t0;
+            windows++;
+
+            if (matches_wake_phrase(wakePhrase, text)) {
+                detections++;
+                wakelog("🔔 Frase de activación: \"" + text + "\"");
+                woke = true;
+                break;
+            }
+        }
+
+        if (wall_seconds() >= nextReport) {
+            report(false);
+            nextReport = wall_seconds() + WAKE_REPORT_S;
+        }
+    }
+    capture.stop();
+    report(true);
+    return woke;
+}
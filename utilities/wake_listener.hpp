@@ -0,0 +1,63 @@
+#ifndef WAKE_LISTENER_HPP
+#define WAKE_LISTENER_HPP
+
+#include <atomic>
+#include <string>
+#include <vector>
+#include "vad.hpp"
+
+#define WAKE_DEFAULT_PHRASE     "hey ova"
+#define WAKE_WINDOW_MS          2000    // Ventana máxima que se decodifica (anillo de captura)
+#define WAKE_END_SILENCE_MS     300     // Silencio que cierra una ventana candidata
+#define WAKE_THREADS            1       // Hilos de Whisper: muy por debajo de un núcleo
+#define WAKE_MAX_TOKENS         10      // La frase es corta, no hace falta decodificar más
+#define WAKE_MAX_CHAR_ERROR     0.34    // Distancia de edición máxima / longitud de la frase
+#define WAKE_REPORT_S           60      // Cada cuánto se escriben las métricas
+
+struct whisper_context;
+
+// Escucha continua de una frase de activación con un modelo de Whisper pequeño (tiny).
+// El micrófono llena un anillo de WAKE_WINDOW_MS; el VAD decide cuándo hay voz y solo
+// entonces se decodifica esa ventana corta con un hilo. El resto del tiempo el coste es
+// el del VAD. El ciclo de trabajo y la CPU se registran en ../logs/metrics.jsonl.
+class WakeListener {
+public:
+    // Con modelPath vacío se busca ggml-tiny.en.bin / ggml-tiny.bin en WHISPER_MODELS_DIR.
+    explicit WakeListener(const std::string &phrase = WAKE_DEFAULT_PHRASE, const std::string &modelPath = "",
+                          const VadConfig &config = VadConfig());
+    ~WakeListener();
+
+    WakeListener(const WakeListener &) = delete;
+    WakeListener &operator=(const WakeListener &) = delete;
+
+    bool ready() const { return ctx != nullptr; }
+
+    // Bloquea hasta oír la frase (true) o hasta que cancel pase a true / falle el micrófono.
+    bool wait_for_wake(const std::atomic<bool> *cancel = nullptr);
+
+    const std::string &phrase() const { return wakePhrase; }
+
+private:
+    std::string decode(const std::vector<float> &samples);
+    void report(bool final);
+
+    std::string wakePhrase;
+    VadConfig config;
+    struct whisper_context *ctx = nullptr;
+
+    // Estadísticas desde el último informe
+    double wallStart = 0.0;
+    double cpuStart = 0.0;
+    double decodeSeconds = 0.0;
+    double speechSeconds = 0.0;
+    int windows = 0;
+    int detections = 0;
+};
+
+// Busca la frase en el texto tolerando errores de transcripción ("hey eva" por "hey ova").
+bool matches_wake_phrase(const std::string &phrase, const std::string &text, double maxError = WAKE_MAX_CHAR_ERROR);
+
+// Modelo pequeño para la frase de activación ("" si no hay ninguno instalado).
+std::string find_wake_model();
+
+#endif // WAKE_LISTENER_HPP
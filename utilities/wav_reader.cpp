@@ -0,0 +1,154 @@
+#include "wav_reader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+// Little-endian helpers for the RIFF fields
+static uint32_t read_u32(const char *p) {
+    return static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8) |
+           (static_cast<uint8_t>(p[2]) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(p[3])) << 24);
+}
+
+static uint16_t read_u16(const char *p) {
+    return static_cast<uint8_t>(p[0]) | (static_cast<uint8_t>(p[1]) << 8);
+}
+
+bool WavReader::open(const std::string &path) {
+    file.open(path, std::ios::binary);
+    if (!file) {
+        lastError = "❌ Archivo de audio no existe: " + path;
+        return false;
+    }
+
+    char riff[12];
+    if (!file.read(riff, 12) || std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        lastError = "❌ Error: El archivo no es un WAV válido: " + path;
+        return false;
+    }
+
+    // Walk the chunk list until "data"; "fmt " must come first
+    bool haveFormat = false;
+    char chunk[8];
+    while (file.read(chunk, 8)) {
+        uint32_t chunkSize = read_u32(chunk + 4);
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            std::vector<char> fmt(chunkSize);
+            if (chunkSize < 16 || !file.read(fmt.data(), chunkSize)) break;
+            uint16_t format = read_u16(fmt.data());
+            channels = read_u16(fmt.data() + 2);
+            sampleRate = static_cast<int>(read_u32(fmt.data() + 4));
+            uint16_t bits = read_u16(fmt.data() + 14);
+            if (format != 1 || bits != 16 || channels < 1 || channels > 2) {
+                lastError = "❌ Error: Solo se soporta PCM de 16 bits mono o estéreo: " + path;
+                return false;
+            }
+            if (sampleRate != 16000) {
+                lastError = "❌ Error: Se esperaba audio a 16 kHz, el archivo está a " + std::to_string(sampleRate) + " Hz.";
+                return false;
+            }
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) break;
+            remainingBytes = chunkSize;
+            // arecord leaves 0x7FFFFFFF when it is killed before rewriting the header
+            if (remainingBytes == 0 || remainingBytes == 0x7FFFFFFF) {
+                std::streampos here = file.tellg();
+                file.seekg(0, std::ios::end);
+                remainingBytes = static_cast<uint32_t>(file.tellg() - here);
+                file.seekg(here);
+            }
+            totalSamples = remainingBytes / (sizeof(int16_t) * channels);
+            return true;
+        } else {
+            file.seekg(chunkSize + (chunkSize & 1), std::ios::cur);
+        }
+    }
+
+    lastError = "❌ Error: Encabezado WAV incompleto: " + path;
+    return false;
+}
+
+size_t WavReader::read(float *out, size_t maxSamples) {
+    if (channels == 0) return 0; // open() failed
+    size_t frameBytes = sizeof(int16_t) * channels;
+    size_t wanted = std::min<size_t>(maxSamples, remainingBytes / frameBytes);
+    if (wanted == 0) return 0;
+
+    scratch.resize(wanted * channels);
+    file.read(reinterpret_cast<char *>(scratch.data()), wanted * frameBytes);
+    size_t got = static_cast<size_t>(file.gcount()) / frameBytes;
+    remainingBytes -= static_cast<uint32_t>(got * frameBytes);
+    if (got < wanted) remainingBytes = 0;
+
+    if (channels == 1) {
+        for (size_t i = 0; i < got; ++i) out[i] = scratch[i] / 32768.0f;
+    } else {
+        for (size_t i = 0; i < got; ++i) out[i] = (scratch[2 * i] + scratch[2 * i + 1]) / 65536.0f;
+    }
+    return got;
+}
+
+std::vector<float> WavReader::read_all() {
+    if (channels == 0) return {};
+    std::vector<float> samples(remainingBytes / (sizeof(int16_t) * channels));
+    samples.resize(read(samples.data(), samples.size()));
+    return samples;
+}
+
+static void put_u32(std::ofstream &out, uint32_t v) {
+    char b[4] = {static_cast<char>(v), static_cast<char>(v >> 8), static_cast<char>(v >> 16), static_cast<char>(v >> 24)};
+    out.write(b, 4);
+}
+
+static void put_u16(std::ofstream &out, uint16_t v) {
+    char b[2] = {static_cast<char>(v), static_cast<char>(v >> 8)};
+    out.write(b, 2);
+}
+
+bool write_wav(const std::string &path, const std::vector<float> &samples, int sampleRate) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) return false;
+
+    uint32_t dataBytes = static_cast<uint32_t>(samples.size() * sizeof(int16_t));
+    out.write("RIFF", 4);
+    put_u32(out, 36 + dataBytes);
+    out.write("WAVEfmt ", 8);
+    put_u32(out, 16);
+    put_u16(out, 1);                    // PCM
+    put_u16(out, 1);                    // mono
+    put_u32(out, sampleRate);
+    put_u32(out, sampleRate * 2);       // byte rate
+    put_u16(out, 2);                    // block align
+    put_u16(out, 16);                   // bits per sample
+    out.write("data", 4);
+    put_u32(out, dataBytes);
+
+    std::vector<int16_t> pcm(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        float clamped = std::max(-1.0f, std::min(1.0f, samples[i]));
+        pcm[i] = static_cast<int16_t>(clamped * 32767.0f);
+    }
+    out.write(reinterpret_cast<const char *>(pcm.data()), dataBytes);
+    return static_cast<bool>(out);
+}
+
+void collect_wav_inputs(const std::string &input, std::vector<std::string> &files) {
+    if (std::filesystem::is_directory(input)) {
+        std::vector<std::string> found;
+        for (const auto &entry : std::filesystem::directory_iterator(input)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".wav") {
+                found.push_back(entry.path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    } else if (std::filesystem::path(input).extension() == ".txt") {
+        std::ifstream list(input);
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty()) files.push_back(line);
+        }
+    } else {
+        files.push_back(input);
+    }
+}
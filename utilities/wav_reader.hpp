@@ -0,0 +1,46 @@
+#ifndef WAV_READER_HPP
+#define WAV_READER_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Lector de archivos WAV por bloques: nunca carga el archivo completo en memoria.
+// Solo acepta PCM de 16 bits a 16 kHz (lo que espera Whisper); si el archivo es
+// estéreo se mezcla a mono al leer.
+class WavReader {
+public:
+    WavReader() = default;
+
+    // Abre el archivo, recorre los chunks RIFF y deja el cursor al inicio de "data".
+    bool open(const std::string &path);
+
+    // Lee hasta maxSamples muestras normalizadas a [-1, 1). Devuelve 0 al final del archivo.
+    size_t read(float *out, size_t maxSamples);
+
+    // Lee todo lo que queda del archivo (para audios cortos, p. ej. comandos de voz).
+    std::vector<float> read_all();
+
+    size_t total_samples() const { return totalSamples; }
+    int sample_rate() const { return sampleRate; }
+    const std::string &error() const { return lastError; }
+
+private:
+    std::ifstream file;
+    uint32_t remainingBytes = 0;
+    size_t totalSamples = 0;
+    int sampleRate = 0;
+    int channels = 0;
+    std::string lastError;
+    std::vector<int16_t> scratch;
+};
+
+// Escribe muestras normalizadas como WAV PCM de 16 bits mono.
+bool write_wav(const std::string &path, const std::vector<float> &samples, int sampleRate = 16000);
+
+// Añade a files los .wav de una carpeta (ordenados), las rutas de una lista .txt (una por
+// línea) o el propio archivo.
+void collect_wav_inputs(const std::string &input, std::vector<std::string> &files);
+
+#endif // WAV_READER_HPP